@@ -0,0 +1,161 @@
+#include "arena.h"
+#include <stdio.h>
+
+/**
+ * @brief 新建一个内存池
+ *
+ * @param chunkSize 每一块的大小，为0时使用默认大小
+ * @return pArena
+ */
+pArena newArena(size_t chunkSize)
+{
+    pArena arena = malloc(sizeof(struct Arena_));
+    if (!arena)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Arena_));
+        exit(EXIT_FAILURE);
+    }
+    arena->head = NULL;
+    arena->chunkSize = chunkSize ? chunkSize : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->usedBytes = 0;
+    arena->reservedBytes = 0;
+    return arena;
+}
+
+/**
+ * @brief 申请新的一块并挂到链表头上
+ *
+ * @param arena 内存池
+ * @param minSize 新块至少要能放下的字节数
+ */
+static void newArenaChunk(pArena arena, size_t minSize)
+{
+    size_t size = arena->chunkSize;
+    //特别大的对象单独给一块
+    if (minSize > size)
+        size = minSize;
+    pArenaChunk chunk = malloc(sizeof(struct ArenaChunk_) + size);
+    if (!chunk)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct ArenaChunk_) + size);
+        exit(EXIT_FAILURE);
+    }
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = arena->head;
+    arena->head = chunk;
+    arena->reservedBytes += sizeof(struct ArenaChunk_) + size;
+}
+
+/**
+ * @brief 从内存池中分配size字节，按ARENA_ALIGN对齐，不需要也不能单独释放
+ *
+ * @param arena 内存池
+ * @param size 字节数
+ * @return void* 分配到的内存
+ */
+void *arenaAlloc(pArena arena, size_t size)
+{
+    assert(arena != NULL);
+    pArenaChunk chunk = arena->head;
+    size_t offset = chunk ? (chunk->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : 0;
+    if (!chunk || offset + size > chunk->size)
+    {
+        newArenaChunk(arena, size);
+        chunk = arena->head;
+        offset = 0;
+    }
+    arena->usedBytes += offset + size - chunk->used;
+    chunk->used = offset + size;
+    return chunk->data + offset;
+}
+
+/**
+ * @brief 把字符串复制到内存池中，字符串不需要对齐
+ *
+ * @param arena 内存池
+ * @param src 源字符串
+ * @return char* 复制后的字符串，src为NULL时返回NULL
+ */
+char *arenaString(pArena arena, const char *src)
+{
+    if (src == NULL)
+        return NULL;
+    size_t length = strlen(src) + 1;
+    pArenaChunk chunk = arena->head;
+    if (!chunk || chunk->used + length > chunk->size)
+    {
+        newArenaChunk(arena, length);
+        chunk = arena->head;
+    }
+    char *p = chunk->data + chunk->used;
+    chunk->used += length;
+    arena->usedBytes += length;
+    memcpy(p, src, length);
+    return p;
+}
+
+/**
+ * @brief 清空内存池，之前分配的对象都不能再用。只保留最早申请的一块给后面继续使用，
+ * 其他块都还给系统，所以反复重置的时候占用的内存只取决于两次重置之间分配得最多的那一次
+ *
+ * @param arena 内存池
+ */
+void arenaReset(pArena arena)
+{
+    assert(arena != NULL);
+    pArenaChunk chunk = arena->head;
+    if (chunk == NULL)
+        return;
+    while (chunk->next)
+    {
+        pArenaChunk tobeFree = chunk;
+        chunk = chunk->next;
+        free(tobeFree);
+    }
+    chunk->used = 0;
+    arena->head = chunk;
+    arena->usedBytes = 0;
+    arena->reservedBytes = sizeof(struct ArenaChunk_) + chunk->size;
+}
+
+/**
+ * @brief 已经分配出去的字节数
+ *
+ * @param arena 内存池
+ * @return size_t
+ */
+size_t arenaUsedBytes(pArena arena)
+{
+    return arena ? arena->usedBytes : 0;
+}
+
+/**
+ * @brief 向系统申请的字节数，包括块头和没用完的部分
+ *
+ * @param arena 内存池
+ * @return size_t
+ */
+size_t arenaReservedBytes(pArena arena)
+{
+    return arena ? arena->reservedBytes : 0;
+}
+
+/**
+ * @brief 一次性释放内存池和其中所有的对象
+ *
+ * @param arena 内存池
+ */
+void freeArena(pArena arena)
+{
+    if (arena == NULL)
+        return;
+    pArenaChunk chunk = arena->head;
+    while (chunk)
+    {
+        pArenaChunk tobeFree = chunk;
+        chunk = chunk->next;
+        free(tobeFree);
+    }
+    free(arena);
+}
@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define ARENA_DEFAULT_CHUNK_SIZE (64 * 1024) //默认每一块的大小
+#define ARENA_ALIGN 8                        //分配出去的内存按8字节对齐
+
+typedef struct ArenaChunk_ *pArenaChunk;
+typedef struct Arena_ *pArena;
+
+/**
+ * @brief arena中的一块连续内存，块与块之间用链表串起来
+ *
+ */
+struct ArenaChunk_
+{
+    pArenaChunk next; //上一块（链表头是最新的块）
+    size_t size;      //data的容量
+    size_t used;      //data中已经分配出去的字节数
+    char data[];
+};
+
+/**
+ * @brief 指针碰撞式的内存池，只能整体释放，适合存放生命周期相同的对象，比如整棵语法树
+ *
+ */
+struct Arena_
+{
+    pArenaChunk head;     //当前正在分配的块
+    size_t chunkSize;     //新块的默认大小
+    size_t usedBytes;     //已经分配出去的字节数（包括对齐的填充）
+    size_t reservedBytes; //向系统申请的字节数
+};
+
+pArena newArena(size_t chunkSize);
+void *arenaAlloc(pArena arena, size_t size);
+char *arenaString(pArena arena, const char *src);
+void arenaReset(pArena arena);
+size_t arenaUsedBytes(pArena arena);
+size_t arenaReservedBytes(pArena arena);
+void freeArena(pArena arena);
+#endif
@@ -0,0 +1,14 @@
+import sys
+
+import benchutil
+
+# 用gencmm.py生成大文件，用./main --time跑几次，每个阶段取中位数
+# 用法：python3 benchmark.py [函数个数] [次数] [传给main的其他参数，比如--mmap]
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 5000
+rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+options = sys.argv[3:]
+source = benchutil.cmmCorpus(n)
+
+print('%s (%d functions, %d rounds, median) %s' % (source, n, rounds, ' '.join(options)))
+for phase, value in benchutil.medianPhases(options + [source], rounds).items():
+    print('%-10s %10.3f ms' % (phase, value))
@@ -0,0 +1,59 @@
+import os
+import subprocess
+import time
+
+# 性能测试脚本共用的部分：生成测试用的c--文件、运行./main、解析--time的输出、取中位数。
+# 各个脚本只负责生成自己的语料和打印结果
+
+
+def generate(source, write, cached=False):
+    """调用write(f)把语料写到source，cached为True时文件已经存在就不再生成，返回source"""
+    if not (cached and os.path.exists(source)):
+        with open(source, 'w') as f:
+            write(f)
+    return source
+
+
+def script(source, args):
+    """用生成脚本的输出当语料，比如script(source, ['gencmm.py', '5000'])，文件已经存在就不再生成"""
+    return generate(source, lambda f: subprocess.run(['python3'] + args, stdout=f, check=True), cached=True)
+
+
+def cmmCorpus(funcs):
+    """gencmm.py生成的有funcs个函数的大程序，几个测试共用"""
+    return script('/tmp/benchmark_%d.cmm' % funcs, ['gencmm.py', str(funcs)])
+
+
+def run(args, text=False, **kwargs):
+    """运行./main，默认捕获stdout和stderr"""
+    kwargs.setdefault('stdout', subprocess.PIPE)
+    kwargs.setdefault('stderr', subprocess.PIPE)
+    return subprocess.run(['./main'] + args, universal_newlines=text, **kwargs)
+
+
+def timed(args, **kwargs):
+    """运行./main，返回结果和墙钟时间（毫秒）"""
+    start = time.time()
+    result = run(args, **kwargs)
+    return result, (time.time() - start) * 1000
+
+
+def phases(stderr):
+    """解析--time输出的"阶段: 耗时 ms"，返回阶段到毫秒数的字典，保持输出的顺序"""
+    times = {}
+    for line in stderr.splitlines():
+        if line.endswith(' ms') and ':' in line:
+            phase, value = line.split(':', 1)
+            times[phase] = float(value.split()[0])
+    return times
+
+
+def median(values, key=None):
+    values = sorted(values, key=key)
+    return values[len(values) // 2]
+
+
+def medianPhases(args, rounds):
+    """用--time跑rounds次，每个阶段分别取中位数"""
+    runs = [phases(run(['--time'] + args, text=True, stdout=subprocess.DEVNULL).stderr) for i in range(rounds)]
+    return {phase: median(run[phase] for run in runs) for phase in runs[0]}
@@ -0,0 +1,60 @@
+import glob
+import os
+import struct
+import sys
+
+import benchutil
+
+# 二进制中间代码测试：每个测试文件用--binary写出二进制中间代码，再用--dump-binary映射进来按文本格式输出，
+# 必须和直接输出的文本完全一样；截断、改坏文件头、段没有按8字节对齐的文件必须报错退出，不能崩溃，写不下时--binary -o也要报错。
+# 最后编译一个大文件，打印二进制文件的大小和映射加检查的耗时
+# 用法：python3 binirtest.py [大文件的函数个数]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+files = sorted(glob.glob('../test/*/test*')) + sorted(glob.glob('../../Lab2/test/*/test*'))
+files = [f for f in files if not f.endswith('.ir')]
+binary = '/tmp/binirtest.irb'
+small = '/tmp/binirtest.cmm'
+
+
+checked = 0
+for f in files:
+    text = benchutil.run([f])
+    if text.returncode != 0 or b'Error type' in text.stdout:
+        continue
+    if benchutil.run(['--binary', '-o', binary, f]).returncode != 0:
+        print('%s: --binary failed' % f)
+        sys.exit(1)
+    dumped = benchutil.run(['--dump-binary', binary])
+    if dumped.returncode != 0 or dumped.stdout != text.stdout:
+        print('%s: --dump-binary differs from the text IR' % f)
+        sys.exit(1)
+    checked += 1
+
+data = open(binary, 'rb').read()
+# 没有标号的程序标号表是空的，它在文件头第52个字节的位置往前挪4个字节以后还在文件里面，只是不再按8字节对齐
+open(small, 'w').write('int main()\n{\n    write(1);\n    return 0;\n}\n')
+benchutil.run(['--binary', '-o', binary, small])
+misaligned = bytearray(open(binary, 'rb').read())
+struct.pack_into('<I', misaligned, 52, struct.unpack_from('<I', misaligned, 52)[0] - 4)
+for name, broken in (('truncated', data[:len(data) // 2]), ('bad magic', b'XXXX' + data[4:]),
+                     ('bad version', data[:4] + b'\xff' + data[5:]), ('misaligned', bytes(misaligned))):
+    open(binary, 'wb').write(broken)
+    result = benchutil.run(['--dump-binary', binary])
+    if result.returncode != 1 or not result.stderr:
+        print('%s file was not rejected (exit code %d)' % (name, result.returncode))
+        sys.exit(1)
+print('%d files OK, same IR after a binary round trip, broken files rejected' % checked)
+
+source = benchutil.cmmCorpus(funcs)
+text = benchutil.run([source]).stdout
+benchutil.run(['--binary', '-o', binary, source])
+dumped, elapsed = benchutil.timed(['--time', '--dump-binary', binary])
+if dumped.stdout != text:
+    print('%s: --dump-binary differs from the text IR' % source)
+    sys.exit(1)
+print('%s: %d bytes of text IR, %d bytes of binary IR, dump %.3f ms' % (source, len(text), os.path.getsize(binary), elapsed))
+print(dumped.stderr.decode().strip())
+# 写不下的时候必须报错退出，不能留下一个不完整的文件还当作成功
+if os.path.exists('/dev/full') and benchutil.run(['--binary', '-o', '/dev/full', source]).returncode != 1:
+    print('%s: --binary -o /dev/full did not fail' % source)
+    sys.exit(1)
@@ -0,0 +1,916 @@
+#include "compiler.h"
+#include "irbin.h"
+#include "irparse.h"
+#include "syntax.tab.h"
+#include <time.h>
+#include <sys/stat.h>
+#include <limits.h>
+#include <pthread.h>
+
+/*lex.yy.c中定义，yyscan_t就是void *，lex.yy.c被syntax.y包含了，这里不能再包含一次*/
+extern int yylex_init_extra(pCompiler compiler, void **scanner);
+extern int yylex_destroy(void *scanner);
+extern int yylex(YYSTYPE *lvalp, YYLTYPE *llocp, void *scanner);
+extern void yyrestart(FILE *f, void *scanner);
+
+static int compileParallel(pCompiler compiler);
+
+/**
+ * @brief 单调时钟的当前时间，用来统计各个阶段的耗时
+ *
+ * @return double 毫秒
+ */
+double nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/**
+ * @brief 建立上下文，驻留池和类型表由调用者给出
+ *
+ * @param out 中间代码、语义错误和词法错误的输出
+ * @param err 语法错误的输出
+ * @param strings 驻留池
+ * @param types 类型表
+ * @return pCompiler
+ */
+static pCompiler allocCompiler(FILE *out, FILE *err, pInternTable strings, pTypeTable types)
+{
+    pCompiler compiler = calloc(1, sizeof(struct Compiler_));
+    if (!compiler)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Compiler_));
+        exit(EXIT_FAILURE);
+    }
+    compiler->out = out;
+    compiler->err = err;
+    compiler->irOut = out;
+    compiler->strings = strings;
+    compiler->types = types;
+    compiler->diagnostics = &compiler->errors;
+    if (yylex_init_extra(compiler, &compiler->scanner))
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(scanner)\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    return compiler;
+}
+
+/**
+ * @brief 建立一次编译的上下文
+ *
+ * @param out 中间代码、语义错误和词法错误的输出
+ * @param err 语法错误的输出
+ * @return pCompiler
+ */
+pCompiler newCompiler(FILE *out, FILE *err)
+{
+    return allocCompiler(out, err, newInternTable(), newTypeTable());
+}
+
+/**
+ * @brief 检查是否有函数声明了但是没有定义
+ *
+ * @param compiler
+ */
+void checkFucDeclare(pCompiler compiler)
+{
+    pTableItem temp = compiler->funcDeckStack->item;
+    while(temp){
+        if(!checkTableItemConflict(compiler->symbolTable,temp)){
+            pError(compiler,DCLARE_BUTUNDEF_FUNC,temp->symbolDepth,temp->field->name);
+        }
+        temp = temp->nextSymbol;
+    }
+}
+
+/**
+ * @brief 报告语义错误超过了--max-errors，语义分析提前结束
+ *
+ * @param compiler
+ */
+static void reportTruncated(pCompiler compiler)
+{
+    fprintf(compiler->err, "too many semantic errors, stopped after %u\n", compiler->errors.maxErrors);
+}
+
+/**
+ * @brief 流式编译一个ExtDef，由语法分析器在归约出ExtDef以后调用。
+ * 出现过词法或者语法错误以后就不再分析，和一次性编译时一样不输出中间代码。
+ * 语义错误会和中间代码交替输出，而不是全部在中间代码之前，每个ExtDef的错误一次写出去。
+ * 错误超过--max-errors以后不再分析和输出后面的ExtDef
+ *
+ * @param compiler
+ * @param extDef 刚归约出来的ExtDef，调用结束后它的子树就会被丢掉
+ */
+void compileExtDef(pCompiler compiler, pNode extDef)
+{
+    if (compiler->lexerror || compiler->syntaxerror || extDef == NULL || compiler->errors.truncated)
+        return;
+    ExtDef(compiler, extDef);
+    flushDiagnostics(&compiler->errors, compiler->out);
+    if (compiler->errors.truncated)
+    {
+        reportTruncated(compiler);
+        return;
+    }
+    translate_ExtDef(compiler, extDef);
+    printInterCodes(compiler, compiler->interCodesWrap);
+    clearInterCodesWrap(compiler->interCodesWrap);
+    clearLocalSymbols(compiler->symbolTable);
+}
+
+/**
+ * @brief 把字符串写成JSON的字符串，加上引号，转义引号、反斜杠和控制字符
+ *
+ * @param f
+ * @param s
+ */
+static void printJSONString(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+/**
+ * @brief 只做词法分析，统计Token个数和扫描速度，结果用一行JSON打印到compiler->out，方便脚本记录
+ *
+ * @param compiler
+ * @param fileName 源文件名，输入已经交给了词法分析器
+ * @param start 打开文件之前的时间，映射和打开文件的时间也算在内
+ */
+static void lexOnly(pCompiler compiler, const char *fileName, double start)
+{
+    unsigned long tokens = 0;
+    YYSTYPE lval;
+    YYLTYPE lloc;
+    while (yylex(&lval, &lloc, compiler->scanner))
+        tokens++;
+    double seconds = (nowMs() - start) / 1000.0;
+    struct stat st;
+    double bytes = stat(fileName, &st) ? 0 : (double)st.st_size;
+    fputs("{\"file\": ", compiler->out);
+    printJSONString(compiler->out, fileName);
+    fprintf(compiler->out, ", \"mode\": \"%s\", \"bytes\": %.0f, \"tokens\": %lu, "
+                           "\"seconds\": %.6f, \"tokens_per_sec\": %.0f, \"mb_per_sec\": %.3f, \"lex_error\": %s}\n",
+            compiler->mapped ? "mmap" : "stdio", bytes, tokens, seconds,
+            tokens / seconds, bytes / (1024 * 1024) / seconds, compiler->lexerror ? "true" : "false");
+}
+
+/**
+ * @brief 把源文件交给词法分析器，--mmap时映射到内存中，否则用stdio打开，普通文件按大小预留节点数组
+ *
+ * @param compiler
+ * @param fileName c--文件名
+ * @param f 用stdio打开时得到的文件，映射时为NULL
+ * @return true 成功
+ * @return false 文件打不开，已经打印了原因
+ */
+static bool openSource(pCompiler compiler, const char *fileName, FILE **f)
+{
+    *f = NULL;
+    if (compiler->mapped)
+    {
+        if (!scanMappedFile(compiler, fileName))
+            return false;
+        setNodeArraySourceSize(&compiler->nodes, compiler->mappedLength);
+        return true;
+    }
+    *f = fopen(fileName, "r");
+    if (!*f)
+    {
+        perror(fileName);
+        return false;
+    }
+    //普通文件按大小预留节点数组，管道之类的不知道大小，还是预留上限
+    struct stat st;
+    if (!fstat(fileno(*f), &st) && S_ISREG(st.st_mode))
+        setNodeArraySourceSize(&compiler->nodes, st.st_size);
+    yyrestart(*f, compiler->scanner);
+    return true;
+}
+
+/**
+ * @brief 关闭openSource打开的源文件
+ *
+ * @param compiler
+ * @param f openSource得到的文件，可以为NULL
+ */
+static void closeSource(pCompiler compiler, FILE *f)
+{
+    if (f)
+        fclose(f);
+    closeMappedFile(compiler);
+}
+
+/**
+ * @brief 编译一个文件，各个阶段的耗时记在compiler中
+ *
+ * @param compiler 新建的上下文，每个上下文只能编译一次
+ * @param fileName c--文件名，为NULL时从标准输入读，只做语法分析
+ * @return int 0表示正常结束（源程序有错误也算），1表示文件打不开或者二进制中间代码太大写不下
+ */
+int compileFile(pCompiler compiler, const char *fileName)
+{
+    int status = 0;
+    if (fileName == NULL)
+    {
+        yyrestart(stdin, compiler->scanner);
+        yyparse(compiler->scanner, compiler);
+        return 0;
+    }
+    double start = nowMs();
+    FILE *f = NULL;
+    if (!openSource(compiler, fileName, &f))
+        return 1;
+    if (compiler->streaming)
+    {
+        //符号表和中间代码的编号在整个文件中共用
+        compiler->symbolTable = initSymbolTable(compiler);
+        compiler->interCodesWrap = newInterCodesWrap();
+    }
+    if (compiler->lexOnly)
+        lexOnly(compiler, fileName, start);
+    else
+        yyparse(compiler->scanner, compiler);
+    compiler->parseTime = nowMs() - start;
+    /*如果既没有词法分析错误也没有语法分析错误就进行语义分析和中间代码生成*/
+    if (compiler->streaming)
+    {
+        if (compiler->symbolStats)
+            printSymbolTableStats(compiler->symbolTable, compiler->err);
+        freeInterCodesWrap(compiler->interCodesWrap);
+        freeSymbolTable(compiler->symbolTable);
+    }
+    else if (!compiler->lexOnly && !compiler->lexerror && !compiler->syntaxerror && compiler->jobs)
+        status = compileParallel(compiler);
+    else if (!compiler->lexOnly && !compiler->lexerror && !compiler->syntaxerror)
+    {
+        // printSyntaxTree(compiler, compiler->root, 0);
+        compiler->symbolTable = initSymbolTable(compiler);
+        // 不用考虑函数声明了因此直接注释掉
+        // compiler->funcDeckStack = malloc(sizeof(struct FuncDeclarationStack_));
+        // assert(compiler->funcDeckStack != NULL);
+        // compiler->funcDeckStack->stackDepth = 0;
+        // compiler->funcDeckStack->item = NULL;
+
+        start = nowMs();
+        startSemanticAnalysis(compiler, compiler->root);
+        // checkFucDeclare(compiler);
+        compiler->semanticTime = nowMs() - start;
+        flushDiagnostics(&compiler->errors, compiler->out);
+
+        if (compiler->errors.truncated)
+            reportTruncated(compiler);
+        else
+        {
+            start = nowMs();
+            compiler->interCodesWrap = newInterCodesWrap();
+            generateInterCodes(compiler, compiler->root);
+            compiler->interTime = nowMs() - start;
+
+            start = nowMs();
+            if (!compiler->binaryIR)
+                printInterCodes(compiler, compiler->interCodesWrap);
+            else if (!writeIRFile(compiler, compiler->interCodesWrap))
+                status = 1;
+            compiler->printTime = nowMs() - start;
+            freeInterCodesWrap(compiler->interCodesWrap);
+        }
+
+        if (compiler->symbolStats)
+            printSymbolTableStats(compiler->symbolTable, compiler->err);
+        freeSymbolTable(compiler->symbolTable);
+    }
+    compiler->interCodesWrap = NULL;
+    compiler->symbolTable = NULL;
+    closeSource(compiler, f);
+    return status;
+}
+
+/**
+ * @brief 读文本格式的中间代码文件，不经过前端，再按照compiler->binaryIR输出成文本或者二进制，--parse-ir用。
+ * 读的耗时记在parseTime中，输出的耗时记在printTime中
+ *
+ * @param compiler 新建的上下文，名字驻留到它的驻留池中
+ * @param fileName 中间代码文件名
+ * @return int 0表示正常结束，1表示文件打不开、格式不对或者二进制中间代码太大写不下，已经把原因打印到compiler->err
+ */
+int compileIRFile(pCompiler compiler, const char *fileName)
+{
+    char error[512];
+    double start = nowMs();
+    compiler->interCodesWrap = loadInterCodes(compiler->strings, fileName, error, sizeof(error));
+    compiler->parseTime = nowMs() - start;
+    if (compiler->interCodesWrap == NULL)
+    {
+        fprintf(compiler->err, "%s\n", error);
+        return 1;
+    }
+    int status = 0;
+    start = nowMs();
+    if (!compiler->binaryIR)
+        printInterCodes(compiler, compiler->interCodesWrap);
+    else if (!writeIRFile(compiler, compiler->interCodesWrap))
+        status = 1;
+    compiler->printTime = nowMs() - start;
+    freeInterCodesWrap(compiler->interCodesWrap);
+    compiler->interCodesWrap = NULL;
+    return status;
+}
+
+/**
+ * @brief 释放上下文，语法树、驻留的字符串和类型表都跟着释放，驻留池和类型表属于增量分析的会话时不释放
+ *
+ * @param compiler
+ */
+void freeCompiler(pCompiler compiler)
+{
+    if (compiler == NULL)
+        return;
+    yylex_destroy(compiler->scanner);
+    freeNodeArray(&compiler->nodes);
+    freeDiagnosticList(&compiler->errors);
+    if (!compiler->sharedTables)
+    {
+        freeInternTable(compiler->strings);
+        freeTypeTable(compiler->types);
+    }
+    free(compiler);
+}
+
+/**
+ * @brief 新建一个增量分析的会话
+ *
+ * @return pSession
+ */
+pSession newSession()
+{
+    pSession session = calloc(1, sizeof(Session));
+    assert(session != NULL);
+    session->jobs = 1;
+    session->strings = newInternTable();
+    session->types = newTypeTable();
+    return session;
+}
+
+/**
+ * @brief 为会话中的一个版本建立上下文，驻留池和类型表用会话的
+ *
+ * @param session
+ * @param out 语义错误和词法错误的输出
+ * @param err 语法错误的输出
+ * @return pCompiler 只能交给analyseRevision用一次
+ */
+pCompiler newSessionCompiler(pSession session, FILE *out, FILE *err)
+{
+    pCompiler compiler = allocCompiler(out, err, session->strings, session->types);
+    compiler->sharedTables = true;
+    return compiler;
+}
+
+/**
+ * @brief 把一个64位的值混进指纹
+ *
+ * @param hash 当前的指纹
+ * @param value 值
+ * @return uint64_t
+ */
+static inline uint64_t mixFingerprint(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x100000001b3ULL;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * @brief 子树中的第一个Token
+ *
+ * @param node 子树的根
+ * @return pNode
+ */
+static pNode firstToken(pNode node)
+{
+    while (getChild(node))
+        node = getChild(node);
+    return node;
+}
+
+/**
+ * @brief 把节点数组中[first, end)之间的Token混进指纹，每个Token混进它的文法符号、值和相对行号。
+ * Token是按照扫描的顺序建立的，一个ExtDef的Token在节点数组中是连着的，中间只夹着非终结符，
+ * 所以不用沿着语法树走，顺序扫一遍就可以。
+ * 文法没有二义性，Token序列一样语法树就一样，所以非终结符不用混进去。
+ * 驻留池在会话中共用，相同的Token值在各个版本中的编号相同，直接用编号
+ *
+ * @param first 第一个Token
+ * @param end 最后一个Token之后的节点
+ * @param base 行号都减去它
+ * @param hash 当前的指纹
+ * @return uint64_t
+ */
+static uint64_t fingerprintTokens(pNode first, pNode end, uint32_t base, uint64_t hash)
+{
+    for (pNode node = first; node < end; node++)
+    {
+        if (node->type != NON_TERMINAL)
+            hash = mixFingerprint(hash, ((uint64_t)(node->lineno - base) << 32 | node->value) ^
+                                            ((uint64_t)node->kind << 56));
+    }
+    return hash;
+}
+
+/**
+ * @brief 把列表中的错误的行号改成相对于base的
+ *
+ * @param list 错误列表
+ * @param base ExtDef的第一行
+ */
+static void relativeLines(pDiagnosticList list, int base)
+{
+    for (unsigned i = 0; i < list->count; i++)
+        list->items[i].line -= base;
+}
+
+/**
+ * @brief 语法树中所有的ExtDef，按源程序中的顺序
+ *
+ * @param compiler 语法分析已经结束
+ * @param count ExtDef的个数写到这里
+ * @return pNode* 调用者释放
+ */
+static pNode *collectExtDefs(pCompiler compiler, unsigned *count)
+{
+    unsigned capacity = 64;
+    pNode *extDefs = malloc(capacity * sizeof(pNode));
+    assert(extDefs != NULL);
+    *count = 0;
+    for (pNode list = compiler->root ? getChild(compiler->root) : NULL; list; list = getBrother(getChild(list)))
+    {
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            extDefs = realloc(extDefs, capacity * sizeof(pNode));
+            assert(extDefs != NULL);
+        }
+        extDefs[(*count)++] = getChild(list);
+    }
+    return extDefs;
+}
+
+/**
+ * @brief 把第k个ExtDef的错误接到errors后面，和一次性编译时一样去重。
+ * 函数体自己的列表也限制了--max-errors个，它被截断了说明整个文件的错误也超过了
+ *
+ * @param session
+ * @param errors 整个文件的错误
+ * @param extDef 第k个ExtDef
+ * @param k 下标
+ */
+static void mergeDiagnostics(pSession session, pDiagnosticList errors, pNode extDef, unsigned k)
+{
+    ExtDefRecord *record = &session->records[k];
+    for (unsigned i = 0; i < record->globalErrors.count; i++)
+        addDiagnostic(errors, record->globalErrors.items[i].type,
+                      extDef->lineno + record->globalErrors.items[i].line, record->globalErrors.items[i].name);
+    for (unsigned i = 0; i < record->bodyErrors.count; i++)
+        addDiagnostic(errors, record->bodyErrors.items[i].type,
+                      extDef->lineno + record->bodyErrors.items[i].line, record->bodyErrors.items[i].name);
+    if (record->bodyErrors.truncated)
+        errors->truncated = true;
+}
+
+/**
+ * @brief 把各个ExtDef的错误按源程序中的顺序放到compiler->errors中再输出，和一次性编译时一样去重，
+ * --max-errors只限制输出的个数
+ *
+ * @param session
+ * @param compiler
+ * @param extDefs 这一版的ExtDef
+ * @param first 前first个ExtDef的错误已经放进去了
+ * @param count ExtDef的个数
+ */
+static void collectDiagnostics(pSession session, pCompiler compiler, pNode *extDefs, unsigned first, unsigned count)
+{
+    for (unsigned k = first; k < count && !compiler->errors.truncated; k++)
+        mergeDiagnostics(session, &compiler->errors, extDefs[k], k);
+    flushDiagnostics(&compiler->errors, compiler->out);
+    if (compiler->errors.truncated)
+        reportTruncated(compiler);
+}
+
+/**
+ * @brief 重新建立全局作用域。按顺序分析每个ExtDef的全局部分，函数定义只分析Specifier和FunDec，
+ * 记下FunDec放在第1层的符号和返回类型，然后清掉局部符号，就像函数体是空的一样
+ *
+ * @param session
+ * @param compiler
+ * @param extDefs 这一版的ExtDef
+ * @param count ExtDef的个数
+ */
+static void rebuildGlobalScope(pSession session, pCompiler compiler, pNode *extDefs, unsigned count)
+{
+    for (unsigned k = 0; k < session->count; k++)
+    {
+        freeDiagnosticList(&session->records[k].globalErrors);
+        freeDiagnosticList(&session->records[k].bodyErrors);
+    }
+    if (count > session->capacity)
+    {
+        session->capacity = count;
+        session->records = realloc(session->records, count * sizeof(ExtDefRecord));
+        assert(session->records != NULL);
+    }
+    memset(session->records, 0, count * sizeof(ExtDefRecord));
+    session->count = count;
+    if (session->symbolTable)
+        freeSymbolTable(session->symbolTable);
+    //上一版的类型只有上一版的全局作用域和记录在用，都已经清掉了
+    resetTypeTable(session->types);
+    session->symbolTable = compiler->symbolTable = initSymbolTable(compiler);
+
+    for (unsigned k = 0; k < count; k++)
+    {
+        ExtDefRecord *record = &session->records[k];
+        pNode child = getChild(extDefs[k]);
+        //序号从1开始，0留给内置函数
+        session->symbolTable->order = k + 1;
+        compiler->diagnostics = &record->globalErrors;
+        if (extDefs[k]->production == EXTDEF_FUNC)
+        {
+            record->returnType = Specifier(compiler, child);
+            FunDec(compiler, getBrother(child), record->returnType);
+            record->scope = saveScopeSymbols(compiler, 1);
+        }
+        else
+            ExtDef(compiler, extDefs[k]);
+        clearLocalSymbols(session->symbolTable);
+        relativeLines(&record->globalErrors, extDefs[k]->lineno);
+    }
+    session->rebuilt = true;
+}
+
+/**
+ * @brief 在全局作用域上重新分析第k个ExtDef的函数体，只看得到前k个ExtDef定义的全局符号。
+ * 分析完局部符号还留在compiler->symbolTable中，调用者用完以后清掉
+ *
+ * @param session
+ * @param compiler 这个线程的上下文，symbolTable是它私有的局部作用域
+ * @param extDef 函数定义
+ * @param k 它的下标
+ */
+static void analyseBody(pSession session, pCompiler compiler, pNode extDef, unsigned k)
+{
+    ExtDefRecord *record = &session->records[k];
+    pSymbolTable symbolTable = compiler->symbolTable;
+    symbolTable->order = symbolTable->horizon = k + 1;
+    clearDiagnosticList(&record->bodyErrors);
+    compiler->diagnostics = &record->bodyErrors;
+    restoreScopeSymbols(compiler, 1, record->scope);
+    CompSt(compiler, getBrother(getBrother(getChild(extDef))), record->returnType);
+    relativeLines(&record->bodyErrors, extDef->lineno);
+}
+
+/**
+ * @brief 要分析的函数体，各个线程从next开始依次领取
+ *
+ */
+typedef struct BodyQueue_
+{
+    pSession session;
+    pCompiler compiler; //这一版的上下文，线程复制一份，换上自己的局部作用域和错误列表
+    pNode *extDefs;     //这一版的ExtDef
+    unsigned *bodies;   //要分析的函数体是第几个ExtDef，按源程序中的顺序
+    unsigned count;
+    unsigned next;          //下一个还没有人领的下标，原子地加一
+    pInterCodesWrap *codes; //一次性编译时每个函数翻译出来的中间代码，下标和extDefs一样，增量分析时为NULL
+    pSymbolTable *scopes;   //一次性编译时有语义错误的函数体分析完的局部作用域，留到错误输出以后再翻译
+    //一次性编译用--max-errors时，分析完的ExtDef按源程序中的顺序随时合并到errors中，
+    //超过了就不再领新的函数体；增量分析时done为NULL，每个函数体都要分析完，留给下一版用
+    bool *done;             //各个ExtDef是否分析完了，不是函数定义的一开始就是true
+    unsigned merged;        //前merged个ExtDef的错误已经合并了
+    bool stop;              //errors已经截断，原子地读写
+    pthread_mutex_t mutex;  //保护done、merged和errors
+    pDiagnosticList errors; //整个文件的错误，线程复制的compiler是开始前的快照，不包括它
+} BodyQueue;
+
+/**
+ * @brief 第k个ExtDef分析完了，把从merged开始连续分析完的ExtDef的错误合并到compiler->errors，
+ * 截断了就让各个线程停下来。前面的ExtDef都合并完才合并后面的，所以留下的错误和不用--jobs时一样
+ *
+ * @param queue
+ * @param k 刚分析完的ExtDef
+ */
+static void finishBody(BodyQueue *queue, unsigned k)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->done[k] = true;
+    while (queue->merged < queue->session->count && queue->done[queue->merged] && !queue->errors->truncated)
+    {
+        mergeDiagnostics(queue->session, queue->errors, queue->extDefs[queue->merged], queue->merged);
+        queue->merged++;
+    }
+    if (queue->errors->truncated)
+        __atomic_store_n(&queue->stop, true, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+/**
+ * @brief 线程入口，不断领取函数体来分析，直到领完。
+ * 每个线程有自己的上下文副本和私有的局部作用域，全局作用域、语法树和驻留池只读，类型表自己加锁，
+ * 错误记在各个函数体自己的列表中，所以线程之间不需要同步。
+ * 一次性编译时没有语义错误的函数体分析完接着翻译成编号从0开始的中间代码；
+ * 翻译有错误的函数体可能崩溃，不能在错误输出之前做，把它的局部作用域留下来，换一个新的接着分析。
+ * 用--max-errors时错误超过了就不再领新的函数体，见finishBody
+ *
+ * @param arg BodyQueue
+ * @return void*
+ */
+static void *analyseBodies(void *arg)
+{
+    BodyQueue *queue = arg;
+    struct Compiler_ worker = *queue->compiler;
+    worker.symbolTable = newLocalSymbolTable(queue->session->symbolTable);
+    for (;;)
+    {
+        if (__atomic_load_n(&queue->stop, __ATOMIC_RELAXED))
+            break;
+        unsigned i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (i >= queue->count)
+            break;
+        unsigned k = queue->bodies[i];
+        ExtDefRecord *record = &queue->session->records[k];
+        analyseBody(queue->session, &worker, queue->extDefs[k], k);
+        if (queue->done)
+            finishBody(queue, k);
+        if (queue->codes && (record->bodyErrors.count || record->globalErrors.count))
+        {
+            queue->scopes[k] = worker.symbolTable;
+            worker.symbolTable = newLocalSymbolTable(queue->session->symbolTable);
+            continue;
+        }
+        if (queue->codes)
+        {
+            worker.interCodesWrap = queue->codes[k] = newInterCodesWrap();
+            translate_ExtDef(&worker, queue->extDefs[k]);
+        }
+        clearLocalSymbols(worker.symbolTable);
+    }
+    freeSymbolTable(worker.symbolTable);
+    return NULL;
+}
+
+/**
+ * @brief 在jobs个线程中分析要重新分析的函数体，只有一个函数体或者只用一个线程时直接在当前线程中分析
+ *
+ * @param queue 要分析的函数体
+ * @param jobs 线程数
+ */
+static void runBodyQueue(BodyQueue *queue, unsigned jobs)
+{
+    if (jobs > queue->count)
+        jobs = queue->count;
+    if (jobs <= 1)
+    {
+        analyseBodies(queue);
+        return;
+    }
+    pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+    assert(threads != NULL);
+    for (unsigned i = 0; i < jobs; i++)
+    {
+        if (pthread_create(&threads[i], NULL, analyseBodies, queue))
+        {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (unsigned i = 0; i < jobs; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+/**
+ * @brief 释放会话的全局作用域和每个ExtDef的记录，不释放驻留池和类型表
+ *
+ * @param session
+ */
+static void releaseSessionScope(pSession session)
+{
+    for (unsigned k = 0; k < session->count; k++)
+    {
+        freeDiagnosticList(&session->records[k].globalErrors);
+        freeDiagnosticList(&session->records[k].bodyErrors);
+    }
+    free(session->records);
+    if (session->symbolTable)
+        freeSymbolTable(session->symbolTable);
+}
+
+/**
+ * @brief 一次性编译时用compiler->jobs个线程分析和翻译函数体。和增量分析一样先按顺序建立全局作用域，
+ * 再把函数体分给各个线程，每个函数体在线程私有的局部作用域中分析，接着翻译成编号从0开始的中间代码，然后清掉局部符号，
+ * 和--stream一样局部变量只在自己的函数中可见。最后按源程序中的顺序输出语义错误，
+ * 再把各个函数的中间代码接起来输出，输出和线程数无关，没有错误的程序和不用--jobs时输出一样的中间代码。
+ * 函数体的分析和翻译是一起做的，都算在semanticTime中，interTime只是接起来的时间。
+ * 有语义错误的函数体等错误都输出以后再在当前线程中用线程留下的局部作用域翻译，算在interTime中
+ *
+ * @param compiler 语法分析已经结束，没有词法和语法错误
+ * @return int 和compileFile一样
+ */
+static int compileParallel(pCompiler compiler)
+{
+    int status = 0;
+    double start = nowMs();
+    unsigned count;
+    pNode *extDefs = collectExtDefs(compiler, &count);
+    Session session;
+    memset(&session, 0, sizeof(Session));
+    session.strings = compiler->strings;
+    session.types = compiler->types;
+    rebuildGlobalScope(&session, compiler, extDefs, count);
+    compiler->diagnostics = &compiler->errors;
+    //线程开始以后compiler->errors会被合并错误的线程修改，各个线程复制的是这份快照
+    struct Compiler_ snapshot = *compiler;
+    BodyQueue queue = {&session, &snapshot, extDefs, malloc((count ? count : 1) * sizeof(unsigned)), 0, 0,
+                       calloc(count ? count : 1, sizeof(pInterCodesWrap)),
+                       calloc(count ? count : 1, sizeof(pSymbolTable)),
+                       compiler->errors.maxErrors ? calloc(count ? count : 1, sizeof(bool)) : NULL, 0, false,
+                       PTHREAD_MUTEX_INITIALIZER, &compiler->errors};
+    assert(queue.bodies != NULL && queue.codes != NULL && queue.scopes != NULL);
+    for (unsigned k = 0; k < count; k++)
+    {
+        if (extDefs[k]->production == EXTDEF_FUNC)
+            queue.bodies[queue.count++] = k;
+        else if (queue.done)
+            queue.done[k] = true;
+        //一个函数体自己的错误超过了--max-errors，整个文件也超过了，不用再分析下去
+        session.records[k].bodyErrors.maxErrors = compiler->errors.maxErrors;
+    }
+    runBodyQueue(&queue, compiler->jobs);
+    compiler->semanticTime = nowMs() - start;
+
+    collectDiagnostics(&session, compiler, extDefs, queue.merged, count);
+    if (!compiler->errors.truncated)
+    {
+        start = nowMs();
+        //错误已经输出了，用留下来的局部作用域翻译有语义错误的函数体
+        struct Compiler_ worker = *compiler;
+        for (unsigned k = 0; k < count; k++)
+        {
+            if (queue.scopes[k])
+            {
+                worker.symbolTable = queue.scopes[k];
+                worker.interCodesWrap = queue.codes[k] = newInterCodesWrap();
+                translate_ExtDef(&worker, extDefs[k]);
+            }
+        }
+        compiler->interCodesWrap = newInterCodesWrap();
+        for (unsigned k = 0; k < count; k++)
+        {
+            if (queue.codes[k])
+                appendInterCodes(compiler->interCodesWrap, queue.codes[k]);
+        }
+        compiler->interTime = nowMs() - start;
+
+        start = nowMs();
+        if (!compiler->binaryIR)
+            printInterCodes(compiler, compiler->interCodesWrap);
+        else if (!writeIRFile(compiler, compiler->interCodesWrap))
+            status = 1;
+        compiler->printTime = nowMs() - start;
+        freeInterCodesWrap(compiler->interCodesWrap);
+    }
+    for (unsigned k = 0; k < count; k++)
+    {
+        if (queue.codes[k])
+            freeInterCodesWrap(queue.codes[k]);
+        if (queue.scopes[k])
+        {
+            clearLocalSymbols(queue.scopes[k]);
+            freeSymbolTable(queue.scopes[k]);
+        }
+    }
+    if (compiler->symbolStats)
+        printSymbolTableStats(session.symbolTable, compiler->err);
+    releaseSessionScope(&session);
+    free(queue.done);
+    free(queue.scopes);
+    free(queue.codes);
+    free(queue.bodies);
+    free(extDefs);
+    return status;
+}
+
+/**
+ * @brief 分析文件的一个新版本，输出它的语义错误，和对这个版本用--stream编译时输出的语义错误一样。
+ * 有词法或者语法错误时只输出这些错误，全局作用域和上一版的结果保留到下一版
+ *
+ * @param session
+ * @param compiler newSessionCompiler建立的上下文，各个阶段的耗时记在这里
+ * @param fileName c--文件名
+ * @return int 0表示正常结束（源程序有错误也算），1表示文件打不开
+ */
+int analyseRevision(pSession session, pCompiler compiler, const char *fileName)
+{
+    double start = nowMs();
+    FILE *f = NULL;
+    if (!openSource(compiler, fileName, &f))
+        return 1;
+    yyparse(compiler->scanner, compiler);
+    compiler->parseTime = nowMs() - start;
+    session->reanalysed = 0;
+    session->rebuilt = false;
+    if (compiler->lexerror || compiler->syntaxerror)
+    {
+        closeSource(compiler, f);
+        return 0;
+    }
+
+    start = nowMs();
+    unsigned count;
+    pNode *extDefs = collectExtDefs(compiler, &count);
+    //函数定义的全局部分是Specifier和FunDec，函数体单独算指纹
+    uint64_t *bodyHashes = calloc(count ? count : 1, sizeof(uint64_t));
+    assert(bodyHashes != NULL);
+    uint64_t globalKey = mixFingerprint(0xcbf29ce484222325ULL, count);
+    for (unsigned k = 0; k < count; k++)
+    {
+        pNode first = firstToken(extDefs[k]);
+        pNode end = k + 1 < count ? firstToken(extDefs[k + 1]) : compiler->nodes.nodes + compiler->nodes.count;
+        uint32_t base = extDefs[k]->lineno;
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        if (extDefs[k]->production == EXTDEF_FUNC)
+        {
+            pNode body = firstToken(getBrother(getBrother(getChild(extDefs[k]))));
+            hash = fingerprintTokens(first, body, base, hash);
+            bodyHashes[k] = fingerprintTokens(body, end, base, 0xcbf29ce484222325ULL);
+        }
+        else
+            hash = fingerprintTokens(first, end, base, hash);
+        globalKey = mixFingerprint(globalKey, hash);
+    }
+    compiler->symbolTable = session->symbolTable;
+    if (session->symbolTable == NULL || count != session->count || globalKey != session->globalKey ||
+        getTypeTableBytes(session->types) > 2 * session->typeBytes)
+    {
+        rebuildGlobalScope(session, compiler, extDefs, count);
+        session->globalKey = globalKey;
+    }
+    compiler->diagnostics = &compiler->errors;
+    compiler->symbolTable = NULL;
+    //全局作用域建好以后就不再修改，函数体可以同时分析
+    BodyQueue queue = {session, compiler, extDefs, malloc((count ? count : 1) * sizeof(unsigned)), 0, 0, NULL, NULL, NULL, 0, false,
+                       PTHREAD_MUTEX_INITIALIZER, NULL};
+    assert(queue.bodies != NULL);
+    for (unsigned k = 0; k < count; k++)
+    {
+        if (extDefs[k]->production != EXTDEF_FUNC)
+            continue;
+        if (session->rebuilt || session->records[k].bodyHash != bodyHashes[k])
+        {
+            session->records[k].bodyHash = bodyHashes[k];
+            queue.bodies[queue.count++] = k;
+        }
+    }
+    runBodyQueue(&queue, session->jobs);
+    session->reanalysed = queue.count;
+    if (session->rebuilt)
+        session->typeBytes = getTypeTableBytes(session->types);
+    free(queue.bodies);
+    compiler->semanticTime = nowMs() - start;
+
+    start = nowMs();
+    collectDiagnostics(session, compiler, extDefs, 0, count);
+    compiler->printTime = nowMs() - start;
+    free(bodyHashes);
+    free(extDefs);
+    closeSource(compiler, f);
+    return 0;
+}
+
+/**
+ * @brief 释放会话，全局作用域、驻留池和类型表都跟着释放
+ *
+ * @param session
+ */
+void freeSession(pSession session)
+{
+    if (session == NULL)
+        return;
+    releaseSessionScope(session);
+    freeInternTable(session->strings);
+    freeTypeTable(session->types);
+    free(session);
+}
@@ -0,0 +1,106 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "inter.h"
+
+/**
+ * @brief 一次编译的上下文。
+ * 以前散落在各个文件中的全局变量都放到了这里，词法分析、语法分析、语义分析和中间代码生成都从这里拿状态，
+ * 所以一个进程可以在不同的线程中同时编译不同的文件
+ *
+ */
+struct Compiler_
+{
+    void *scanner;                  //flex的可重入扫描器
+    pNode root;                     //语法树的根
+    bool lexerror;                  //出现过词法错误
+    bool syntaxerror;               //出现过语法错误
+    bool streaming;                 //--stream，每归约出一个ExtDef就马上分析、翻译、输出，然后丢掉它的语法树和中间代码
+    bool mapped;                    //--mmap，把源文件映射到内存中直接扫描
+    bool lexOnly;                   //--lex-only，只跑词法分析
+    bool symbolStats;               //--symbol-stats，结束时打印符号表的统计信息
+    bool binaryIR;                  //--binary，中间代码按二进制格式写到irOut，见irbin.h
+    SymbolHash symbolHash;          //--hash，符号表用的hash函数，NULL表示默认的
+    unsigned jobs;                  //--jobs，一次性编译时分析和翻译函数体的线程数，0表示整个文件在一个线程中依次分析，见compileParallel
+
+    NodeArray nodes;                //语法树的所有节点
+    pInternTable strings;           //字符串驻留池
+    pTypeTable types;               //类型表，语义分析得到的类型都在这里
+    pSymbolTable symbolTable;       //符号表
+    pFuncDecStack funcDeckStack;    //函数声明，现在不用考虑函数声明了，没有用到
+    pInterCodesWrap interCodesWrap; //中间代码
+    DiagnosticList errors;          //语义错误，一次性编译时分析完再一起输出，流式编译时每个ExtDef输出一次
+    pDiagnosticList diagnostics;    //pError把语义错误记到这里，通常指向errors，增量分析时指向各个ExtDef自己的列表
+    bool sharedTables;              //strings和types属于增量分析的会话，释放上下文时不释放它们
+
+    FILE *out;   //语义错误和词法错误输出到这里
+    FILE *err;   //语法错误和无法识别的字符输出到这里
+    FILE *irOut; //中间代码输出到这里，-o时是输出文件，否则和out一样
+
+    char *mappedSource;  //--mmap时映射进来的源文件
+    size_t mappedLength; //映射的总长度，按页对齐
+    void *mappedBuffer;  //flex在映射的内存上建立的缓冲区
+
+    double parseTime, semanticTime, interTime, printTime; //各个阶段的耗时，毫秒
+};
+
+double nowMs();
+pCompiler newCompiler(FILE *out, FILE *err);
+int compileFile(pCompiler compiler, const char *fileName);
+int compileIRFile(pCompiler compiler, const char *fileName);
+void compileExtDef(pCompiler compiler, pNode extDef);
+void freeCompiler(pCompiler compiler);
+
+/**
+ * @brief 增量分析中一个ExtDef上一次分析的结果。
+ * 函数定义分成全局部分（Specifier和FunDec）和函数体（CompSt），其他的ExtDef都是全局部分。
+ * 指纹和错误的行号都相对于ExtDef的第一行，所以前面的代码增减了行数也不影响
+ *
+ */
+typedef struct ExtDefRecord_
+{
+    uint64_t bodyHash;           //函数体的指纹，不是函数定义时为0
+    pType returnType;            //函数的返回类型，重新分析函数体时用
+    pFieldList scope;            //FunDec放在第1层的符号，见saveScopeSymbols
+    DiagnosticList globalErrors; //分析全局部分时的语义错误
+    DiagnosticList bodyErrors;   //分析函数体时的语义错误
+} ExtDefRecord;
+
+/**
+ * @brief 增量分析的会话，把同一个文件先后的多个版本依次交给它分析，只输出语义错误，和--stream一样每个函数分析完就清掉局部变量。
+ * 全局作用域（结构体定义、全局变量和函数签名）分析完以后保存在symbolTable中，之后不再修改，
+ * 每个全局符号记下定义它的ExtDef的序号，分析第k个函数体时只看得到前k个ExtDef定义的符号，和从头分析时一样。
+ * 新版本的全局部分和上一版完全一样时只重新分析指纹变了的函数体，其余的函数体直接用上一版的错误，
+ * 否则重新建立全局作用域，再分析所有的函数体。
+ * 分析函数体时全局作用域只读，每个线程用自己的局部作用域，要分析的函数体分给jobs个线程同时分析，
+ * 错误记在各个ExtDef自己的列表中，最后按源程序中的顺序输出，和线程数无关。
+ * 驻留池在所有版本之间共用，名字的指针在各个版本之间可以直接比较。
+ * 类型表也是共用的，但是只有全局作用域和还在用的记录引用其中的类型，所以重新建立全局作用域时整个清空，
+ * 内存不会随着版本数增长；重新分析的函数体里定义的结构体也会加进类型表，
+ * 类型表比上次重新建立以后大了一倍时也重新建立一次
+ *
+ */
+typedef struct Session_
+{
+    pInternTable strings;     //所有版本共用的驻留池
+    pTypeTable types;         //所有版本共用的类型表
+    pSymbolTable symbolTable; //全局作用域，NULL表示还没有建立
+    uint64_t globalKey;       //所有ExtDef的全局部分合起来的指纹
+    ExtDefRecord *records;    //上一版的每个ExtDef
+    unsigned count;           //ExtDef的个数
+    unsigned capacity;        //records的长度
+    unsigned jobs;            //分析函数体用的线程数，默认是1
+    unsigned reanalysed;      //最近一版重新分析了几个函数体
+    bool rebuilt;             //最近一版是否重新建立了全局作用域
+    size_t typeBytes;         //上次重新建立全局作用域并分析完所有函数体以后类型表的大小
+} Session, *pSession;
+
+pSession newSession();
+pCompiler newSessionCompiler(pSession session, FILE *out, FILE *err);
+int analyseRevision(pSession session, pCompiler compiler, const char *fileName);
+void freeSession(pSession session);
+
+/*lexer.l中定义*/
+bool scanMappedFile(pCompiler compiler, const char *fileName);
+void closeMappedFile(pCompiler compiler);
+#endif
@@ -0,0 +1,47 @@
+import sys
+
+import benchutil
+
+# 语义错误测试：生成一个错误很多的文件，每条语句用了好几次没有定义的变量，同一行同一种错误只应该输出一次。
+# 中间代码生成还处理不了没有定义的变量，所以不加限制时用--incremental只做语义分析，再加上--max-errors运行，
+# 打印输出的错误个数和总耗时。错误先放在内存里最后一次写出去，耗时不应该被逐条写stdout拖慢；
+# 加了限制以后语义分析提前结束，也不再生成中间代码；--jobs时各个线程也要在错误够了以后停下来，不能把函数体都分析完
+# 用法：python3 errbench.py [函数个数] [每个函数的语句数] [次数] [错误个数的上限]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+stmts = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+rounds = int(sys.argv[3]) if len(sys.argv) > 3 else 3
+limit = int(sys.argv[4]) if len(sys.argv) > 4 else 100
+
+
+def generate(f):
+    for fn in range(funcs):
+        f.write('int fn%d(int p)\n{\nint a;\n' % fn)
+        for s in range(stmts):
+            f.write('a = u%d + u%d * p + u%d;\n' % (s, s, s))
+        f.write('return a;\n}\n')
+    f.write('int main()\n{\nreturn 0;\n}\n')
+
+
+def run(source, options):
+    result, elapsed = benchutil.timed(['--time'] + options + [source], text=True)
+    if result.returncode != 0:
+        print('%s failed with %d' % (' '.join(options), result.returncode))
+        sys.exit(1)
+    lines = result.stdout.splitlines()
+    errors = sum(1 for line in lines if line.startswith('Error type'))
+    duplicated = errors - len(set(' '.join(line.split()[:6]) for line in lines if line.startswith('Error type')))
+    # --incremental的--time按版本打印，没有单独的semantic一行
+    semantic = benchutil.phases(result.stderr).get('semantic')
+    return elapsed, errors, duplicated, semantic
+
+
+source = benchutil.generate('/tmp/errbench_%d_%d.cmm' % (funcs, stmts), generate)
+print('%d functions, %d statements each, %d rounds, median' % (funcs, stmts, rounds))
+for options in (['--incremental'], ['--max-errors=%d' % limit], ['--mmap', '--max-errors=%d' % limit],
+                ['--jobs=4', '--max-errors=%d' % limit]):
+    elapsed, errors, duplicated, semantic = benchutil.median((run(source, options) for i in range(rounds)), key=lambda run: run[0])
+    if duplicated:
+        print('%d duplicated (line, error type) pairs' % duplicated)
+        sys.exit(1)
+    print('%-28s %10.3f ms, %d errors%s' %
+          (' '.join(options), elapsed, errors, ', semantic %.3f ms' % semantic if semantic is not None else ''))
@@ -0,0 +1,37 @@
+import random
+import sys
+
+# 生成一个很大的c--程序用来测性能，用法：python3 gencmm.py 函数个数 > big.cmm
+# 每个函数都有数组、循环、条件表达式和函数调用，覆盖语义分析和中间代码生成的主要分支
+random.seed(1)
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+out = []
+for f in range(n):
+    p = 'f%d_' % f
+    if f > 0 and f % 3 == 0:
+        out.append('int fn%d(int %sa, int %sb[4]) {' % (f, p, p))
+        out.append('  int %sx = %sa + %sb[1];' % (p, p, p))
+    else:
+        out.append('int fn%d(int %sa) {' % (f, p))
+        out.append('  int %sx = %sa * 2;' % (p, p))
+    out.append('  int %sarr[4][3];' % p)
+    out.append('  int %si = 0, %sj;' % (p, p))
+    out.append('  int %sv[4];' % p)
+    out.append('  while (%si < 4) {' % p)
+    out.append('    %sj = 0;' % p)
+    out.append('    while (%sj < 3) { %sarr[%si][%sj] = %si * %sj + 0x1F - 017; %sj = %sj + 1; }' % ((p,) * 8))
+    out.append('    %sv[%si] = %si;' % (p, p, p))
+    out.append('    if (%si > 2 && %sx != 3 || !(%si == 1)) %sx = %sx - %sarr[%si][1]; else { %sx = -%sx; }' % ((p,) * 9))
+    out.append('    %si = %si + 1;' % (p, p))
+    out.append('  }')
+    if f > 0:
+        g = random.randrange(f)
+        if g > 0 and g % 3 == 0:
+            out.append('  %sx = %sx + fn%d(%si, %sv);' % (p, p, g, p, p))
+        else:
+            out.append('  %sx = %sx + fn%d(%si);' % (p, p, g, p))
+    out.append('  write(%sx);' % p)
+    out.append('  return %sx;' % p)
+    out.append('}')
+out.append('int main() { int m = read(); write(fn%d(m)); return 0; }' % (n - 1))
+print('\n'.join(out))
@@ -0,0 +1,72 @@
+import argparse
+import random
+import sys
+
+# 生成测词法分析速度用的c--语料，每一行都是合法的c--，也能整体通过语法分析
+# 用法：python3 gencorpus.py --size 16 --line-length 4000 > corpus.cmm
+parser = argparse.ArgumentParser()
+parser.add_argument('--size', type=float, default=16, help='大约生成多少MB')
+parser.add_argument('--line-length', type=int, default=120, help='表达式语句的最大长度，用来测长行')
+parser.add_argument('--ident-length', type=int, default=12, help='标识符的平均长度')
+parser.add_argument('--comment-ratio', type=float, default=0.2, help='带注释的语句占的比例')
+parser.add_argument('--seed', type=int, default=1)
+args = parser.parse_args()
+random.seed(args.seed)
+
+letters = 'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_'
+digits = letters + '0123456789'
+
+
+def ident():
+    length = max(1, int(random.gauss(args.ident_length, args.ident_length / 3)))
+    return random.choice(letters) + ''.join(random.choice(digits) for _ in range(length - 1))
+
+
+def literal():
+    value = random.randrange(1 << 16)
+    base = random.randrange(3)
+    if base == 0:
+        return str(value)
+    elif base == 1:
+        return '0%o' % value if value else '0'
+    return random.choice(['0x%x', '0X%X']) % value
+
+
+def comment():
+    # c--的块注释不能嵌套，这里在块注释里放/*和//，测试扫描注释时的回溯
+    kind = random.randrange(3)
+    if kind == 0:
+        return '// %s /* %s */ %s' % (ident(), ident(), literal())
+    elif kind == 1:
+        return '/* %s // %s /* %s ** / */' % (ident(), literal(), ident())
+    return '/*\n   %s * %s\n   // %s\n*/' % (ident(), ident(), ident())
+
+
+def expression(names, limit):
+    text = random.choice(names)
+    while len(text) < limit:
+        operand = random.choice(names) if random.randrange(2) else literal()
+        text += ' %s %s' % (random.choice('+-*/'), operand)
+    return text
+
+
+limit = int(args.size * 1024 * 1024)
+written = 0
+count = 0
+out = sys.stdout
+while written < limit:
+    names = [ident() + '_%d' % count for _ in range(4)]
+    lines = ['int f%d(int %s)' % (count, names[0]), '{']
+    lines.append('    int %s, %s = %s, %s[%s];' % (names[1], names[2], literal(), names[3], literal()))
+    for _ in range(8):
+        if random.random() < args.comment_ratio:
+            lines.append('    ' + comment())
+        lines.append('    %s = %s;' % (names[1], expression(names[:3], random.randrange(args.line_length))))
+        lines.append('    %s[%s] = %s;' % (names[3], literal(), names[1]))
+    lines.append('    return %s;' % names[1])
+    lines.append('}')
+    text = '\n'.join(lines) + '\n'
+    out.write(text)
+    written += len(text)
+    count += 1
+out.write('int main()\n{\n    return 0;\n}\n')
@@ -0,0 +1,79 @@
+import sys
+
+import benchutil
+
+# 增量分析测试：生成一个有很多函数的文件，再做出三个修改过的版本，用--incremental依次分析。
+# 第0版从头分析；第1版只改了中间一个函数的函数体，第2版在那个函数体里多写了一行，后面的函数都往下挪了一行，
+# 这两版应该只重新分析一个函数体，语义分析的耗时只和这个函数有关；
+# 第3版加了一个全局变量，全局作用域变了，要重新建立全局作用域再分析所有的函数体，耗时和第0版差不多。
+# 每一版的语义错误都应该和对这一版单独用--stream编译时一样。
+# 最后把这几版反复分析很多遍，用--mem-stats看每一版以后类型表的大小，每一遍都应该和第一遍一样，不能随着版本数增长
+# 用法：python3 incbench.py [函数个数] [每个函数的语句数] [次数] [传给main的其他参数]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+stmts = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+rounds = int(sys.argv[3]) if len(sys.argv) > 3 else 3
+options = sys.argv[4:]
+edited = funcs // 2
+
+
+def generate(f, revision):
+    f.write('struct Point\n{\nint x;\nint y;\n};\n')
+    f.write('struct Point origin;\n')
+    for fn in range(funcs):
+        f.write('int fn%d(int p, struct Point q)\n{\n' % fn)
+        f.write('int a%d, b%d;\n' % (fn, fn))
+        if fn == edited and revision >= 2:
+            f.write('\n')
+        for s in range(stmts):
+            value = s + (1 if fn == edited and revision >= 1 else 0)
+            f.write('a%d = b%d + q.x * %d + origin.y;\n' % (fn, fn, value))
+        if fn == edited and revision >= 1:
+            # 故意写错一个，这一版应该多出一个语义错误
+            f.write('b%d = q;\n' % fn)
+        f.write('return a%d + p;\n}\n' % fn)
+    if revision >= 3:
+        f.write('int added;\n')
+    f.write('int main()\n{\nwrite(fn0(read(), origin));\nreturn 0;\n}\n')
+
+
+def errors(output):
+    return [line for line in output.splitlines() if line.startswith('Error type')]
+
+
+sources = []
+for revision in range(4):
+    sources.append(benchutil.generate('/tmp/incbench_%d_%d_%d.cmm' % (funcs, stmts, revision),
+                                      lambda f: generate(f, revision)))
+
+expected = []
+for source in sources:
+    result = benchutil.run(['--stream', source], text=True)
+    expected += errors(result.stdout)
+
+print('%d functions, %d statements each, %d rounds, median, %s' % (funcs, stmts, rounds, ' '.join(options)))
+times = [[] for source in sources]
+summaries = [''] * len(sources)
+for i in range(rounds):
+    result = benchutil.run(['--incremental', '--time'] + options + sources, text=True)
+    if errors(result.stdout) != expected:
+        print('semantic errors differ from --stream')
+        sys.exit(1)
+    for line in result.stderr.splitlines():
+        if line.startswith('revision'):
+            revision = int(line.split()[1].rstrip(':'))
+            times[revision].append(float(line.split('semantic')[1].split()[0]))
+            summaries[revision] = line.split(' ms, ')[-1]
+for revision in range(len(sources)):
+    print('revision %d: semantic %10.3f ms, %s' % (revision, benchutil.median(times[revision]), summaries[revision]))
+
+cycles = 20
+result = benchutil.run(['--incremental', '--mem-stats'] + options + sources * cycles, text=True)
+sizes = [line.split('types: ')[1] for line in result.stderr.splitlines() if line.startswith('revision') and 'types: ' in line]
+if len(sizes) != len(sources) * cycles:
+    print('--mem-stats printed %d type table sizes for %d revisions' % (len(sizes), len(sources) * cycles))
+    sys.exit(1)
+if sizes[-len(sources):] != sizes[:len(sources)]:
+    print('type table grows over revisions: %s after the first cycle, %s after the last' %
+          (sizes[len(sources) - 1], sizes[-1]))
+    sys.exit(1)
+print('%d revisions: type table stays at %s' % (len(sizes), sizes[-1]))
@@ -1,126 +1,43 @@
-#include "inter.h"
-
-pInterCodesWrap interCodesWrap;
+#include "compiler.h"
 
 /**
- * @brief 产生一个运算对象
+ * @brief 产生一个运算对象，运算对象只有8个字节，直接按值传递和复制
  *
  * @param kind 什么类型的运算分量
- * @param value 运算分量可能是char *也可能是int，但都只有一个，因此使用void*
+ * @param value 常量的值，或者临时变量、标号的编号，有名字的运算分量用newNamedOperand
+ * @return Operand
  */
-pOperand newOperand(int kind, void *value)
+Operand newOperand(int kind, int value)
 {
-    //突发奇想可以用宏来解决内存申请
-    //比如glibc里面就有__malloc_hook
-    pOperand p = malloc(sizeof(struct Operand_));
-    if (!p)
-    {
-        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Operand_));
-        exit(EXIT_FAILURE);
-    }
-    p->kind = kind;
-    assert(kind >= 0 && kind < 6);
-    switch (kind)
-    {
-    case OPERAND_CONSTANT:
-        p->u.value = *((int *)value);
-        break;
-    case OPERAND_VARIABLE:
-    case OPERAND_FUNCTION:
-    case OPERAND_ADDRESS:
-    case OPERAND_RELOP:
-    case OPERAND_LABEL:
-        p->u.name = (char *)value;
-        break;
-    }
-    return p;
+    assert(kind >= 0 && kind <= OPERAND_TEMP);
+    Operand operand;
+    operand.kind = kind;
+    operand.u.value = value;
+    return operand;
 }
 
-pOperand copyOperand(pOperand p)
-{
-    pOperand newP = malloc(sizeof(struct Operand_));
-    if (!newP)
-    {
-        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Operand_));
-        exit(EXIT_FAILURE);
-    }
-    int kind = p->kind;
-    newP->kind = kind;
-    assert(kind >= 0 && kind < 6);
-    switch (kind)
-    {
-    case OPERAND_CONSTANT:
-        newP->u.value = p->u.value;
-        break;
-    case OPERAND_VARIABLE:
-    case OPERAND_FUNCTION:
-    case OPERAND_ADDRESS:
-    case OPERAND_RELOP:
-    case OPERAND_LABEL:
-        newP->u.name = newString(p->u.name);
-        break;
-    }
-    return newP;
-}
-
-void updateOperand(pOperand p, int kind, void *value)
+/**
+ * @brief 产生一个有名字的运算对象，变量、函数、地址和逻辑运算符记的是名字在驻留池中的编号
+ *
+ * @param kind 什么类型的运算分量
+ * @param name 驻留过的名字
+ * @return Operand
+ */
+Operand newNamedOperand(int kind, const char *name)
 {
-    assert(p != NULL);
-    assert(kind >= 0 && kind < 6);
-    p->kind = kind;
-    switch (kind)
-    {
-    case OPERAND_CONSTANT:
-        p->u.value = *((int *)value);
-        break;
-    case OPERAND_VARIABLE:
-    case OPERAND_FUNCTION:
-    case OPERAND_ADDRESS:
-    case OPERAND_RELOP:
-    case OPERAND_LABEL:
-        FREE(p->u.name);
-        p->u.name = (char *)value;
-        break;
-    }
-}
-
-void freeOperand(pOperand p)
-{
-    if (p == NULL)
-        return;
-    assert(p->kind >= 0 && p->kind < 6);
-    switch (p->kind)
-    {
-    case OPERAND_CONSTANT:
-        break;
-    case OPERAND_VARIABLE:
-    case OPERAND_FUNCTION:
-    case OPERAND_ADDRESS:
-    case OPERAND_RELOP:
-    case OPERAND_LABEL:
-        FREE(p->u.name);
-        break;
-    }
-    free(p);
+    assert(getInternId(name) != 0);
+    return newOperand(kind, getInternId(name));
 }
 
 /**
- * @brief 产生一条中间代码
+ * @brief 按照kind从参数表中取出运算分量，复制到中间代码里面
  *
+ * @param p 要填写的中间代码
  * @param kind 类型
- * @param ... 不同的中间代码需要的参数不同
- * @return pInterCode
+ * @param vaList 不同的中间代码需要的参数不同，运算分量都是按值传递的Operand，DEC的大小是int
  */
-pInterCode newInterCode(int kind, int argc, ...)
+static void fillInterCode(pInterCode p, int kind, va_list vaList)
 {
-    pInterCode p = malloc(sizeof(struct InterCode_));
-    if (!p)
-    {
-        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Operand_));
-        exit(EXIT_FAILURE);
-    }
-    va_list vaList;
-    va_start(vaList, argc);
     assert(kind >= 0 && kind < 19);
     p->kind = kind;
     switch (kind)
@@ -133,352 +50,650 @@ pInterCode newInterCode(int kind, int argc, ...)
     case IR_PARAM:
     case IR_READ:
     case IR_WRITE:
-        p->u.oneOp.op = copyOperand(va_arg(vaList, pOperand));
+        p->u.oneOp.op = va_arg(vaList, Operand);
         break;
     case IR_ASSIGN:
     case IR_GET_ADDR:
     case IR_READ_ADDR:
     case IR_WRITE_ADDR:
     case IR_CALL:
-        p->u.assign.left = copyOperand(va_arg(vaList, pOperand));
-        p->u.assign.right = copyOperand(va_arg(vaList, pOperand));
+        p->u.assign.left = va_arg(vaList, Operand);
+        p->u.assign.right = va_arg(vaList, Operand);
         break;
     case IR_ADD:
     case IR_SUB:
     case IR_MUL:
     case IR_DIV:
-        p->u.binOp.result = copyOperand(va_arg(vaList, pOperand));
-        p->u.binOp.op1 = copyOperand(va_arg(vaList, pOperand));
-        p->u.binOp.op2 = copyOperand(va_arg(vaList, pOperand));
+        p->u.binOp.result = va_arg(vaList, Operand);
+        p->u.binOp.op1 = va_arg(vaList, Operand);
+        p->u.binOp.op2 = va_arg(vaList, Operand);
         break;
     case IR_DEC:
-        p->u.dec.op = copyOperand(va_arg(vaList, pOperand));
+        p->u.dec.op = va_arg(vaList, Operand);
         p->u.dec.size = va_arg(vaList, int);
         break;
     case IR_IF_GOTO:
-        p->u.ifGoto.x = copyOperand(va_arg(vaList, pOperand));
-        p->u.ifGoto.relop = copyOperand(va_arg(vaList, pOperand));
-        p->u.ifGoto.y = copyOperand(va_arg(vaList, pOperand));
-        p->u.ifGoto.z = copyOperand(va_arg(vaList, pOperand));
+        p->u.ifGoto.x = va_arg(vaList, Operand);
+        p->u.ifGoto.relop = va_arg(vaList, Operand);
+        p->u.ifGoto.y = va_arg(vaList, Operand);
+        p->u.ifGoto.z = va_arg(vaList, Operand);
         break;
     }
-    return p;
 }
 
-void freeInterCode(pInterCode p)
+/**
+ * @brief 创建中间代码序列
+ *
+ * @return pInterCodesWrap
+ */
+pInterCodesWrap newInterCodesWrap()
 {
-    assert(p != NULL);
-    assert(p->kind >= 0 && p->kind < 19);
-    switch (p->kind)
+    pInterCodesWrap p = calloc(1, sizeof(struct InterCodesWrap_));
+    if (!p)
     {
-    case IR_LABEL:
-    case IR_FUNCTION:
-    case IR_GOTO:
-    case IR_RETURN:
-    case IR_ARG:
-    case IR_PARAM:
-    case IR_READ:
-    case IR_WRITE:
-        freeOperand(p->u.oneOp.op);
-        break;
-    case IR_ASSIGN:
-    case IR_GET_ADDR:
-    case IR_READ_ADDR:
-    case IR_WRITE_ADDR:
-    case IR_CALL:
-        freeOperand(p->u.assign.left);
-        freeOperand(p->u.assign.right);
-        break;
-    case IR_ADD:
-    case IR_SUB:
-    case IR_MUL:
-    case IR_DIV:
-        freeOperand(p->u.binOp.result);
-        freeOperand(p->u.binOp.op1);
-        freeOperand(p->u.binOp.op2);
-        break;
-    case IR_DEC:
-        freeOperand(p->u.dec.op);
-        break;
-    case IR_IF_GOTO:
-        freeOperand(p->u.ifGoto.x);
-        freeOperand(p->u.ifGoto.relop);
-        freeOperand(p->u.ifGoto.y);
-        freeOperand(p->u.ifGoto.z);
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct InterCodesWrap_));
+        exit(EXIT_FAILURE);
     }
-    FREE(p);
+    return p;
 }
 
 /**
- * @brief 新建中间代码的头
+ * @brief 保证序列中还能再放n条中间代码，不够时扩容到两倍，指向中间代码的指针随之失效
  *
- * @param code 中间代码的体
- * @return pInterCodes
+ * @param codes 中间代码序列
+ * @param n 要放的条数
  */
-pInterCodes newInterCodes(pInterCode interCode)
+static void reserveInterCodes(pInterCodesWrap codes, unsigned n)
 {
-    pInterCodes p = (pInterCodes)malloc(sizeof(struct InterCodes_));
-    if (!p)
+    if (codes->count + n <= codes->capacity)
+        return;
+    unsigned capacity = codes->capacity ? codes->capacity * 2 : 64;
+    while (capacity < codes->count + n)
+        capacity *= 2;
+    codes->codes = realloc(codes->codes, capacity * sizeof(struct InterCode_));
+    if (!codes->codes)
     {
-        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Operand_));
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, capacity * sizeof(struct InterCode_));
         exit(EXIT_FAILURE);
     }
-    p->code = interCode;
-    p->prev = NULL;
-    p->next = NULL;
+    codes->capacity = capacity;
 }
 
-void freeInterCodes(pInterCodes p)
+/**
+ * @brief 在标号表中记下标号所在的中间代码的下标
+ *
+ * @param codes 中间代码序列
+ * @param label 标号的编号，见newLabel
+ * @param index 下标，-1表示标号不在序列中
+ */
+static void setLabelIndex(pInterCodesWrap codes, int label, int index)
 {
-    assert(p != NULL);
-    freeInterCode(p->code);
-    free(p);
+    assert(label >= codes->labelBase);
+    unsigned slot = label - codes->labelBase;
+    if (slot >= codes->labelCapacity)
+    {
+        unsigned capacity = codes->labelCapacity ? codes->labelCapacity * 2 : 16;
+        while (capacity <= slot)
+            capacity *= 2;
+        codes->labels = realloc(codes->labels, capacity * sizeof(int));
+        assert(codes->labels != NULL);
+        codes->labelCapacity = capacity;
+    }
+    while (codes->labelCount <= slot)
+        codes->labels[codes->labelCount++] = -1;
+    codes->labels[slot] = index;
 }
 
 /**
- * @brief 创建中间代码头的包装
+ * @brief 标号所在的中间代码
  *
- * @return pInterCodesWrap
+ * @param codes 中间代码序列
+ * @param label 标号的编号
+ * @return int 中间代码的下标，标号不在序列中时为-1
  */
-pInterCodesWrap newInterCodesWrap()
+int getLabelIndex(pInterCodesWrap codes, int label)
 {
-    pInterCodesWrap p = malloc(sizeof(struct InterCodesWrap_));
-    if (!p)
+    if (label < codes->labelBase || (unsigned)(label - codes->labelBase) >= codes->labelCount)
+        return -1;
+    return codes->labels[label - codes->labelBase];
+}
+
+/**
+ * @brief 把标号表中在from及以后的下标都加上delta，插入和删除中间代码以后调用
+ *
+ * @param codes 中间代码序列
+ * @param from 第一条挪动了的中间代码原来的下标
+ * @param delta 挪动的距离
+ */
+static void shiftLabelIndexes(pInterCodesWrap codes, unsigned from, int delta)
+{
+    for (unsigned i = 0; i < codes->labelCount; i++)
     {
-        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(struct Operand_));
-        exit(EXIT_FAILURE);
+        if (codes->labels[i] >= (int)from)
+            codes->labels[i] += delta;
     }
-    p->head = NULL;
-    p->tail = NULL;
-    p->labelNum = 0;
-    p->tempVarNum = 0;
-    return p;
 }
 
 /**
- * @brief 将中间代码的头加到包装中
+ * @brief 在序列的末尾加一条中间代码，运算分量按值复制到中间代码里面
+ *
+ * @param codes 中间代码序列
+ * @param kind 类型
+ * @param argc 参数个数
+ * @param ... 不同的中间代码需要的参数不同
+ * @return unsigned 新的中间代码的下标
+ */
+unsigned addInterCode(pInterCodesWrap codes, int kind, int argc, ...)
+{
+    reserveInterCodes(codes, 1);
+    va_list vaList;
+    va_start(vaList, argc);
+    pInterCode p = &codes->codes[codes->count];
+    fillInterCode(p, kind, vaList);
+    va_end(vaList);
+    if (kind == IR_LABEL)
+        setLabelIndex(codes, p->u.oneOp.op.u.id, codes->count);
+    return codes->count++;
+}
+
+/**
+ * @brief 在第index条中间代码之前插入一条，后面的中间代码都往后挪一个位置，优化时用
+ *
+ * @param codes 中间代码序列
+ * @param index 插入的位置，等于count时和addInterCode一样
+ * @param kind 类型
+ * @param argc 参数个数
+ * @param ... 不同的中间代码需要的参数不同
+ */
+void insertInterCode(pInterCodesWrap codes, unsigned index, int kind, int argc, ...)
+{
+    assert(index <= codes->count);
+    reserveInterCodes(codes, 1);
+    memmove(&codes->codes[index + 1], &codes->codes[index], (codes->count - index) * sizeof(struct InterCode_));
+    codes->count++;
+    shiftLabelIndexes(codes, index, 1);
+    va_list vaList;
+    va_start(vaList, argc);
+    fillInterCode(&codes->codes[index], kind, vaList);
+    va_end(vaList);
+    if (kind == IR_LABEL)
+        setLabelIndex(codes, codes->codes[index].u.oneOp.op.u.id, index);
+}
+
+/**
+ * @brief 删除从index开始的n条中间代码，后面的中间代码往前挪，被删掉的标号在标号表中变成-1
  *
- * @param codes 中间代码结构包装
- * @param newcode 新的中间代码的头
+ * @param codes 中间代码序列
+ * @param index 第一条要删的中间代码
+ * @param n 条数
  */
-void addInterCodesToWrap(pInterCodesWrap codes, pInterCodes newcode)
+void removeInterCodes(pInterCodesWrap codes, unsigned index, unsigned n)
 {
-    if (codes->head == NULL)
+    assert(index + n <= codes->count);
+    for (unsigned i = index; i < index + n; i++)
     {
-        codes->head = newcode;
-        codes->tail = newcode;
+        if (codes->codes[i].kind == IR_LABEL)
+            setLabelIndex(codes, codes->codes[i].u.oneOp.op.u.id, -1);
     }
-    else
+    memmove(&codes->codes[index], &codes->codes[index + n], (codes->count - index - n) * sizeof(struct InterCode_));
+    codes->count -= n;
+    shiftLabelIndexes(codes, index + n, -(int)n);
+}
+
+/**
+ * @brief 一次删掉所有removed[i]为true的中间代码，剩下的保持原来的顺序，然后重建标号表。
+ * 优化一遍通常会删很多条，逐条调用removeInterCodes是平方的，这里只扫一遍
+ *
+ * @param codes 中间代码序列
+ * @param removed 长度为count，标出了要删的中间代码
+ */
+void compactInterCodes(pInterCodesWrap codes, const bool *removed)
+{
+    unsigned kept = 0;
+    for (unsigned i = 0; i < codes->labelCount; i++)
+        codes->labels[i] = -1;
+    for (unsigned i = 0; i < codes->count; i++)
+    {
+        if (removed[i])
+            continue;
+        if (kept != i)
+            codes->codes[kept] = codes->codes[i];
+        if (codes->codes[kept].kind == IR_LABEL)
+            setLabelIndex(codes, codes->codes[kept].u.oneOp.op.u.id, kept);
+        kept++;
+    }
+    codes->count = kept;
+}
+
+/**
+ * @brief 临时变量和标号的编号加上偏移，其他运算分量不变
+ *
+ * @param op 运算分量
+ * @param tempBase 临时变量编号的偏移
+ * @param labelBase 标号编号的偏移
+ */
+static inline void shiftOperand(struct Operand_ *op, int tempBase, int labelBase)
+{
+    if (op->kind == OPERAND_TEMP)
+        op->u.id += tempBase;
+    else if (op->kind == OPERAND_LABEL)
+        op->u.id += labelBase;
+}
+
+/**
+ * @brief 把另一个序列的中间代码接到末尾，它的临时变量和标号接着这个序列的编号往后排。
+ * 一次性编译用--jobs时各个函数在不同的线程中翻译到自己的序列里，编号都从0开始，
+ * 按源程序中的顺序接起来以后和在一个序列中依次翻译时完全一样
+ *
+ * @param codes 中间代码序列
+ * @param part 接到后面的序列，编号从0开始，不会被修改
+ */
+void appendInterCodes(pInterCodesWrap codes, pInterCodesWrap part)
+{
+    int tempBase = codes->tempVarNum, labelBase = codes->labelNum;
+    reserveInterCodes(codes, part->count);
+    for (unsigned i = 0; i < part->count; i++)
     {
-        codes->tail->next = newcode;
-        newcode->prev = codes->tail;
-        codes->tail = newcode;
+        pInterCode p = &codes->codes[codes->count];
+        *p = part->codes[i];
+        switch (p->kind)
+        {
+        case IR_ASSIGN:
+        case IR_GET_ADDR:
+        case IR_READ_ADDR:
+        case IR_WRITE_ADDR:
+        case IR_CALL:
+            shiftOperand(&p->u.assign.left, tempBase, labelBase);
+            shiftOperand(&p->u.assign.right, tempBase, labelBase);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+            shiftOperand(&p->u.binOp.result, tempBase, labelBase);
+            shiftOperand(&p->u.binOp.op1, tempBase, labelBase);
+            shiftOperand(&p->u.binOp.op2, tempBase, labelBase);
+            break;
+        case IR_IF_GOTO:
+            shiftOperand(&p->u.ifGoto.x, tempBase, labelBase);
+            shiftOperand(&p->u.ifGoto.y, tempBase, labelBase);
+            shiftOperand(&p->u.ifGoto.z, tempBase, labelBase);
+            break;
+        case IR_DEC:
+            shiftOperand(&p->u.dec.op, tempBase, labelBase);
+            break;
+        default:
+            shiftOperand(&p->u.oneOp.op, tempBase, labelBase);
+            break;
+        }
+        if (p->kind == IR_LABEL)
+            setLabelIndex(codes, p->u.oneOp.op.u.id, codes->count);
+        codes->count++;
     }
+    codes->tempVarNum += part->tempVarNum;
+    codes->labelNum += part->labelNum;
 }
 
 /**
- * @brief 清除中间代码结构包装
+ * @brief 删掉已经生成的中间代码，但是保留临时变量和标号的计数，内存也留着下次用，
+ * 流式编译时每输出一个函数就清空一次，后面的函数接着编号
  *
- * @param codes 中间代码结构包装
+ * @param codes 中间代码序列
  */
+void clearInterCodesWrap(pInterCodesWrap codes)
+{
+    assert(codes != NULL);
+    codes->count = 0;
+    //以后的标号编号都不小于labelNum，标号表从这里重新开始
+    codes->labelBase = codes->labelNum;
+    codes->labelCount = 0;
+}
+
 void freeInterCodesWrap(pInterCodesWrap codes)
 {
     assert(codes != NULL);
-    pInterCodes tobeFreed = codes->head;
-    while (tobeFreed != NULL)
+    free(codes->codes);
+    free(codes->labels);
+    free(codes);
+}
+
+/**
+ * @brief 新的临时变量，只记编号，名字tN在输出时才拼出来
+ *
+ * @return Operand
+ */
+Operand newTemp(pCompiler compiler)
+{
+    return newOperand(OPERAND_TEMP, compiler->interCodesWrap->tempVarNum++);
+}
+
+/**
+ * @brief 新的标号，只记编号，名字labelN在输出时才拼出来
+ *
+ * @return Operand
+ */
+Operand newLabel(pCompiler compiler)
+{
+    return newOperand(OPERAND_LABEL, compiler->interCodesWrap->labelNum++);
+}
+
+/**
+ * @brief 表达式的值是不是放在place指向的内存中，数组元素和结构体的域翻译出来的都是地址，用它的值之前要先读一次
+ *
+ * @param exp
+ * @return true
+ * @return false
+ */
+static bool isAddressExp(pNode exp)
+{
+    return exp->production == EXP_ARRAY || exp->production == EXP_DOT;
+}
+
+static pType getExpType(pCompiler compiler, pNode exp);
+
+/**
+ * @brief 结构体的域，有语义错误的程序也会翻译，所以找不到时返回NULL
+ *
+ * @param exp Exp DOT ID
+ * @return pFieldList
+ */
+static pFieldList getDotField(pCompiler compiler, pNode exp)
+{
+    pNode child = getChild(exp);
+    pType type = getExpType(compiler, child);
+    if (type == NULL || type->kind != STRUCTURE || type->u.structure.fieldIndex == NULL)
+        return NULL;
+    return getStructField(type, getNodeValue(compiler, getBrother(getBrother(child))));
+}
+
+/**
+ * @brief 左值表达式的类型，沿着变量、数组和结构体的域找下去
+ *
+ * @param exp ID、数组元素或者结构体的域
+ * @return pType 其他的表达式和有语义错误的表达式返回NULL
+ */
+static pType getExpType(pCompiler compiler, pNode exp)
+{
+    pNode child = getChild(exp);
+    switch (exp->production)
+    {
+    case EXP_ID:
     {
-        pInterCodes temp = tobeFreed;
-        tobeFreed = tobeFreed->next;
-        freeInterCodes(temp);
+        pTableItem item = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
+        return item ? item->field->type : NULL;
+    }
+    case EXP_ARRAY:
+    {
+        pType type = getExpType(compiler, child);
+        return type && type->kind == ARRAY ? type->u.array.elem : NULL;
+    }
+    case EXP_DOT:
+    {
+        pFieldList field = getDotField(compiler, exp);
+        return field ? field->type : NULL;
+    }
+    case EXP_PAREN:
+        return getExpType(compiler, getBrother(child));
+    default:
+        return NULL;
     }
-    codes->head = NULL;
-    codes->tail = NULL;
-    free(codes);
 }
 
-pOperand newTemp()
+/**
+ * @brief 中间代码的输出缓冲区，格式化都在这里做，攒满了再一次写出去
+ *
+ */
+typedef struct IRWriter_
 {
-    char tName[10] = {0};
-    sprintf(tName, "t%d", interCodesWrap->tempVarNum);
-    interCodesWrap->tempVarNum++;
-    pOperand temp = newOperand(OPERAND_VARIABLE, newString(tName));
-    return temp;
+    char *buffer;
+    size_t used;
+    FILE *out;
+} IRWriter;
+
+#define IR_WRITER_SIZE (1 << 16) //缓冲区大小，64KB
+#define IR_LINE_RESERVE 128      //每写一个字符串都保证缓冲区中还剩这么多字节，够写后面的整数
+
+/**
+ * @brief 把缓冲区中的内容写出去
+ *
+ * @param writer
+ */
+static void flushIRWriter(IRWriter *writer)
+{
+    if (writer->used)
+        fwrite(writer->buffer, 1, writer->used, writer->out);
+    writer->used = 0;
 }
 
-pOperand newLabel()
+/**
+ * @brief 写一个字符串，写完以后缓冲区中至少还剩IR_LINE_RESERVE个字节，比缓冲区还长的名字直接写出去
+ *
+ * @param writer
+ * @param str 字符串
+ * @param length 长度
+ */
+static inline void writeString(IRWriter *writer, const char *str, size_t length)
 {
-    char lName[10] = {0};
-    sprintf(lName, "label%d", interCodesWrap->labelNum);
-    interCodesWrap->labelNum++;
-    pOperand temp = newOperand(OPERAND_LABEL, newString(lName));
-    return temp;
+    if (writer->used + length > IR_WRITER_SIZE - IR_LINE_RESERVE)
+    {
+        flushIRWriter(writer);
+        if (length > IR_WRITER_SIZE - IR_LINE_RESERVE)
+        {
+            fwrite(str, 1, length, writer->out);
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->used, str, length);
+    writer->used += length;
 }
 
+/*写字符串常量，长度在编译时就知道了*/
+#define WRITE_LITERAL(writer, literal) writeString(writer, literal, sizeof(literal) - 1)
+
 /**
- * @brief 打印运算分量到终端
+ * @brief 写一个十进制整数，先倒着写到临时数组里再复制过去，不经过printf
  *
+ * @param writer 前面总是刚写过一个字符串，缓冲区中至少还有IR_LINE_RESERVE个字节
+ * @param value 整数
+ */
+static inline void writeInt(IRWriter *writer, int value)
+{
+    char digits[12];
+    int n = 0;
+    //INT_MIN取负会溢出，用无符号数算
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    do
+    {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    char *p = writer->buffer + writer->used;
+    if (value < 0)
+        *p++ = '-';
+    while (n)
+        *p++ = digits[--n];
+    writer->used = p - writer->buffer;
+}
+
+/**
+ * @brief 写一个运算分量，临时变量和标号的名字在这里才拼出来
+ *
+ * @param writer
+ * @param getName 有名字的运算分量用它按编号取名字
+ * @param names 交给getName的名字表
  * @param operand 运算分量
  */
-void printOperand(pOperand operand)
+static void writeOperand(IRWriter *writer, OperandNameFunc getName, const void *names, const struct Operand_ *operand)
 {
-    // assert(operand != NULL);
     switch (operand->kind)
     {
     case OPERAND_CONSTANT:
-        printf("#%d", operand->u.value);
+        WRITE_LITERAL(writer, "#");
+        writeInt(writer, operand->u.value);
+        break;
+    case OPERAND_TEMP:
+        WRITE_LITERAL(writer, "t");
+        writeInt(writer, operand->u.id);
+        break;
+    case OPERAND_LABEL:
+        WRITE_LITERAL(writer, "label");
+        writeInt(writer, operand->u.id);
         break;
     case OPERAND_VARIABLE:
     case OPERAND_FUNCTION:
     case OPERAND_ADDRESS:
     case OPERAND_RELOP:
-    case OPERAND_LABEL:
-        printf("%s", operand->u.name);
+    {
+        uint32_t length;
+        const char *name = getName(names, operand->u.id, &length);
+        writeString(writer, name, length);
         break;
     }
+    }
 }
 
-unsigned int getSize(pType type)
+/**
+ * @brief 按编号从驻留池中取名字，printInterCodes用
+ *
+ * @param names 驻留池
+ * @param id 名字在驻留池中的编号
+ * @param length 名字的长度写到这里
+ * @return const char*
+ */
+static const char *getInternName(const void *names, int id, uint32_t *length)
 {
-    //事实上这里的代码是有严重的风险的，因为数组的elem不一定位NULL吧
-    if (type == NULL)
-        return 0;
-    else if (type->kind == BASIC)
-        return 4;
-    else if (type->kind == ARRAY)
-        return type->u.array.size * getSize(type->u.array.elem);
-    // else if (type->kind == STRUCTURE)
-    // {
-    //     int size = 0;
-    //     pFieldList temp = type->u.structure.structureField;
-    //     while (temp)
-    //     {
-    //         size += getSize(temp->type);
-    //         temp = temp->tail;
-    //     }
-    //     return size;
-    // }
-    return 0;
+    const char *name = getInternString((pInternTable)names, id);
+    *length = getInternLength(name);
+    return name;
 }
 
 /**
- * @brief 打印中间代码到终端，如果需要打印到文件，可以妥善利用linux的>
+ * @brief 把中间代码格式化成文本写到out，先格式化到64KB的缓冲区里，攒满了才写一次，
+ * 整数自己转成十进制，不经过printf
  *
- * @param interCodesWrap 中间代码结构包装
+ * @param out 输出
+ * @param codes 连续存放的中间代码
+ * @param count 条数
+ * @param getName 有名字的运算分量用它按编号取名字
+ * @param names 交给getName的名字表
  */
-void printInterCodes(pInterCodesWrap interCodesWrap)
+void writeInterCodes(FILE *out, const struct InterCode_ *codes, unsigned count, OperandNameFunc getName, const void *names)
 {
-    for (pInterCodes cur = interCodesWrap->head; cur != NULL; cur = cur->next)
+    IRWriter writer = {malloc(IR_WRITER_SIZE), 0, out};
+    if (!writer.buffer)
     {
-        assert(cur->code->kind >= 0 && cur->code->kind < 19);
-        switch (cur->code->kind)
+        fprintf(stderr, "[%s:%d]Out of memory(%d bytes)\n", __FILE__, __LINE__, IR_WRITER_SIZE);
+        exit(EXIT_FAILURE);
+    }
+    //中间代码连续存放，顺着下标扫一遍就行
+    for (unsigned i = 0; i < count; i++)
+    {
+        const struct InterCode_ *code = &codes[i];
+        assert(code->kind >= 0 && code->kind < 19);
+        switch (code->kind)
         {
         case IR_LABEL:
-            printf("LABEL ");
-            printOperand(cur->code->u.oneOp.op);
-            printf(" :");
+            WRITE_LITERAL(&writer, "LABEL ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
+            WRITE_LITERAL(&writer, " :");
             break;
         case IR_FUNCTION:
-            printf("FUNCTION ");
-            printOperand(cur->code->u.oneOp.op);
-            printf(" :");
+            WRITE_LITERAL(&writer, "FUNCTION ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
+            WRITE_LITERAL(&writer, " :");
             break;
         case IR_ASSIGN:
-            printOperand(cur->code->u.assign.left);
-            printf(" := ");
-            printOperand(cur->code->u.assign.right);
+            writeOperand(&writer, getName, names, &code->u.assign.left);
+            WRITE_LITERAL(&writer, " := ");
+            writeOperand(&writer, getName, names, &code->u.assign.right);
             break;
         case IR_ADD:
-            printOperand(cur->code->u.binOp.result);
-            printf(" := ");
-            printOperand(cur->code->u.binOp.op1);
-            printf(" + ");
-            printOperand(cur->code->u.binOp.op2);
-            break;
         case IR_SUB:
-            printOperand(cur->code->u.binOp.result);
-            printf(" := ");
-            printOperand(cur->code->u.binOp.op1);
-            printf(" - ");
-            printOperand(cur->code->u.binOp.op2);
-            break;
         case IR_MUL:
-            printOperand(cur->code->u.binOp.result);
-            printf(" := ");
-            printOperand(cur->code->u.binOp.op1);
-            printf(" * ");
-            printOperand(cur->code->u.binOp.op2);
-            break;
         case IR_DIV:
-            printOperand(cur->code->u.binOp.result);
-            printf(" := ");
-            printOperand(cur->code->u.binOp.op1);
-            printf(" / ");
-            printOperand(cur->code->u.binOp.op2);
+            writeOperand(&writer, getName, names, &code->u.binOp.result);
+            WRITE_LITERAL(&writer, " := ");
+            writeOperand(&writer, getName, names, &code->u.binOp.op1);
+            //四种运算只差运算符
+            writeString(&writer, &" + - * / "[(code->kind - IR_ADD) * 2], 3);
+            writeOperand(&writer, getName, names, &code->u.binOp.op2);
             break;
         case IR_GET_ADDR:
-            printOperand(cur->code->u.assign.left);
-            printf(" := &");
-            printOperand(cur->code->u.assign.right);
+            writeOperand(&writer, getName, names, &code->u.assign.left);
+            WRITE_LITERAL(&writer, " := &");
+            writeOperand(&writer, getName, names, &code->u.assign.right);
             break;
         case IR_READ_ADDR:
-            printOperand(cur->code->u.assign.left);
-            printf(" := *");
-            printOperand(cur->code->u.assign.right);
+            writeOperand(&writer, getName, names, &code->u.assign.left);
+            WRITE_LITERAL(&writer, " := *");
+            writeOperand(&writer, getName, names, &code->u.assign.right);
             break;
         case IR_WRITE_ADDR:
-            printf("*");
-            printOperand(cur->code->u.assign.left);
-            printf(" := ");
-            printOperand(cur->code->u.assign.right);
+            WRITE_LITERAL(&writer, "*");
+            writeOperand(&writer, getName, names, &code->u.assign.left);
+            WRITE_LITERAL(&writer, " := ");
+            writeOperand(&writer, getName, names, &code->u.assign.right);
             break;
         case IR_GOTO:
-            printf("GOTO ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "GOTO ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         case IR_IF_GOTO:
-            printf("IF ");
-            printOperand(cur->code->u.ifGoto.x);
-            printf(" ");
-            printOperand(cur->code->u.ifGoto.relop);
-            printf(" ");
-            printOperand(cur->code->u.ifGoto.y);
-            printf(" GOTO ");
-            printOperand(cur->code->u.ifGoto.z);
+            WRITE_LITERAL(&writer, "IF ");
+            writeOperand(&writer, getName, names, &code->u.ifGoto.x);
+            WRITE_LITERAL(&writer, " ");
+            writeOperand(&writer, getName, names, &code->u.ifGoto.relop);
+            WRITE_LITERAL(&writer, " ");
+            writeOperand(&writer, getName, names, &code->u.ifGoto.y);
+            WRITE_LITERAL(&writer, " GOTO ");
+            writeOperand(&writer, getName, names, &code->u.ifGoto.z);
             break;
         case IR_RETURN:
-            printf("RETURN ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "RETURN ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         case IR_DEC:
-            printf("DEC ");
-            printOperand(cur->code->u.dec.op);
-            printf(" ");
-            printf("%d", cur->code->u.dec.size);
+            WRITE_LITERAL(&writer, "DEC ");
+            writeOperand(&writer, getName, names, &code->u.dec.op);
+            WRITE_LITERAL(&writer, " ");
+            writeInt(&writer, code->u.dec.size);
             break;
         case IR_ARG:
-            printf("ARG ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "ARG ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         case IR_CALL:
-            printOperand(cur->code->u.assign.left);
-            printf(" := CALL ");
-            printOperand(cur->code->u.assign.right);
+            writeOperand(&writer, getName, names, &code->u.assign.left);
+            WRITE_LITERAL(&writer, " := CALL ");
+            writeOperand(&writer, getName, names, &code->u.assign.right);
             break;
         case IR_PARAM:
-            printf("PARAM ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "PARAM ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         case IR_READ:
-            printf("READ ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "READ ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         case IR_WRITE:
-            printf("WRITE ");
-            printOperand(cur->code->u.oneOp.op);
+            WRITE_LITERAL(&writer, "WRITE ");
+            writeOperand(&writer, getName, names, &code->u.oneOp.op);
             break;
         }
-        printf("\n");
+        WRITE_LITERAL(&writer, "\n");
     }
+    flushIRWriter(&writer);
+    free(writer.buffer);
+}
+
+/**
+ * @brief 输出中间代码到compiler->irOut，名字从驻留池中取
+ *
+ * @param interCodesWrap 中间代码序列
+ */
+void printInterCodes(pCompiler compiler, pInterCodesWrap interCodesWrap)
+{
+    writeInterCodes(compiler->irOut, interCodesWrap->codes, interCodesWrap->count, getInternName, compiler->strings);
 }
 
 /**
@@ -486,35 +701,35 @@ void printInterCodes(pInterCodesWrap interCodesWrap)
  *
  * @param node 语法分析树的节点
  */
-void generateInterCodes(pNode node)
+void generateInterCodes(pCompiler compiler, pNode node)
 {
-    if (node)
+    /*
+    Program:            ExtDefList
+    ExtDefList:         ExtDef ExtDefList
+        |
+    */
+    pNode extDefList = node ? getChild(node) : NULL;
+    while (extDefList)
     {
-        if (!strcmp(node->name, "ExtDef"))
-        {
-            translate_ExtDef(node);
-            generateInterCodes(node->brother);
-            return;
-        }
-        generateInterCodes(node->child);
-        generateInterCodes(node->brother);
+        translate_ExtDef(compiler, getChild(extDefList));
+        extDefList = getBrother(getChild(extDefList));
     }
 }
 
-void translate_ExtDef(pNode node)
+void translate_ExtDef(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
-    pNode secondChild = node->child->brother;
+    pNode secondChild = getBrother(getChild(node));
     //无函数声明，全局变量定义，结构体
-    if (!strcmp(secondChild->name, "FunDec"))
+    if (node->production == EXTDEF_FUNC)
     {
 
-        translate_FunDec(secondChild);
-        translate_CompSt(secondChild->brother);
+        translate_FunDec(compiler, secondChild);
+        translate_CompSt(compiler, getBrother(secondChild));
     }
 }
 
-void translate_FunDec(pNode node)
+void translate_FunDec(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -522,42 +737,38 @@ void translate_FunDec(pNode node)
         |               ID LP RP
         |               error RP
     */
-    pNode child = node->child;
-    pInterCodes newCode = newInterCodes(newInterCode(IR_FUNCTION, 1,
-                                                     newOperand(OPERAND_FUNCTION, newString(child->value))));
-    addInterCodesToWrap(interCodesWrap, newCode);
-    pTableItem tableItem = getSymbolTableItem(symbolTable, child->value);
+    pNode child = getChild(node);
+    addInterCode(compiler->interCodesWrap, IR_FUNCTION, 1, newNamedOperand(OPERAND_FUNCTION, getNodeValue(compiler, child)));
+    pTableItem tableItem = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
     pFieldList argv = tableItem->field->type->u.function.argv;
     while (argv)
     {
-        newCode = newInterCodes(newInterCode(IR_PARAM, 1,
-                                             newOperand(OPERAND_VARIABLE, newString(argv->name))));
-        addInterCodesToWrap(interCodesWrap, newCode);
+        addInterCode(compiler->interCodesWrap, IR_PARAM, 1, newNamedOperand(OPERAND_VARIABLE, argv->name));
         argv = argv->tail;
     }
 }
 
-void translate_CompSt(pNode node)
+void translate_CompSt(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
     CompSt:             LC DefList StmtList RC
         |               error RC
     */
-    pNode secondChild = node->child->brother;
+    pNode secondChild = getBrother(getChild(node));
 
-    if (!strcmp(secondChild->name, "DefList"))
+    if (secondChild->kind == SYMBOL_DefList)
     {
-        translate_DefList(secondChild);
-        secondChild = secondChild->brother;
+        translate_DefList(compiler, secondChild);
+        secondChild = getBrother(secondChild);
     }
-    if (!strcmp(secondChild->name, "StmtList"))
+    if (secondChild->kind == SYMBOL_StmtList)
     {
-        translate_StmtList(secondChild);
+        translate_StmtList(compiler, secondChild);
     }
 }
 
-void translate_DefList(pNode node)
+void translate_DefList(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -566,27 +777,27 @@ void translate_DefList(pNode node)
     */
     while (node)
     {
-        translate_Def(node->child);
-        node = node->child->brother;
+        translate_Def(compiler, getChild(node));
+        node = getBrother(getChild(node));
     }
 }
 
-void translate_Def(pNode node)
+void translate_Def(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
     Def:                Specifier DecList SEMI
         ;
     */
-    pNode child = node->child;
+    pNode child = getChild(node);
     //直接分析DecList，不用担心Specifier，因为已经在语义分析中分析过了
-    if (!strcmp(child->brother->name, "DecList"))
+    if (getBrother(child)->kind == SYMBOL_DecList)
     {
-        translate_DecList(child->brother);
+        translate_DecList(compiler, getBrother(child));
     }
 }
 
-void translate_DecList(pNode node)
+void translate_DecList(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -596,10 +807,10 @@ void translate_DecList(pNode node)
     */
     while (node)
     {
-        translate_Dec(node->child);
-        if (node->child->brother)
+        translate_Dec(compiler, getChild(node));
+        if (getBrother(getChild(node)))
         {
-            node = node->child->brother->brother;
+            node = getBrother(getBrother(getChild(node)));
         }
         else
         {
@@ -608,7 +819,7 @@ void translate_DecList(pNode node)
     }
 }
 
-void translate_Dec(pNode node)
+void translate_Dec(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -616,28 +827,28 @@ void translate_Dec(pNode node)
         |               VarDec ASSIGNOP Exp
         ;
     */
-    pNode child = node->child;
+    pNode child = getChild(node);
     // VarDec ASSIGNOP Exp
-    if (child->brother)
+    if (getBrother(child))
     {
 
-        pOperand t1 = newTemp();
-        translate_VarDec(child, t1);
-        pOperand t2 = newTemp();
-        translate_Exp(child->brother->brother, t2);
+        Operand t1 = newTemp(compiler);
+        translate_VarDec(compiler, child, &t1);
+        Operand t2 = newTemp(compiler);
+        translate_Exp(compiler, getBrother(getBrother(child)), &t2);
+        if (isAddressExp(getBrother(getBrother(child))))
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t2, t2);
         //只用考虑简单变量的复制
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ASSIGN, 2, t1, t2)));
-        freeOperand(t1);
-        freeOperand(t2);
+        addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, t1, t2);
     }
     // VarDec
     else
     {
-        translate_VarDec(child, NULL);
+        translate_VarDec(compiler, child, NULL);
     }
 }
 
-void translate_VarDec(pNode node, pOperand place)
+void translate_VarDec(pCompiler compiler, pNode node, pOperand place)
 {
     assert(node != NULL);
     /*
@@ -647,39 +858,30 @@ void translate_VarDec(pNode node, pOperand place)
         ;
     */
     // VarDec -> ID
-    if (!strcmp(node->child->name, "ID"))
+    if (node->production == VARDEC_ID)
     {
 
-        pTableItem temp = getSymbolTableItem(symbolTable, node->child->value);
+        pTableItem temp = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, getChild(node)));
         pType type = temp->field->type;
         if (type->kind == BASIC)
         {
             if (place)
             {
-                interCodesWrap->tempVarNum--;
-                updateOperand(place, OPERAND_VARIABLE,
-                              newString(temp->field->name));
+                compiler->interCodesWrap->tempVarNum--;
+                *place = newNamedOperand(OPERAND_VARIABLE, temp->field->name);
             }
             //如果只是简单的变量声明语句不用特地的打印中间代码
         }
-        else if (type->kind == ARRAY)
-        {
-            pInterCodes p = newInterCodes(newInterCode(
-                IR_DEC,
-                2,
-                newOperand(OPERAND_VARIABLE, newString(temp->field->name)),
-                getSize(type)));
-            addInterCodesToWrap(interCodesWrap, p);
-        }
-        else if (type->kind == STRUCTURE)
+        else
         {
-            printf("Cannot translate: Code contains variables or parameters of structure type.");
+            //数组和结构体都要分配内存
+            addInterCode(compiler->interCodesWrap, IR_DEC, 2, newNamedOperand(OPERAND_VARIABLE, temp->field->name), getSize(type));
         }
     }
     // VarDec -> VarDec LB INT RB
     else
     {
-        translate_VarDec(node->child, place);
+        translate_VarDec(compiler, getChild(node), place);
     }
 }
 
@@ -689,400 +891,374 @@ void translate_VarDec(pNode node, pOperand place)
  * @param exp
  * @param place
  */
-void translate_Exp(pNode exp, pOperand place)
+void translate_Exp(pCompiler compiler, pNode exp, pOperand place)
 {
     assert(exp != NULL);
-    // Exp -> Exp ASSIGNOP Exp
-    //      | Exp AND Exp
+    pNode child = getChild(exp);
+    switch (exp->production)
+    {
+    // Exp -> LP Exp RP
+    case EXP_PAREN:
+        translate_Exp(compiler, getBrother(child), place);
+        break;
+    // Exp -> Exp AND Exp
     //      | Exp OR Exp
     //      | Exp RELOP Exp
-    //      | Exp PLUS Exp
-    //      | Exp MINUS Exp
-    //      | Exp STAR Exp
-    //      | Exp DIV Exp
-
-    //      | MINUS Exp
     //      | NOT Exp
-    //      | ID LP Args RP
-    //      | ID LP RP
-    //      | Exp LB Exp RB
-    //      | Exp DOT ID
-    //      | ID
-    //      | INT
-    //      | FLOAT
-
-    // Exp -> LP Exp RP
-    pNode child = exp->child;
-    if (!strcmp(child->name, "LP"))
+    //条件表达式
+    /*
+    方便理解的翻译例子：
+    n = a > b;
+    得到的中间代码：
+    t3 := #0
+    IF a > b GOTO label1
+    GOTO label2
+    LABEL label1 :
+    t3 := #1
+    LABEL label2 :
+    n := t3
+    */
+    case EXP_AND:
+    case EXP_OR:
+    case EXP_RELOP:
+    case EXP_NOT:
     {
-        translate_Exp(child->brother, place);
+        Operand label1 = newLabel(compiler);
+        Operand label2 = newLabel(compiler);
+        Operand true_num = newOperand(OPERAND_CONSTANT, 1);
+        Operand false_num = newOperand(OPERAND_CONSTANT, 0);
+        addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, *place, false_num);
+        translate_Cond(compiler, exp, label1, label2);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label1);
+        addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, *place, true_num);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label2);
+        break;
     }
-    else if (!strcmp(child->name, "Exp") ||
-             !strcmp(child->name, "NOT"))
+    // Exp -> Exp ASSIGNOP Exp
+    case EXP_ASSIGNOP:
     {
-        // 条件表达式 和 基本表达式
-        if (strcmp(child->brother->name, "LB") &&
-            strcmp(child->brother->name, "DOT"))
+        //寻找左边的变量，因为可能为ID或者数组赋值
+        Operand t1 = newTemp(compiler);
+        translate_Exp(compiler, child, &t1);
+        Operand t2 = newTemp(compiler);
+        pNode exp2 = getBrother(getBrother(child));
+        translate_Exp(compiler, exp2, &t2);
+        //如果左边是数组元素或者结构体的域,所以它是一个地址值
+        if (isAddressExp(child))
         {
-            // Exp -> Exp AND Exp
-            //      | Exp OR Exp
-            //      | Exp RELOP Exp
-            //      | NOT Exp
-            //条件表达式
-            /*
-            方便理解的翻译例子：
-            n = a > b;
-            得到的中间代码：
-            t3 := #0
-            IF a > b GOTO label1
-            GOTO label2
-            LABEL label1 :
-            t3 := #1
-            LABEL label2 :
-            n := t3
-            */
-            if (!strcmp(child->brother->name, "AND") ||
-                !strcmp(child->brother->name, "OR") ||
-                !strcmp(child->brother->name, "RELOP") ||
-                !strcmp(child->name, "NOT"))
-            {
-                pOperand label1 = newLabel(interCodesWrap);
-                pOperand label2 = newLabel(interCodesWrap);
-                int TRUE_CONSTANT = 1;
-                int FALSE_CONSTANT = 0;
-                pOperand true_num = newOperand(OPERAND_CONSTANT, &TRUE_CONSTANT);
-                pOperand false_num = newOperand(OPERAND_CONSTANT, &FALSE_CONSTANT);
-                pInterCodes code0 = newInterCodes(newInterCode(IR_ASSIGN, 2, place, false_num));
-                addInterCodesToWrap(interCodesWrap, code0);
-                pInterCodes code1 = translate_Cond(exp, label1, label2);
-                addInterCodesToWrap(interCodesWrap, code1);
-                pInterCodes code2 = newInterCodes(newInterCode(IR_LABEL, 1, label1));
-                addInterCodesToWrap(interCodesWrap, code2);
-                pInterCodes code3 = newInterCodes(newInterCode(IR_ASSIGN, 2, place, true_num));
-                addInterCodesToWrap(interCodesWrap, code3);
-                pInterCodes code4 = newInterCodes(newInterCode(IR_LABEL, 1, label2));
-                addInterCodesToWrap(interCodesWrap, code4);
-                freeOperand(label1);
-                freeOperand(label2);
-            }
-            else
+            //如果右边也是一个数组，所以它也是一个地址值
+            if (isAddressExp(exp2))
             {
-                // Exp -> Exp ASSIGNOP Exp
-                if (!strcmp(child->brother->name, "ASSIGNOP"))
-                {
-                    //寻找左边的变量，因为可能为ID或者数组赋值
-                    pOperand t1 = newTemp();
-                    translate_Exp(child, t1);
-                    pOperand t2 = newTemp();
-                    pNode exp2 = child->brother->brother;
-                    translate_Exp(exp2, t2);
-                    //如果左边是数组,所以它是一个地址值
-                    if (child->child->brother && !strcmp(child->child->brother->name, "LB"))
-                    {
-                        //如果右边也是一个数组，所以它也是一个地址值
-                        if (exp2->child->brother && !strcmp(exp2->child->brother->name, "LB"))
-                        {
-                            pInterCodes code1 = newInterCodes(newInterCode(IR_READ_ADDR, 2, t2, t2));
-                            addInterCodesToWrap(interCodesWrap, code1);
-                        }
-                        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_WRITE_ADDR, 2, t1, t2)));
-                    }
-                    else
-                    {
-                        //如果右边也是一个数组，所以它也是一个地址值
-                        if (exp2->child->brother && !strcmp(exp2->child->brother->name, "LB"))
-                        {
-                            pInterCodes code1 = newInterCodes(newInterCode(IR_READ_ADDR, 2, t2, t2));
-                            addInterCodesToWrap(interCodesWrap, code1);
-                        }
-                        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ASSIGN, 2, t1, t2)));
-                    }
-                    // 这里无论是地址还是变量都应该使用这条语句
-                    if (place)
-                    {
-                        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ASSIGN, 2, place, t1)));
-                    }
-                    freeOperand(t1);
-                    freeOperand(t2);
-                }
-                //      | Exp PLUS Exp
-                //      | Exp MINUS Exp
-                //      | Exp STAR Exp
-                //      | Exp DIV Exp
-                else
-                {
-                    pOperand t1 = newTemp();
-                    translate_Exp(child, t1);
-                    //如果t1现在是数组的地址,因此需要从t1中读取值
-                    if (child->child->brother && !strcmp(child->child->brother->name, "LB"))
-                    {
-                        pInterCodes addCode = newInterCodes(newInterCode(IR_READ_ADDR, 2, t1, t1));
-                        addInterCodesToWrap(interCodesWrap, addCode);
-                    }
-                    pOperand t2 = newTemp();
-                    pNode exp2 = child->brother->brother;
-                    translate_Exp(exp2, t2);
-                    if (exp2->child->brother && !strcmp(exp2->child->brother->name, "LB"))
-                    {
-                        pInterCodes addCode = newInterCodes(newInterCode(IR_READ_ADDR, 2, t2, t2));
-                        addInterCodesToWrap(interCodesWrap, addCode);
-                    }
-
-                    // Exp -> Exp PLUS Exp
-                    if (!strcmp(child->brother->name, "PLUS"))
-                    {
-                        pInterCodes addCode = newInterCodes(newInterCode(IR_ADD, 3, place, t1, t2));
-                        addInterCodesToWrap(interCodesWrap, addCode);
-                    }
-                    // Exp -> Exp MINUS Exp
-                    else if (!strcmp(child->brother->name, "MINUS"))
-                    {
-                        pInterCodes subCode = newInterCodes(newInterCode(IR_SUB, 3, place, t1, t2));
-                        addInterCodesToWrap(interCodesWrap, subCode);
-                    }
-                    // Exp -> Exp STAR Exp
-                    else if (!strcmp(child->brother->name, "STAR"))
-                    {
-                        pInterCodes starCode = newInterCodes(newInterCode(IR_MUL, 3, place, t1, t2));
-                        addInterCodesToWrap(interCodesWrap, starCode);
-                    }
-                    // Exp -> Exp DIV Exp
-                    else if (!strcmp(child->brother->name, "DIV"))
-                    {
-                        pInterCodes divCode = newInterCodes(newInterCode(IR_DIV, 3, place, t1, t2));
-                        addInterCodesToWrap(interCodesWrap, divCode);
-                    }
-                    freeOperand(t1);
-                    freeOperand(t2);
-                }
+                addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t2, t2);
             }
+            addInterCode(compiler->interCodesWrap, IR_WRITE_ADDR, 2, t1, t2);
         }
-        // 数组和结构体访问
         else
         {
-            // Exp -> Exp LB Exp RB
-            // 数组
-            if (!strcmp(child->brother->name, "LB"))
+            //如果右边也是一个数组，所以它也是一个地址值
+            if (isAddressExp(exp2))
             {
-                // 高维数组
-                // 这里可以注意的一个细节是
-                // 例：a[0][1][1] 将会翻译成如下所示，所以可以递归的去计算地址
-                /*
+                addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t2, t2);
+            }
+            addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, t1, t2);
+        }
+        // 这里无论是地址还是变量都应该使用这条语句
+        if (place)
+        {
+            addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, *place, t1);
+        }
+        break;
+    }
+    // Exp -> Exp PLUS Exp
+    //      | Exp MINUS Exp
+    //      | Exp STAR Exp
+    //      | Exp DIV Exp
+    case EXP_PLUS:
+    case EXP_MINUS:
+    case EXP_STAR:
+    case EXP_DIV:
+    {
+        Operand t1 = newTemp(compiler);
+        translate_Exp(compiler, child, &t1);
+        //如果t1现在是数组的地址,因此需要从t1中读取值
+        if (isAddressExp(child))
+        {
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t1, t1);
+        }
+        Operand t2 = newTemp(compiler);
+        pNode exp2 = getBrother(getBrother(child));
+        translate_Exp(compiler, exp2, &t2);
+        if (isAddressExp(exp2))
+        {
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t2, t2);
+        }
+
+        //运算符和中间代码一一对应
+        int kind;
+        switch (exp->production)
+        {
+        // Exp -> Exp PLUS Exp
+        case EXP_PLUS:
+            kind = IR_ADD;
+            break;
+        // Exp -> Exp MINUS Exp
+        case EXP_MINUS:
+            kind = IR_SUB;
+            break;
+        // Exp -> Exp STAR Exp
+        case EXP_STAR:
+            kind = IR_MUL;
+            break;
+        // Exp -> Exp DIV Exp
+        default:
+            kind = IR_DIV;
+            break;
+        }
+        addInterCode(compiler->interCodesWrap, kind, 3, *place, t1, t2);
+        break;
+    }
+    // Exp -> Exp LB Exp RB
+    // 数组
+    case EXP_ARRAY:
+        // 高维数组
+        // 这里可以注意的一个细节是
+        // 例：a[0][1][1] 将会翻译成如下所示，所以可以递归的去计算地址
+        /*
+        Exp (5)
+            Exp (5)
                 Exp (5)
-                    Exp (5)
-                        Exp (5)
-                            ID: a
-                        LB
-                        Exp (5)
-                            INT: 0
-                        RB
-                    LB
-                    Exp (5)
-                        INT: 1
-                    RB
+                    ID: a
                 LB
                 Exp (5)
-                    INT: 1
+                    INT: 0
                 RB
-                */
-                if (child->child->brother && !strcmp(child->child->brother->name, "LB"))
-                {
-                    // 因为数组的维数每次都能打满，也就是不会有定义a[2][2][2]却使用了a[1][1]的情况（这是语法错误）
-                    // 所以只要简单计算一下偏移就好了,不过这里的代码真的很丑，强烈不推荐这样写
-
-                    unsigned factor = 4;
-                    unsigned depth = 0;
-                    pNode id = child;
-                    while (id->child)
-                    {
-                        id = id->child;
-                        depth++;
-                    }
-                    pOperand base = newOperand(OPERAND_VARIABLE, id->value);
-                    pTableItem item = getSymbolTableItem(symbolTable, id->value);
-                    assert(item->field->type->kind == ARRAY);
-                    pType type = item->field->type;
-                    id = child;
-
-                    pOperand offset = newTemp();
-                    pOperand factorOperand = newTemp();
-                    pOperand addOffset = newTemp();
-                    unsigned zero = 0;
-                    addInterCodesToWrap(interCodesWrap,
-                                        newInterCodes(newInterCode(IR_ASSIGN, 2, offset, newOperand(OPERAND_CONSTANT, &zero))));
-
-                    while (id->child)
-                    {
-                        pOperand tempOperand = newTemp();
-                        unsigned temp = depth--;
-                        pType tempType = type;
-                        while (temp)
-                        {
-                            temp -= 1;
-                            tempType = tempType->u.array.elem;
-                        }
-                        factor = getSize(tempType);
-                        updateOperand(factorOperand, OPERAND_CONSTANT, &factor);
-                        translate_Exp(id->brother->brother, tempOperand);
-                        addInterCodesToWrap(interCodesWrap,
-                                            newInterCodes(newInterCode(IR_MUL, 3, addOffset, factorOperand, tempOperand)));
-                        addInterCodesToWrap(interCodesWrap,
-                                            newInterCodes(newInterCode(IR_ADD, 3, offset, offset, addOffset)));
-                        id = id->child;
-                        freeOperand(tempOperand);
-                    }
-                    pOperand target;
-                    target = newTemp();
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_GET_ADDR, 2, target, base)));
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ADD, 3, place, target, offset)));
-                }
-                // 低维数组
-                else
-                {
-                    pOperand idx = newTemp();
-                    translate_Exp(child->brother->brother, idx);
-                    pOperand base = newTemp();
-                    translate_Exp(child, base);
-
-                    pOperand width;
-                    pOperand offset = newTemp();
-                    pOperand target;
-                    pTableItem item = getSymbolTableItem(symbolTable, base->u.name);
-                    assert(item->field->type->kind == ARRAY);
-                    unsigned size = getSize(item->field->type->u.array.elem);
-                    width = newOperand(
-                        OPERAND_CONSTANT, &size);
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_MUL, 3, offset, idx, width)));
-                    //如果不是数组参数，那么不需要进行取地址操作
-                    if (base->kind == OPERAND_VARIABLE)
-                    {
-                        target = newTemp();
-                        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_GET_ADDR, 2, target, base)));
-                    }
-                    else
-                    {
-                        target = copyOperand(base);
-                    }
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ADD, 3, place, target, offset)));
-                    // 注意：现在place中放置的值是对应数组的下标的地址
-                    freeOperand(idx);
-                    freeOperand(base);
-                    freeOperand(width);
-                    freeOperand(offset);
-                    freeOperand(target);
-                }
+            LB
+            Exp (5)
+                INT: 1
+            RB
+        LB
+        Exp (5)
+            INT: 1
+        RB
+        */
+        if (child->production == EXP_ARRAY)
+        {
+            // 因为数组的维数每次都能打满，也就是不会有定义a[2][2][2]却使用了a[1][1]的情况（这是语法错误）
+            // 所以只要简单计算一下偏移就好了,不过这里的代码真的很丑，强烈不推荐这样写
+
+            unsigned factor;
+            unsigned depth = 0;
+            pNode id = child;
+            while (getChild(id))
+            {
+                id = getChild(id);
+                depth++;
+            }
+            Operand base = newNamedOperand(OPERAND_VARIABLE, getNodeValue(compiler, id));
+            pTableItem item = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, id));
+            assert(item->field->type->kind == ARRAY);
+            pType type = item->field->type;
+            assert(depth <= type->u.array.dims);
+            id = child;
+
+            Operand offset = newTemp(compiler);
+            Operand factorOperand = newTemp(compiler);
+            Operand addOffset = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, offset, newOperand(OPERAND_CONSTANT, 0));
+
+            while (getChild(id))
+            {
+                Operand tempOperand = newTemp(compiler);
+                //从最后一个下标往前翻译，步长在建立数组类型时就算好了
+                factor = type->u.array.strides[--depth];
+                factorOperand = newOperand(OPERAND_CONSTANT, factor);
+                translate_Exp(compiler, getBrother(getBrother(id)), &tempOperand);
+                addInterCode(compiler->interCodesWrap, IR_MUL, 3, addOffset, factorOperand, tempOperand);
+                addInterCode(compiler->interCodesWrap, IR_ADD, 3, offset, offset, addOffset);
+                id = getChild(id);
+            }
+            Operand target;
+            target = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_GET_ADDR, 2, target, base);
+            addInterCode(compiler->interCodesWrap, IR_ADD, 3, *place, target, offset);
+        }
+        // 低维数组
+        else
+        {
+            Operand idx = newTemp(compiler);
+            translate_Exp(compiler, getBrother(getBrother(child)), &idx);
+            Operand base = newTemp(compiler);
+            translate_Exp(compiler, child, &base);
+
+            Operand width;
+            Operand offset = newTemp(compiler);
+            Operand target;
+            pType arrayType = getExpType(compiler, child);
+            unsigned size = arrayType && arrayType->kind == ARRAY ? arrayType->u.array.strides[0] : 4;
+            width = newOperand(OPERAND_CONSTANT, size);
+            addInterCode(compiler->interCodesWrap, IR_MUL, 3, offset, idx, width);
+            //数组参数和结构体的域翻译出来已经是地址了，不需要进行取地址操作
+            if (child->production == EXP_ID && base.kind == OPERAND_VARIABLE)
+            {
+                target = newTemp(compiler);
+                addInterCode(compiler->interCodesWrap, IR_GET_ADDR, 2, target, base);
             }
-            // Exp -> Exp DOT ID
             else
             {
-                printf("Cannot translate: Code contains variables or parameters of structure type.");
+                target = base;
             }
+            addInterCode(compiler->interCodesWrap, IR_ADD, 3, *place, target, offset);
+            // 注意：现在place中放置的值是对应数组的下标的地址
         }
+        break;
+    // Exp -> Exp DOT ID
+    // 结构体的域，和数组元素一样，place中放的是域的地址，偏移在建立结构体类型时就算好了
+    case EXP_DOT:
+    {
+        pFieldList field = getDotField(compiler, exp);
+        if (field == NULL)
+            break;
+        Operand base = newTemp(compiler);
+        translate_Exp(compiler, child, &base);
+        Operand target;
+        //结构体参数、嵌套的结构体和数组中的结构体翻译出来已经是地址了
+        if (child->production == EXP_ID && base.kind == OPERAND_VARIABLE)
+        {
+            target = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_GET_ADDR, 2, target, base);
+        }
+        else
+        {
+            target = base;
+        }
+        if (field->offset)
+        {
+            Operand offset = newOperand(OPERAND_CONSTANT, field->offset);
+            addInterCode(compiler->interCodesWrap, IR_ADD, 3, *place, target, offset);
+        }
+        else
+        {
+            addInterCode(compiler->interCodesWrap, IR_ASSIGN, 2, *place, target);
+        }
+        break;
     }
     //单目运算符
     // Exp -> MINUS Exp
-    else if (!strcmp(child->name, "MINUS"))
+    case EXP_NEG:
     {
-        pOperand t1 = newTemp();
-        pNode exp2 = child->brother;
-        translate_Exp(exp2, t1);
-        int zero_Num = 0;
-        pOperand zero = newOperand(OPERAND_CONSTANT, &zero_Num);
+        Operand t1 = newTemp(compiler);
+        pNode exp2 = getBrother(child);
+        translate_Exp(compiler, exp2, &t1);
+        Operand zero = newOperand(OPERAND_CONSTANT, 0);
         // 如果是数组
-        if (exp2->child->brother && !strcmp(exp2->child->brother->name, "LB"))
+        if (isAddressExp(exp2))
         {
-            addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_READ_ADDR, 2, t1, t1)));
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t1, t1);
         }
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_SUB, 3, place, zero, t1)));
-        freeOperand(t1);
+        addInterCode(compiler->interCodesWrap, IR_SUB, 3, *place, zero, t1);
+        break;
     }
     // 函数调用
     // Exp -> ID LP Args RP
-    //		| ID LP RP
-    else if (!strcmp(child->name, "ID") && child->brother)
+    // 带参数的函数调用
+    case EXP_CALL_ARGS:
     {
-        pOperand funcTemp =
-            newOperand(OPERAND_FUNCTION, newString(child->value));
-        // Exp -> ID LP Args RP
-        // 带参数的函数调用
-        if (!strcmp(child->brother->brother->name, "Args"))
+        pTableItem func = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
+        //内置函数直接翻译成对应的中间代码
+        if (func && func->builtin)
         {
-            translate_Args(child->brother->brother);
-            if (!strcmp(child->value, "write"))
-            {
-                // 因为write传递函数参数的方式不一样因此需要如下修改
-                pOperand temp = copyOperand(interCodesWrap->tail->code->u.oneOp.op);
-                pInterCodes prevCode = interCodesWrap->tail->prev;
-                freeInterCodes(interCodesWrap->tail);
-                interCodesWrap->tail = prevCode;
-                addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_WRITE, 1, temp)));
-            }
-            else
-            {
-                if (place)
-                {
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(
-                                                            IR_CALL, 2, place, funcTemp)));
-                }
-                else
-                {
-                    pOperand temp = newTemp();
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(
-                                                            IR_CALL, 2, temp, funcTemp)));
-                    freeOperand(temp);
-                }
-            }
+            func->builtin->lower(compiler, getBrother(getBrother(child)), place);
+            break;
+        }
+        Operand funcTemp = newNamedOperand(OPERAND_FUNCTION, getNodeValue(compiler, child));
+        translate_Args(compiler, getBrother(getBrother(child)));
+        if (place)
+        {
+            addInterCode(compiler->interCodesWrap, IR_CALL, 2, *place, funcTemp);
         }
-        // Exp -> ID LP RP
         else
         {
-            if (!strcmp(child->value, "read"))
-            {
-                addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_READ, 1, place)));
-            }
-            else
-            {
-                if (place)
-                {
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(
-                                                            IR_CALL, 2, place, funcTemp)));
-                }
-                else
-                {
-                    pOperand temp = newTemp();
-                    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(
-                                                            IR_CALL, 2, temp, funcTemp)));
-                    freeOperand(temp);
-                }
-            }
+            Operand temp = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_CALL, 2, temp, funcTemp);
         }
+        break;
+    }
+    // Exp -> ID LP RP
+    case EXP_CALL:
+    {
+        pTableItem func = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
+        //内置函数直接翻译成对应的中间代码
+        if (func && func->builtin)
+        {
+            func->builtin->lower(compiler, NULL, place);
+            break;
+        }
+        Operand funcTemp = newNamedOperand(OPERAND_FUNCTION, getNodeValue(compiler, child));
+        if (place)
+        {
+            addInterCode(compiler->interCodesWrap, IR_CALL, 2, *place, funcTemp);
+        }
+        else
+        {
+            Operand temp = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_CALL, 2, temp, funcTemp);
+        }
+        break;
     }
     // Exp -> ID
-    else if (!strcmp(child->name, "ID"))
+    case EXP_ID:
     {
-        interCodesWrap->tempVarNum--;
-        pTableItem item = getSymbolTableItem(symbolTable, child->value);
-        if (item->field->isParam && item->field->type->kind == ARRAY)
+        compiler->interCodesWrap->tempVarNum--;
+        pTableItem item = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
+        if (item->field->isParam && (item->field->type->kind == ARRAY || item->field->type->kind == STRUCTURE))
         {
-            updateOperand(place, OPERAND_ADDRESS, newString(child->value));
+            *place = newNamedOperand(OPERAND_ADDRESS, getNodeValue(compiler, child));
             // place->isAddr = TRUE;
         }
         else
         {
-            updateOperand(place, OPERAND_VARIABLE, newString(child->value));
+            *place = newNamedOperand(OPERAND_VARIABLE, getNodeValue(compiler, child));
         }
+        break;
     }
-    else
+    // Exp -> INT
+    default:
+    {
+        compiler->interCodesWrap->tempVarNum--;
+        *place = newOperand(OPERAND_CONSTANT, getNodeInt(compiler, child));
+        break;
+    }
+    }
+}
+
+/**
+ * @brief 翻译一个实参，结构体按地址传递，数组元素和结构体的域如果是基本类型就传值
+ *
+ * @param exp 实参表达式
+ * @return Operand 实参的值
+ */
+static Operand translate_Arg(pCompiler compiler, pNode exp)
+{
+    Operand temp = newTemp(compiler);
+    translate_Exp(compiler, exp, &temp);
+    pType type = getExpType(compiler, exp);
+    if (type && type->kind == STRUCTURE)
     {
-        // Exp -> INT
-        interCodesWrap->tempVarNum--;
-        //因为updateOperand需要的是void *
-        int constant_Int = atoi(child->value);
-        updateOperand(place, OPERAND_CONSTANT, &constant_Int);
+        if (exp->production == EXP_ID && temp.kind == OPERAND_VARIABLE)
+        {
+            Operand addr = newTemp(compiler);
+            addInterCode(compiler->interCodesWrap, IR_GET_ADDR, 2, addr, temp);
+            temp = addr;
+        }
     }
+    else if (isAddressExp(exp))
+    {
+        addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, temp, temp);
+    }
+    return temp;
 }
 
-void translate_Args(pNode node)
+void translate_Args(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -1090,20 +1266,43 @@ void translate_Args(pNode node)
          |               Exp
     ;
      */
-    pNode exp = node->child;
-    pOperand temp = newTemp();
-    translate_Exp(exp, temp);
-    if (exp->child->brother && !strcmp(exp->child->brother->name, "LB"))
+    while (node)
     {
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_READ_ADDR, 2, temp, temp)));
+        pNode exp = getChild(node);
+        Operand temp = translate_Arg(compiler, exp);
+        addInterCode(compiler->interCodesWrap, IR_ARG, 1, temp);
+        // Args -> Exp COMMA Args
+        node = getBrother(exp) ? getBrother(getBrother(exp)) : NULL;
     }
-    addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_ARG, 1, temp)));
-    // Args -> Exp COMMA Args
-    if (exp->brother)
+}
+
+/**
+ * @brief read()翻译成READ，语句中单独调用read()时也要有地方放读进来的值
+ *
+ * @param args 没有参数，为NULL
+ * @param place 返回值
+ */
+void lowerRead(pCompiler compiler, pNode args, pOperand place)
+{
+    if (place)
     {
-        translate_Args(exp->brother->brother);
+        addInterCode(compiler->interCodesWrap, IR_READ, 1, *place);
+        return;
     }
-    freeOperand(temp);
+    Operand temp = newTemp(compiler);
+    addInterCode(compiler->interCodesWrap, IR_READ, 1, temp);
+}
+
+/**
+ * @brief write(x)翻译成WRITE，参数和普通函数的实参一样翻译，但是不产生ARG
+ *
+ * @param args Args节点，只有一个参数
+ * @param place write的返回值没有用到，不赋值
+ */
+void lowerWrite(pCompiler compiler, pNode args, pOperand place)
+{
+    Operand temp = translate_Arg(compiler, getChild(args));
+    addInterCode(compiler->interCodesWrap, IR_WRITE, 1, temp);
 }
 
 /**
@@ -1113,92 +1312,77 @@ void translate_Args(pNode node)
  * @param p1
  * @param p2
  */
-pInterCodes translate_Cond(pNode node, pOperand labelTrue, pOperand labelFalse)
+void translate_Cond(pCompiler compiler, pNode node, Operand labelTrue, Operand labelFalse)
 {
     assert(node != NULL);
-    // Exp -> Exp AND Exp
-    //      | Exp OR Exp
-    //      | Exp RELOP Exp
-    //      | NOT Exp
-
-    // Exp -> NOT Exp
-    if (!strcmp(node->child->name, "NOT"))
+    switch (node->production)
     {
-        translate_Cond(node->child->brother, labelFalse, labelTrue);
-    }
+    // Exp -> NOT Exp
+    case EXP_NOT:
+        translate_Cond(compiler, getBrother(getChild(node)), labelFalse, labelTrue);
+        break;
     // Exp -> Exp RELOP Exp
-    else if (!strcmp(node->child->brother->name, "RELOP"))
+    case EXP_RELOP:
     {
-        pNode exp1 = node->child;
-        pNode exp2 = node->child->brother->brother;
-        pOperand t1 = newTemp();
-        pOperand t2 = newTemp();
-        translate_Exp(exp1, t1);
-        translate_Exp(exp2, t2);
-        pOperand relop =
-            newOperand(OPERAND_RELOP, newString(node->child->brother->value));
+        pNode exp1 = getChild(node);
+        pNode exp2 = getBrother(getBrother(getChild(node)));
+        Operand t1 = newTemp(compiler);
+        Operand t2 = newTemp(compiler);
+        translate_Exp(compiler, exp1, &t1);
+        translate_Exp(compiler, exp2, &t2);
+        Operand relop = newNamedOperand(OPERAND_RELOP, getNodeValue(compiler, getBrother(getChild(node))));
 
         // 可能左边是一个二维数组
-        if (exp1->child->brother && !strcmp(exp1->child->brother->name, "LB"))
+        if (isAddressExp(exp1))
         {
-            addInterCodesToWrap(interCodesWrap,
-                                newInterCodes(newInterCode(IR_READ_ADDR, 2, t1, t1)));
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t1, t1);
         }
-        if (exp2->child->brother && !strcmp(exp2->child->brother->name, "LB"))
+        if (isAddressExp(exp2))
         {
-            addInterCodesToWrap(interCodesWrap,
-                                newInterCodes(newInterCode(IR_READ_ADDR, 2, t2, t2)));
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t2, t2);
         }
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_IF_GOTO, 4, t1, relop, t2, labelTrue)));
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_GOTO, 1, labelFalse)));
-        freeOperand(t1);
-        freeOperand(t2);
+        addInterCode(compiler->interCodesWrap, IR_IF_GOTO, 4, t1, relop, t2, labelTrue);
+        addInterCode(compiler->interCodesWrap, IR_GOTO, 1, labelFalse);
+        break;
     }
     // Exp -> Exp AND Exp
-    else if (!strcmp(node->child->brother->name, "AND"))
+    case EXP_AND:
     {
-        pOperand label1 = newLabel();
-        translate_Cond(node->child, label1, labelFalse);
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_LABEL, 1, label1)));
-        translate_Cond(node->child->brother->brother, labelTrue, labelFalse);
-        freeOperand(label1);
+        Operand label1 = newLabel(compiler);
+        translate_Cond(compiler, getChild(node), label1, labelFalse);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label1);
+        translate_Cond(compiler, getBrother(getBrother(getChild(node))), labelTrue, labelFalse);
+        break;
     }
     // Exp -> Exp OR Exp
-    else if (!strcmp(node->child->brother->name, "OR"))
+    case EXP_OR:
     {
-        pOperand label1 = newLabel();
-        translate_Cond(node->child, labelTrue, label1);
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_LABEL, 1, label1)));
-        translate_Cond(node->child->brother->brother, labelTrue, labelFalse);
-        freeOperand(label1);
+        Operand label1 = newLabel(compiler);
+        translate_Cond(compiler, getChild(node), labelTrue, label1);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label1);
+        translate_Cond(compiler, getBrother(getBrother(getChild(node))), labelTrue, labelFalse);
+        break;
     }
     // other cases
-    else
+    default:
     {
-        pOperand t1 = newTemp();
-        translate_Exp(node, t1);
-        int false_Constant = 0;
-        pOperand t2 = newOperand(OPERAND_CONSTANT, &false_Constant);
-        pOperand relop = newOperand(OPERAND_RELOP, newString("!="));
+        Operand t1 = newTemp(compiler);
+        translate_Exp(compiler, node, &t1);
+        Operand t2 = newOperand(OPERAND_CONSTANT, 0);
+        Operand relop = newNamedOperand(OPERAND_RELOP, intern(compiler->strings, "!="));
 
-        if (node->child->brother && !strcmp(node->child->brother->name, "LB"))
+        if (isAddressExp(node))
         {
-            addInterCodesToWrap(interCodesWrap,
-                                newInterCodes(newInterCode(IR_READ_ADDR, 2, t1, t1)));
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t1, t1);
         }
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_IF_GOTO, 4, t1, relop, t2, labelTrue)));
-        addInterCodesToWrap(interCodesWrap,
-                            newInterCodes(newInterCode(IR_GOTO, 1, labelFalse)));
-        freeOperand(t1);
+        addInterCode(compiler->interCodesWrap, IR_IF_GOTO, 4, t1, relop, t2, labelTrue);
+        addInterCode(compiler->interCodesWrap, IR_GOTO, 1, labelFalse);
+        break;
+    }
     }
 }
 
-void translate_StmtList(pNode node)
+void translate_StmtList(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -1208,12 +1392,12 @@ void translate_StmtList(pNode node)
     */
     while (node)
     {
-        translate_Stmt(node->child);
-        node = node->child->brother;
+        translate_Stmt(compiler, getChild(node));
+        node = getBrother(getChild(node));
     }
 }
 
-void translate_Stmt(pNode node)
+void translate_Stmt(pCompiler compiler, pNode node)
 {
     assert(node != NULL);
     /*
@@ -1225,71 +1409,74 @@ void translate_Stmt(pNode node)
         |               WHILE LP Exp RP Stmt
         ;
     */
-    // Stmt -> Exp SEMI
-    if (!strcmp(node->child->name, "Exp"))
+    switch (node->production)
     {
-        translate_Exp(node->child, NULL);
-    }
+    // Stmt -> Exp SEMI
+    case STMT_EXP:
+        translate_Exp(compiler, getChild(node), NULL);
+        break;
 
     // Stmt -> CompSt
-    else if (!strcmp(node->child->name, "CompSt"))
-    {
-        translate_CompSt(node->child);
-    }
+    case STMT_COMPST:
+        translate_CompSt(compiler, getChild(node));
+        break;
 
     // Stmt -> RETURN Exp SEMI
-    else if (!strcmp(node->child->name, "RETURN"))
+    case STMT_RETURN:
     {
-        pOperand t1 = newTemp();
-        translate_Exp(node->child->brother, t1);
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_RETURN, 1, t1)));
-        freeOperand(t1);
+        Operand t1 = newTemp(compiler);
+        translate_Exp(compiler, getBrother(getChild(node)), &t1);
+        if (isAddressExp(getBrother(getChild(node))))
+            addInterCode(compiler->interCodesWrap, IR_READ_ADDR, 2, t1, t1);
+        addInterCode(compiler->interCodesWrap, IR_RETURN, 1, t1);
+        break;
     }
 
     // Stmt -> IF LP Exp RP Stmt
-    else if (!strcmp(node->child->name, "IF"))
+    // Stmt -> IF LP Exp RP Stmt ELSE Stmt
+    case STMT_IF:
+    case STMT_IF_ELSE:
     {
-        pNode exp = node->child->brother->brother;
-        pNode stmt = exp->brother->brother;
-        pOperand label1 = newLabel();
-        pOperand label2 = newLabel();
-        translate_Cond(exp, label1, label2);
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label1)));
-        translate_Stmt(stmt);
+        pNode exp = getBrother(getBrother(getChild(node)));
+        pNode stmt = getBrother(getBrother(exp));
+        Operand label1 = newLabel(compiler);
+        Operand label2 = newLabel(compiler);
+        translate_Cond(compiler, exp, label1, label2);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label1);
+        translate_Stmt(compiler, stmt);
 
         // Stmt -> IF LP Exp RP Stmt ELSE Stmt
-        if (stmt->brother)
+        if (node->production == STMT_IF_ELSE)
         {
 
-            pOperand label3 = newLabel();
-            addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_GOTO, 1, label3)));
-            addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label2)));
-            translate_Stmt(stmt->brother->brother);
-            addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label3)));
-            freeOperand(label3);
+            Operand label3 = newLabel(compiler);
+            addInterCode(compiler->interCodesWrap, IR_GOTO, 1, label3);
+            addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label2);
+            translate_Stmt(compiler, getBrother(getBrother(stmt)));
+            addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label3);
         }
         else
         {
-            addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label2)));
+            addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label2);
         }
-        freeOperand(label1);
-        freeOperand(label2);
+        break;
     }
 
     // Stmt -> WHILE LP Exp RP Stmt
-    else if (!strcmp(node->child->name, "WHILE"))
+    case STMT_WHILE:
     {
-        pOperand label1 = newLabel();
-        pOperand label2 = newLabel();
-        pOperand label3 = newLabel();
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label1)));
-        translate_Cond(node->child->brother->brother, label2, label3);
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label2)));
-        translate_Stmt(node->child->brother->brother->brother->brother);
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_GOTO, 1, label1)));
-        addInterCodesToWrap(interCodesWrap, newInterCodes(newInterCode(IR_LABEL, 1, label3)));
-        freeOperand(label1);
-        freeOperand(label2);
-        freeOperand(label3);
+        Operand label1 = newLabel(compiler);
+        Operand label2 = newLabel(compiler);
+        Operand label3 = newLabel(compiler);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label1);
+        translate_Cond(compiler, getBrother(getBrother(getChild(node))), label2, label3);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label2);
+        translate_Stmt(compiler, getBrother(getBrother(getBrother(getBrother(getChild(node))))));
+        addInterCode(compiler->interCodesWrap, IR_GOTO, 1, label1);
+        addInterCode(compiler->interCodesWrap, IR_LABEL, 1, label3);
+        break;
+    }
+    default:
+        break;
     }
 }
\ No newline at end of file
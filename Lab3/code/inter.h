@@ -4,12 +4,9 @@
 #include "semantics.h"
 #include "util.h"
 
-typedef struct Operand_ *pOperand;               //运算对象
-typedef struct InterCode_ *pInterCode;           //中间代码的体
-typedef struct InterCodes_ *pInterCodes;         //中间代码的头，包含了前后两条中间代码指针
-typedef struct InterCodesWrap_ *pInterCodesWrap; //中间代码序列的包装，记录了中间代码的头和尾
-
-extern pSymbolTable symbolTable;
+typedef struct Operand_ Operand, *pOperand;      //运算对象
+typedef struct InterCode_ *pInterCode;           //一条中间代码
+typedef struct InterCodesWrap_ *pInterCodesWrap; //中间代码序列，所有中间代码连续存放在一个数组中
 
 struct Operand_
 {
@@ -21,12 +18,13 @@ struct Operand_
         OPERAND_FUNCTION, //函数
         OPERAND_ADDRESS,  //函数的一维数组参数地址，改个名字可能好点
         OPERAND_RELOP,    //逻辑运算符
-        OPERAND_LABEL     //标号，跳转语句用
+        OPERAND_LABEL,    //标号，跳转语句用
+        OPERAND_TEMP      //临时变量
     } kind;
     union
     {
-        char *name;
-        int value;
+        int value; //常量的值
+        int id;    //临时变量和标号是自己的编号，可以直接做数组下标；其他的是名字在驻留池中的编号，见getInternString
     } u;
 };
 
@@ -59,32 +57,26 @@ struct InterCode_
     {
         struct
         {
-            pOperand op;
+            struct Operand_ op;
         } oneOp;
         struct
         {
-            pOperand right, left;
+            struct Operand_ right, left;
         } assign;
         struct
         {
-            pOperand result, op1, op2;
+            struct Operand_ result, op1, op2;
         } binOp;
         struct
         {
-            pOperand x, relop, y, z;
+            struct Operand_ x, relop, y, z;
         } ifGoto;
         struct
         {
-            pOperand op;
+            struct Operand_ op;
             int size;
         } dec;
-    } u;
-};
-
-struct InterCodes_
-{
-    pInterCode code;
-    pInterCodes prev, next;
+    } u; //运算分量直接放在中间代码里面，不用再单独申请
 };
 
 // struct dimInfo_
@@ -106,11 +98,23 @@ struct InterCodes_
 //     int size;
 // };
 
+/**
+ * @brief 中间代码序列。中间代码按顺序放在codes中，遍历就是顺着下标扫一遍，
+ * 加中间代码和扩容都可能移动数组，所以只能在两次修改之间拿着指向中间代码的指针。
+ * 标号表记下每个标号所在的中间代码的下标，跳转时不用再找标号
+ *
+ */
 struct InterCodesWrap_
 {
-    pInterCodes head; //第一条中间代码的头
-    pInterCodes tail; //末尾的中间代码的尾
-    
+    struct InterCode_ *codes; //所有的中间代码
+    unsigned count;           //中间代码的条数
+    unsigned capacity;        //codes的长度
+
+    int *labels;            //标号表，labels[i]是编号为labelBase+i的标号的下标，-1表示不在序列中
+    unsigned labelCount;    //标号表中填过的项数
+    unsigned labelCapacity; //labels的长度
+    int labelBase;          //标号表中第一个标号的编号，清空序列时从labelNum重新开始
+
     int labelNum;     //符号数,用于给符号命名，符号用于跳转
     int tempVarNum;   //临时变量数，用于给临时变量命令
 };
@@ -134,38 +138,46 @@ struct InterCodesWrap_
 //     int size;
 // };
 
-pOperand newOperand(int kind, void *val);
-void updateOperand(pOperand p, int kind, void *val);
-pOperand copyOperand(pOperand p);
-void freeOperand(pOperand p);
-void printOperand(pOperand operand);
+/*有名字的运算分量按编号取名字，编译时从驻留池中取，读二进制中间代码时从文件的字符串表中取*/
+typedef const char *(*OperandNameFunc)(const void *names, int id, uint32_t *length);
 
-pInterCodes newInterCodes(pInterCode interCode);
-void freeInterCodes(pInterCodes p);
+Operand newOperand(int kind, int value);
+Operand newNamedOperand(int kind, const char *name);
+Operand newTemp(pCompiler compiler);
+Operand newLabel(pCompiler compiler);
 
 pInterCodesWrap newInterCodesWrap();
-void addInterCodesToWrap(pInterCodesWrap codes, pInterCodes newcode);
+unsigned addInterCode(pInterCodesWrap codes, int kind, int argc, ...);
+void insertInterCode(pInterCodesWrap codes, unsigned index, int kind, int argc, ...);
+void removeInterCodes(pInterCodesWrap codes, unsigned index, unsigned n);
+void compactInterCodes(pInterCodesWrap codes, const bool *removed);
+void appendInterCodes(pInterCodesWrap codes, pInterCodesWrap part);
+int getLabelIndex(pInterCodesWrap codes, int label);
+void clearInterCodesWrap(pInterCodesWrap codes);
 void freeInterCodesWrap(pInterCodesWrap codes);
-void printInterCodes(pInterCodesWrap interCodesWrap);
+void writeInterCodes(FILE *out, const struct InterCode_ *codes, unsigned count, OperandNameFunc getName, const void *names);
+void printInterCodes(pCompiler compiler, pInterCodesWrap interCodesWrap);
 
 // 这里的函数作用很简单，就是不停的自顶向下走就好了
-void generateInterCodes(pNode node);
-void translate_ExtDef(pNode node);
-void translate_FunDec(pNode node);
-void translate_CompSt(pNode node);
-void translate_DefList(pNode node);
-void translate_Def(pNode node);
-void translate_DecList(pNode node);
-void translate_Dec(pNode node);
-void translate_VarDec(pNode node, pOperand place);
-void translate_StmtList(pNode node);
+void generateInterCodes(pCompiler compiler, pNode node);
+void translate_ExtDef(pCompiler compiler, pNode node);
+void translate_FunDec(pCompiler compiler, pNode node);
+void translate_CompSt(pCompiler compiler, pNode node);
+void translate_DefList(pCompiler compiler, pNode node);
+void translate_Def(pCompiler compiler, pNode node);
+void translate_DecList(pCompiler compiler, pNode node);
+void translate_Dec(pCompiler compiler, pNode node);
+void translate_VarDec(pCompiler compiler, pNode node, pOperand place);
+void translate_StmtList(pCompiler compiler, pNode node);
 
 //下面这三个基本表达式翻译，语句翻译，条件表达式翻译直接参考指导书进行翻译
-void translate_Exp(pNode exp, pOperand place);
-void translate_Stmt(pNode node);
-pInterCodes translate_Cond(pNode node, pOperand labelTrue, pOperand labelFalse);
-
-//很简单，直接翻译就好了，如果未来发现遇到的是write这样的就删掉代码就行
-void translate_Args(pNode node);
+void translate_Exp(pCompiler compiler, pNode exp, pOperand place);
+void translate_Stmt(pCompiler compiler, pNode node);
+void translate_Cond(pCompiler compiler, pNode node, Operand labelTrue, Operand labelFalse);
+
+//普通函数的实参逐个翻译成ARG；read、write这样的内置函数不走这里，由Builtin_的lower钩子翻译成READ、WRITE
+void translate_Args(pCompiler compiler, pNode node);
+void lowerRead(pCompiler compiler, pNode args, pOperand place);
+void lowerWrite(pCompiler compiler, pNode args, pOperand place);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "intern.h"
+#include <stdio.h>
+
+#define ENTRY_OF(s) ((pInternEntry)((s) - offsetof(struct InternEntry_, str)))
+
+/**
+ * @brief FNV-1a hash，分布比较均匀，而且不需要\0结尾
+ *
+ * @param str 字符串
+ * @param length 长度
+ * @return uint32_t hash值
+ */
+static inline uint32_t hashFNV1a(const char *str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void *internRealloc(void *p, size_t size)
+{
+    p = realloc(p, size);
+    if (!p)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, size);
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/**
+ * @brief 建立一个空的驻留池
+ *
+ * @return pInternTable
+ */
+pInternTable newInternTable()
+{
+    pInternTable table = internRealloc(NULL, sizeof(struct InternTable_));
+    table->arena = newArena(0);
+    table->capacity = INTERN_TABLE_INIT_SIZE;
+    table->buckets = calloc(table->capacity, sizeof(pInternEntry));
+    if (!table->buckets)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, table->capacity * sizeof(pInternEntry));
+        exit(EXIT_FAILURE);
+    }
+    table->count = 0;
+    table->byIdCapacity = INTERN_TABLE_INIT_SIZE;
+    table->byId = internRealloc(NULL, table->byIdCapacity * sizeof(pInternEntry));
+    table->byId[0] = NULL;
+    return table;
+}
+
+/**
+ * @brief 桶数翻倍，用缓存的hash值重新放置，不需要重新计算hash
+ *
+ */
+static void growInternTable(pInternTable table)
+{
+    uint32_t newCapacity = table->capacity * 2;
+    pInternEntry *newBuckets = calloc(newCapacity, sizeof(pInternEntry));
+    if (!newBuckets)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, newCapacity * sizeof(pInternEntry));
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < table->capacity; i++)
+    {
+        pInternEntry entry = table->buckets[i];
+        if (entry)
+        {
+            uint32_t index = entry->hash & (newCapacity - 1);
+            while (newBuckets[index])
+                index = (index + 1) & (newCapacity - 1);
+            newBuckets[index] = entry;
+        }
+    }
+    free(table->buckets);
+    table->buckets = newBuckets;
+    table->capacity = newCapacity;
+}
+
+/**
+ * @brief 驻留一个不一定以\0结尾的字符串
+ *
+ * @param table 驻留池
+ * @param str 字符串
+ * @param length 长度
+ * @return const char* 驻留池中的字符串，在驻留池释放之前都有效
+ */
+const char *internN(pInternTable table, const char *str, size_t length)
+{
+    if (str == NULL)
+        return NULL;
+    uint32_t hash = hashFNV1a(str, length);
+    uint32_t index = hash & (table->capacity - 1);
+    pInternEntry entry;
+    while ((entry = table->buckets[index]) != NULL)
+    {
+        if (entry->hash == hash && entry->length == length && !memcmp(entry->str, str, length))
+            return entry->str;
+        index = (index + 1) & (table->capacity - 1);
+    }
+    //装载因子超过3/4就扩容，扩容后重新找空桶
+    if ((table->count + 1) * 4 > table->capacity * 3)
+    {
+        growInternTable(table);
+        index = hash & (table->capacity - 1);
+        while (table->buckets[index])
+            index = (index + 1) & (table->capacity - 1);
+    }
+    entry = arenaAlloc(table->arena, sizeof(struct InternEntry_) + length + 1);
+    entry->hash = hash;
+    entry->length = length;
+    memcpy(entry->str, str, length);
+    entry->str[length] = '\0';
+    table->buckets[index] = entry;
+
+    entry->id = ++table->count;
+    if (entry->id >= table->byIdCapacity)
+    {
+        table->byIdCapacity *= 2;
+        table->byId = internRealloc(table->byId, table->byIdCapacity * sizeof(pInternEntry));
+    }
+    table->byId[entry->id] = entry;
+    return entry->str;
+}
+
+/**
+ * @brief 驻留一个以\0结尾的字符串
+ *
+ * @param table 驻留池
+ * @param str 字符串
+ * @return const char* 驻留池中的字符串
+ */
+const char *intern(pInternTable table, const char *str)
+{
+    if (str == NULL)
+        return NULL;
+    return internN(table, str, strlen(str));
+}
+
+/**
+ * @brief 建立一个不放进驻留池的字符串，它和驻留过的字符串有一样的头，可以用getInternHash和getInternLength，
+ * 编号为0，和任何别的字符串的指针都不相等。用来给未命名的结构体起名字，不用写驻留池，
+ * 所以在别的线程同时读驻留池的时候也可以调用
+ *
+ * @param arena 放在这里
+ * @param str 字符串
+ * @return const char*
+ */
+const char *newUniqueString(pArena arena, const char *str)
+{
+    size_t length = strlen(str);
+    pInternEntry entry = arenaAlloc(arena, sizeof(struct InternEntry_) + length + 1);
+    entry->hash = hashFNV1a(str, length);
+    entry->id = 0;
+    entry->length = length;
+    memcpy(entry->str, str, length + 1);
+    return entry->str;
+}
+
+/**
+ * @brief 驻留过的字符串的编号，只能传入intern返回的指针
+ *
+ * @param interned 驻留过的字符串
+ * @return uint32_t 编号，NULL返回0
+ */
+uint32_t getInternId(const char *interned)
+{
+    return interned ? ENTRY_OF(interned)->id : 0;
+}
+
+/**
+ * @brief 驻留时算好的hash值，只能传入intern返回的指针
+ *
+ * @param interned 驻留过的字符串
+ * @return uint32_t
+ */
+uint32_t getInternHash(const char *interned)
+{
+    return interned ? ENTRY_OF(interned)->hash : 0;
+}
+
+/**
+ * @brief 驻留过的字符串的长度，只能传入intern返回的指针
+ *
+ * @param interned 驻留过的字符串
+ * @return uint32_t
+ */
+uint32_t getInternLength(const char *interned)
+{
+    return interned ? ENTRY_OF(interned)->length : 0;
+}
+
+/**
+ * @brief 按编号取回字符串
+ *
+ * @param table 驻留池
+ * @param id getInternId得到的编号
+ * @return const char* 编号不存在时返回NULL
+ */
+const char *getInternString(pInternTable table, uint32_t id)
+{
+    if (id == 0 || id > table->count)
+        return NULL;
+    return table->byId[id]->str;
+}
+
+uint32_t getInternCount(pInternTable table)
+{
+    return table->count;
+}
+
+size_t getInternUsedBytes(pInternTable table)
+{
+    return arenaUsedBytes(table->arena) + table->capacity * sizeof(pInternEntry) +
+           table->byIdCapacity * sizeof(pInternEntry);
+}
+
+/**
+ * @brief 编译结束后释放驻留池，之后这个池中驻留过的字符串都不能再用
+ *
+ * @param table 驻留池，可以为NULL
+ */
+void freeInternTable(pInternTable table)
+{
+    if (table == NULL)
+        return;
+    freeArena(table->arena);
+    free(table->buckets);
+    free(table->byId);
+    free(table);
+}
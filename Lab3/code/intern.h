@@ -0,0 +1,55 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define INTERN_TABLE_INIT_SIZE 1024 //初始的桶数，必须是2的幂
+
+typedef struct InternEntry_ *pInternEntry;
+
+/**
+ * @brief 驻留池中的一个字符串，字符串本身紧跟在结构体后面
+ *
+ */
+struct InternEntry_
+{
+    uint32_t hash;   //字符串的hash值，扩容时不需要重新计算
+    uint32_t id;     //按照加入的顺序编号，从1开始，0表示没有
+    uint32_t length; //字符串长度，不包括\0
+    char str[];
+};
+
+typedef struct InternTable_ *pInternTable;
+
+/**
+ * @brief 字符串驻留池，每次编译一个，不同编译之间不共享，所以可以在不同的线程中同时使用
+ *
+ */
+struct InternTable_
+{
+    pArena arena;             //所有驻留的字符串都放在这里
+    pInternEntry *buckets;    //开放定址的hash表
+    uint32_t capacity;        //桶数，总是2的幂
+    uint32_t count;           //已经驻留的字符串个数
+    pInternEntry *byId;       //按编号查字符串，下标0不用
+    uint32_t byIdCapacity;
+};
+
+/*
+    一次编译共用的字符串驻留池，词法分析、语义分析和中间代码生成里的名字都从这里拿。
+    同样拼写的字符串只会保存一份，所以同一个池中两个驻留过的字符串相等当且仅当指针相等。
+*/
+pInternTable newInternTable();
+const char *intern(pInternTable table, const char *str);
+const char *internN(pInternTable table, const char *str, size_t length);
+const char *newUniqueString(pArena arena, const char *str);
+uint32_t getInternId(const char *interned);
+uint32_t getInternHash(const char *interned);
+uint32_t getInternLength(const char *interned);
+const char *getInternString(pInternTable table, uint32_t id);
+uint32_t getInternCount(pInternTable table);
+size_t getInternUsedBytes(pInternTable table);
+void freeInternTable(pInternTable table);
+#endif
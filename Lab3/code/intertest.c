@@ -0,0 +1,218 @@
+#include "inter.h"
+
+/*
+ * 中间代码序列的增删测试：在有LABEL、GOTO和IF的序列中用insertInterCode、removeInterCodes、
+ * compactInterCodes和appendInterCodes增删中间代码，每次修改以后检查标号表，
+ * 再把整个序列输出成文本和期望的结果比较
+ * 用法：make intertest
+ */
+
+static const char *names[] = {"==", "<"}; //测试中只有逻辑运算符有名字，编号就是下标
+
+static const char *getTestName(const void *table, int id, uint32_t *length)
+{
+    const char *const *strings = table;
+    *length = strlen(strings[id]);
+    return strings[id];
+}
+
+static Operand label(int id)
+{
+    return newOperand(OPERAND_LABEL, id);
+}
+
+static Operand temp(int id)
+{
+    return newOperand(OPERAND_TEMP, id);
+}
+
+static Operand constant(int value)
+{
+    return newOperand(OPERAND_CONSTANT, value);
+}
+
+static Operand relop(int id)
+{
+    return newOperand(OPERAND_RELOP, id);
+}
+
+/**
+ * @brief 检查标号表：序列中的每个LABEL都能按编号找到自己的下标，每个GOTO和IF跳到的标号都还在序列中，
+ * 不在序列中的标号查出来是-1
+ *
+ * @param codes 中间代码序列
+ * @param step 第几步，出错时打印
+ * @param missing 已经删掉的标号，以-1结尾
+ * @return true 标号表正确
+ */
+static bool checkLabels(pInterCodesWrap codes, const char *step, const int *missing)
+{
+    for (unsigned i = 0; i < codes->count; i++)
+    {
+        const struct InterCode_ *code = &codes->codes[i];
+        int target = -1;
+        if (code->kind == IR_LABEL && getLabelIndex(codes, code->u.oneOp.op.u.id) != (int)i)
+        {
+            printf("%s: label%d is at %u, label table says %d\n", step, code->u.oneOp.op.u.id, i,
+                   getLabelIndex(codes, code->u.oneOp.op.u.id));
+            return false;
+        }
+        if (code->kind == IR_GOTO)
+            target = code->u.oneOp.op.u.id;
+        else if (code->kind == IR_IF_GOTO)
+            target = code->u.ifGoto.z.u.id;
+        if (target == -1)
+            continue;
+        int index = getLabelIndex(codes, target);
+        if (index < 0 || codes->codes[index].kind != IR_LABEL || codes->codes[index].u.oneOp.op.u.id != target)
+        {
+            printf("%s: jump at %u goes to label%d, which the label table puts at %d\n", step, i, target, index);
+            return false;
+        }
+    }
+    for (; *missing != -1; missing++)
+    {
+        if (getLabelIndex(codes, *missing) != -1)
+        {
+            printf("%s: label%d was removed, label table still says %d\n", step, *missing,
+                   getLabelIndex(codes, *missing));
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 检查标号在序列中的下标
+ *
+ * @param codes 中间代码序列
+ * @param step 第几步，出错时打印
+ * @param id 标号的编号
+ * @param index 期望的下标
+ * @return true 一样
+ */
+static bool checkIndex(pInterCodesWrap codes, const char *step, int id, int index)
+{
+    if (getLabelIndex(codes, id) == index)
+        return true;
+    printf("%s: expected label%d at %d, label table says %d\n", step, id, index, getLabelIndex(codes, id));
+    return false;
+}
+
+/**
+ * @brief 把序列输出成文本和expected比较
+ *
+ * @param codes 中间代码序列
+ * @param step 第几步，出错时打印
+ * @param expected 期望的文本
+ * @return true 一样
+ */
+static bool checkText(pInterCodesWrap codes, const char *step, const char *expected)
+{
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (!out)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(memstream)\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    writeInterCodes(out, codes->codes, codes->count, getTestName, names);
+    fclose(out);
+    bool same = !strcmp(text, expected);
+    if (!same)
+        printf("%s: expected\n%sgot\n%s", step, expected, text);
+    free(text);
+    return same;
+}
+
+int main()
+{
+    pInterCodesWrap codes = newInterCodesWrap();
+    codes->labelNum = 4;
+    codes->tempVarNum = 2;
+    addInterCode(codes, IR_LABEL, 1, label(0));
+    addInterCode(codes, IR_ASSIGN, 2, temp(0), constant(1));
+    addInterCode(codes, IR_IF_GOTO, 4, temp(0), relop(0), constant(0), label(1));
+    addInterCode(codes, IR_GOTO, 1, label(0));
+    addInterCode(codes, IR_LABEL, 1, label(1));
+    addInterCode(codes, IR_RETURN, 1, temp(0));
+    int none[] = {-1};
+    if (!checkLabels(codes, "add", none) || !checkIndex(codes, "add", 0, 0) || !checkIndex(codes, "add", 1, 4))
+        return 1;
+
+    //插到最前面和中间，后面的标号都往后挪；插到末尾和addInterCode一样
+    insertInterCode(codes, 0, IR_LABEL, 1, label(2));
+    insertInterCode(codes, 3, IR_ASSIGN, 2, temp(1), temp(0));
+    insertInterCode(codes, codes->count, IR_LABEL, 1, label(3));
+    insertInterCode(codes, codes->count - 1, IR_GOTO, 1, label(2));
+    if (!checkLabels(codes, "insert", none) || !checkIndex(codes, "insert", 2, 0) ||
+        !checkIndex(codes, "insert", 0, 1) || !checkIndex(codes, "insert", 1, 6) || !checkIndex(codes, "insert", 3, 9))
+        return 1;
+    if (!checkText(codes, "insert",
+                   "LABEL label2 :\n"
+                   "LABEL label0 :\n"
+                   "t0 := #1\n"
+                   "t1 := t0\n"
+                   "IF t0 == #0 GOTO label1\n"
+                   "GOTO label0\n"
+                   "LABEL label1 :\n"
+                   "RETURN t0\n"
+                   "GOTO label2\n"
+                   "LABEL label3 :\n"))
+        return 1;
+
+    //删掉中间的一条，后面的标号往前挪；删掉的标号在标号表中变成-1
+    removeInterCodes(codes, 8, 1);
+    if (!checkLabels(codes, "remove", none) || !checkIndex(codes, "remove", 3, 8))
+        return 1;
+    removeInterCodes(codes, 8, 1);
+    int removedLabel3[] = {3, -1};
+    if (!checkLabels(codes, "remove label", removedLabel3) || !checkIndex(codes, "remove label", 1, 6))
+        return 1;
+
+    //一次删掉不连续的几条，剩下的标号重新登记
+    bool marks[8] = {true, false, false, true, false, false, false, false};
+    compactInterCodes(codes, marks);
+    int removedLabel2[] = {2, 3, -1};
+    if (!checkLabels(codes, "compact", removedLabel2) || !checkIndex(codes, "compact", 0, 0) ||
+        !checkIndex(codes, "compact", 1, 4))
+        return 1;
+    if (!checkText(codes, "compact",
+                   "LABEL label0 :\n"
+                   "t0 := #1\n"
+                   "IF t0 == #0 GOTO label1\n"
+                   "GOTO label0\n"
+                   "LABEL label1 :\n"
+                   "RETURN t0\n"))
+        return 1;
+
+    //接上另一个编号从0开始的序列，它的标号和临时变量接着往后排
+    pInterCodesWrap part = newInterCodesWrap();
+    part->labelNum = 2;
+    part->tempVarNum = 1;
+    addInterCode(part, IR_LABEL, 1, label(1));
+    addInterCode(part, IR_IF_GOTO, 4, temp(0), relop(1), constant(3), label(0));
+    addInterCode(part, IR_GOTO, 1, label(1));
+    addInterCode(part, IR_LABEL, 1, label(0));
+    appendInterCodes(codes, part);
+    freeInterCodesWrap(part);
+    if (!checkLabels(codes, "append", removedLabel2) || !checkIndex(codes, "append", 5, 6) ||
+        !checkIndex(codes, "append", 4, 9))
+        return 1;
+    if (!checkText(codes, "append",
+                   "LABEL label0 :\n"
+                   "t0 := #1\n"
+                   "IF t0 == #0 GOTO label1\n"
+                   "GOTO label0\n"
+                   "LABEL label1 :\n"
+                   "RETURN t0\n"
+                   "LABEL label5 :\n"
+                   "IF t2 < #3 GOTO label4\n"
+                   "GOTO label5\n"
+                   "LABEL label4 :\n"))
+        return 1;
+    freeInterCodesWrap(codes);
+    printf("insert, remove, compact and append OK, label table matches the LABELs after every step\n");
+    return 0;
+}
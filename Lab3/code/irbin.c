@@ -0,0 +1,530 @@
+#include "compiler.h"
+#include "irbin.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(IRFileHeader) == 64 && sizeof(IRString) == 8 && sizeof(IRFunction) == 12 && sizeof(IRRecord) == 24,
+               "binary IR records must have a fixed layout");
+
+#define IR_ALIGN(n) (((n) + 7) & ~(uint64_t)7) //各段都从8字节对齐的位置开始
+#define IR_DECODE_CHUNK 4096                   //printIRFile一次还原这么多条指令
+
+//每种中间代码有几个运算分量，下标是InterCode_的kind
+static const uint8_t operandCounts[] = {
+    [IR_LABEL] = 1, [IR_FUNCTION] = 1, [IR_ASSIGN] = 2, [IR_ADD] = 3, [IR_SUB] = 3, [IR_MUL] = 3, [IR_DIV] = 3,
+    [IR_GET_ADDR] = 2, [IR_READ_ADDR] = 2, [IR_WRITE_ADDR] = 2, [IR_GOTO] = 1, [IR_IF_GOTO] = 4, [IR_RETURN] = 1,
+    [IR_DEC] = 2, [IR_ARG] = 1, [IR_CALL] = 2, [IR_PARAM] = 1, [IR_READ] = 1, [IR_WRITE] = 1};
+
+#define IR_KIND_COUNT (sizeof(operandCounts) / sizeof(operandCounts[0]))
+
+/**
+ * @brief 按文本格式中出现的顺序取出一条中间代码的运算分量，DEC的大小当作常量
+ *
+ * @param code 中间代码
+ * @param ops 运算分量写到这里
+ */
+static void getOperands(const struct InterCode_ *code, struct Operand_ ops[4])
+{
+    switch (code->kind)
+    {
+    case IR_ASSIGN:
+    case IR_GET_ADDR:
+    case IR_READ_ADDR:
+    case IR_WRITE_ADDR:
+    case IR_CALL:
+        ops[0] = code->u.assign.left;
+        ops[1] = code->u.assign.right;
+        break;
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+        ops[0] = code->u.binOp.result;
+        ops[1] = code->u.binOp.op1;
+        ops[2] = code->u.binOp.op2;
+        break;
+    case IR_IF_GOTO:
+        ops[0] = code->u.ifGoto.x;
+        ops[1] = code->u.ifGoto.relop;
+        ops[2] = code->u.ifGoto.y;
+        ops[3] = code->u.ifGoto.z;
+        break;
+    case IR_DEC:
+        ops[0] = code->u.dec.op;
+        ops[1] = newOperand(OPERAND_CONSTANT, code->u.dec.size);
+        break;
+    default:
+        ops[0] = code->u.oneOp.op;
+        break;
+    }
+}
+
+/**
+ * @brief 把文件中的一条指令还原成中间代码，有名字的运算分量记的是字符串表的下标，不是驻留池的编号
+ *
+ * @param record 文件中的指令，必须是openIRFile检查过的
+ * @param code 还原到这里
+ */
+void decodeIRRecord(const IRRecord *record, struct InterCode_ *code)
+{
+    struct Operand_ ops[4];
+    for (int i = 0; i < 4; i++)
+    {
+        ops[i].kind = record->opKinds[i];
+        ops[i].u.value = record->ops[i];
+    }
+    code->kind = record->kind;
+    switch (code->kind)
+    {
+    case IR_ASSIGN:
+    case IR_GET_ADDR:
+    case IR_READ_ADDR:
+    case IR_WRITE_ADDR:
+    case IR_CALL:
+        code->u.assign.left = ops[0];
+        code->u.assign.right = ops[1];
+        break;
+    case IR_ADD:
+    case IR_SUB:
+    case IR_MUL:
+    case IR_DIV:
+        code->u.binOp.result = ops[0];
+        code->u.binOp.op1 = ops[1];
+        code->u.binOp.op2 = ops[2];
+        break;
+    case IR_IF_GOTO:
+        code->u.ifGoto.x = ops[0];
+        code->u.ifGoto.relop = ops[1];
+        code->u.ifGoto.y = ops[2];
+        code->u.ifGoto.z = ops[3];
+        break;
+    case IR_DEC:
+        code->u.dec.op = ops[0];
+        code->u.dec.size = ops[1].u.value;
+        break;
+    default:
+        code->u.oneOp.op = ops[0];
+        break;
+    }
+}
+
+/**
+ * @brief 写一段，后面补0到8字节对齐
+ *
+ * @param data 内容
+ * @param size 字节数
+ * @param out 输出
+ * @return true 写完了
+ * @return false 没写完，比如磁盘满了，errno记着原因
+ */
+static bool writeSection(const void *data, uint64_t size, FILE *out)
+{
+    static const char zeros[8];
+    if (size && fwrite(data, 1, size, out) != size)
+        return false;
+    uint64_t padding = IR_ALIGN(size) - size;
+    return !padding || fwrite(zeros, 1, padding, out) == padding;
+}
+
+/**
+ * @brief 把中间代码按二进制格式写到compiler->irOut。
+ * 有名字的运算分量按第一次用到的顺序放进字符串表，驻留池中没有用到的名字不写；
+ * 函数表按FUNCTION切分指令，标号表记下每个标号所在的指令
+ *
+ * @param interCodesWrap 中间代码序列
+ * @return true 写完了
+ * @return false 文件超过了4GB，偏移放不进uint32_t，什么也没写；或者没写完。都已经打印了原因
+ */
+bool writeIRFile(pCompiler compiler, pInterCodesWrap interCodesWrap)
+{
+    unsigned count = interCodesWrap->count;
+    uint32_t internCount = getInternCount(compiler->strings);
+    uint32_t *stringIndex = calloc(internCount + 1, sizeof(uint32_t)); //驻留池编号对应的字符串表下标加1，0表示还没有用到
+    uint32_t *stringIds = malloc((internCount + 1) * sizeof(uint32_t)); //字符串表每一项的驻留池编号
+    IRRecord *records = calloc(count + 1, sizeof(IRRecord));
+    IRFunction *functions = malloc((count + 1) * sizeof(IRFunction));
+    if (!stringIndex || !stringIds || !records || !functions)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%u instructions)\n", __FILE__, __LINE__, count);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t stringCount = 0, functionCount = 0;
+    uint64_t stringDataSize = 0;
+    int maxTemp = -1, maxLabel = -1;
+    for (unsigned i = 0; i < count; i++)
+    {
+        const struct InterCode_ *code = &interCodesWrap->codes[i];
+        IRRecord *record = &records[i];
+        struct Operand_ ops[4];
+        getOperands(code, ops);
+        record->kind = code->kind;
+        for (int j = 0; j < operandCounts[code->kind]; j++)
+        {
+            record->opKinds[j] = ops[j].kind;
+            record->ops[j] = ops[j].u.value;
+            switch (ops[j].kind)
+            {
+            case OPERAND_VARIABLE:
+            case OPERAND_FUNCTION:
+            case OPERAND_ADDRESS:
+            case OPERAND_RELOP:
+                if (!stringIndex[ops[j].u.id])
+                {
+                    stringIds[stringCount] = ops[j].u.id;
+                    stringIndex[ops[j].u.id] = ++stringCount;
+                    stringDataSize += getInternLength(getInternString(compiler->strings, ops[j].u.id)) + 1;
+                }
+                record->ops[j] = stringIndex[ops[j].u.id] - 1;
+                break;
+            case OPERAND_TEMP:
+                if (ops[j].u.id > maxTemp)
+                    maxTemp = ops[j].u.id;
+                break;
+            case OPERAND_LABEL:
+                if (ops[j].u.id > maxLabel)
+                    maxLabel = ops[j].u.id;
+                break;
+            default:
+                break;
+            }
+        }
+        if (code->kind == IR_FUNCTION)
+        {
+            if (functionCount)
+                functions[functionCount - 1].count = i - functions[functionCount - 1].first;
+            functions[functionCount].name = record->ops[0];
+            functions[functionCount].first = i;
+            functionCount++;
+        }
+    }
+    if (functionCount)
+        functions[functionCount - 1].count = count - functions[functionCount - 1].first;
+
+    IRFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IR_FILE_MAGIC, 4);
+    header.version = IR_FILE_VERSION;
+    header.tempCount = maxTemp + 1;
+    header.labelCount = maxLabel + 1;
+    uint64_t offset = sizeof(IRFileHeader);
+    header.stringCount = stringCount;
+    header.stringsOffset = offset;
+    offset += IR_ALIGN((uint64_t)stringCount * sizeof(IRString));
+    header.stringDataSize = stringDataSize;
+    header.stringDataOffset = offset;
+    offset += IR_ALIGN(stringDataSize);
+    header.functionCount = functionCount;
+    header.functionsOffset = offset;
+    offset += IR_ALIGN((uint64_t)functionCount * sizeof(IRFunction));
+    header.codeCount = count;
+    header.codesOffset = offset;
+    offset += (uint64_t)count * sizeof(IRRecord);
+    header.labelsOffset = offset;
+    offset += IR_ALIGN((uint64_t)header.labelCount * sizeof(int32_t));
+    header.fileSize = offset;
+    if (offset > UINT32_MAX)
+    {
+        fprintf(compiler->err, "binary IR would be %llu bytes, more than the format allows\n", (unsigned long long)offset);
+        free(stringIndex);
+        free(stringIds);
+        free(records);
+        free(functions);
+        return false;
+    }
+
+    //字符串表和字符串区都按字符串表的顺序排，字符串区里每个名字后面跟一个\0
+    IRString *strings = malloc((stringCount + 1) * sizeof(IRString));
+    char *stringData = malloc(stringDataSize + 1);
+    int32_t *labels = malloc((header.labelCount + 1) * sizeof(int32_t));
+    if (!strings || !stringData || !labels)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%llu bytes)\n", __FILE__, __LINE__, (unsigned long long)stringDataSize);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < stringCount; i++)
+    {
+        const char *name = getInternString(compiler->strings, stringIds[i]);
+        strings[i].offset = used;
+        strings[i].length = getInternLength(name);
+        memcpy(stringData + used, name, strings[i].length + 1);
+        used += strings[i].length + 1;
+    }
+    for (uint32_t i = 0; i < header.labelCount; i++)
+        labels[i] = -1;
+    for (unsigned i = 0; i < count; i++)
+        if (records[i].kind == IR_LABEL)
+            labels[records[i].ops[0]] = i;
+
+    bool written = writeSection(&header, sizeof(header), compiler->irOut) &&
+                   writeSection(strings, (uint64_t)stringCount * sizeof(IRString), compiler->irOut) &&
+                   writeSection(stringData, stringDataSize, compiler->irOut) &&
+                   writeSection(functions, (uint64_t)functionCount * sizeof(IRFunction), compiler->irOut) &&
+                   writeSection(records, (uint64_t)count * sizeof(IRRecord), compiler->irOut) &&
+                   writeSection(labels, (uint64_t)header.labelCount * sizeof(int32_t), compiler->irOut);
+    if (!written)
+        fprintf(compiler->err, "cannot write binary IR: %s\n", strerror(errno));
+    free(stringIndex);
+    free(stringIds);
+    free(records);
+    free(functions);
+    free(strings);
+    free(stringData);
+    free(labels);
+    return written;
+}
+
+/**
+ * @brief 一段是否整个落在文件里面，并且和写的时候一样按8字节对齐
+ *
+ * @param header 文件头
+ * @param offset 段的位置
+ * @param count 项数
+ * @param size 每项的字节数
+ * @return true
+ * @return false
+ */
+static bool checkSection(const IRFileHeader *header, uint64_t offset, uint64_t count, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= header->fileSize && count * size <= header->fileSize - offset;
+}
+
+/**
+ * @brief 检查映射进来的文件，通过以后填好file中指向各段的指针。
+ * 各段的位置和长度、字符串、函数表、标号表和每条指令的运算分量都要检查，之后使用时不用再检查下标
+ *
+ * @param file mapped和length已经填好
+ * @param error 不通过时原因写到这里
+ * @param errorSize error的长度
+ * @return true 通过
+ * @return false 不通过
+ */
+static bool checkIRFile(pIRFile file, char *error, size_t errorSize)
+{
+    const char *base = file->mapped;
+    const IRFileHeader *header = file->mapped;
+    if (memcmp(header->magic, IR_FILE_MAGIC, 4))
+    {
+        snprintf(error, errorSize, "not a binary IR file");
+        return false;
+    }
+    if (header->version != IR_FILE_VERSION)
+    {
+        snprintf(error, errorSize, "unsupported version %u, expected %u", header->version, IR_FILE_VERSION);
+        return false;
+    }
+    if (header->fileSize != file->length)
+    {
+        snprintf(error, errorSize, "header says %u bytes but the file has %zu", header->fileSize, file->length);
+        return false;
+    }
+    if (!checkSection(header, header->stringsOffset, header->stringCount, sizeof(IRString)) ||
+        !checkSection(header, header->stringDataOffset, header->stringDataSize, 1) ||
+        !checkSection(header, header->functionsOffset, header->functionCount, sizeof(IRFunction)) ||
+        !checkSection(header, header->codesOffset, header->codeCount, sizeof(IRRecord)) ||
+        !checkSection(header, header->labelsOffset, header->labelCount, sizeof(int32_t)))
+    {
+        snprintf(error, errorSize, "section misaligned or out of bounds");
+        return false;
+    }
+    file->header = header;
+    file->strings = (const IRString *)(base + header->stringsOffset);
+    file->stringData = base + header->stringDataOffset;
+    file->functions = (const IRFunction *)(base + header->functionsOffset);
+    file->codes = (const IRRecord *)(base + header->codesOffset);
+    file->labels = (const int32_t *)(base + header->labelsOffset);
+
+    for (uint32_t i = 0; i < header->stringCount; i++)
+    {
+        const IRString *string = &file->strings[i];
+        if (string->offset >= header->stringDataSize || string->length >= header->stringDataSize - string->offset ||
+            file->stringData[string->offset + string->length] != '\0')
+        {
+            snprintf(error, errorSize, "string %u out of bounds", i);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->codeCount; i++)
+    {
+        const IRRecord *record = &file->codes[i];
+        if (record->kind >= IR_KIND_COUNT)
+        {
+            snprintf(error, errorSize, "instruction %u: unknown kind %u", i, record->kind);
+            return false;
+        }
+        for (int j = 0; j < operandCounts[record->kind]; j++)
+        {
+            uint32_t value = record->ops[j];
+            bool valid;
+            switch (record->opKinds[j])
+            {
+            case OPERAND_CONSTANT:
+                valid = true;
+                break;
+            case OPERAND_VARIABLE:
+            case OPERAND_FUNCTION:
+            case OPERAND_ADDRESS:
+            case OPERAND_RELOP:
+                valid = value < header->stringCount;
+                break;
+            case OPERAND_TEMP:
+                valid = value < header->tempCount;
+                break;
+            case OPERAND_LABEL:
+                valid = value < header->labelCount;
+                break;
+            default:
+                valid = false;
+                break;
+            }
+            if (!valid)
+            {
+                snprintf(error, errorSize, "instruction %u: operand %d out of range", i, j + 1);
+                return false;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < header->functionCount; i++)
+    {
+        const IRFunction *function = &file->functions[i];
+        if (function->name >= header->stringCount || function->first >= header->codeCount ||
+            function->count == 0 || function->count > header->codeCount - function->first ||
+            file->codes[function->first].kind != IR_FUNCTION)
+        {
+            snprintf(error, errorSize, "function %u out of range", i);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->labelCount; i++)
+    {
+        int32_t index = file->labels[i];
+        if (index != -1 && (index < 0 || (uint32_t)index >= header->codeCount ||
+                            file->codes[index].kind != IR_LABEL || file->codes[index].ops[0] != (int32_t)i))
+        {
+            snprintf(error, errorSize, "label %u points to instruction %d", i, index);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 把二进制中间代码文件只读地映射到内存中，检查一遍就可以直接用，不用解析也不用复制
+ *
+ * @param fileName 文件名
+ * @param error 打不开或者格式不对时原因写到这里
+ * @param errorSize error的长度
+ * @return pIRFile 失败时为NULL
+ */
+pIRFile openIRFile(const char *fileName, char *error, size_t errorSize)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        snprintf(error, errorSize, "%s", strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        snprintf(error, errorSize, "%s", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(IRFileHeader))
+    {
+        snprintf(error, errorSize, "too short for a binary IR file");
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //映射建立以后文件描述符就不需要了
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        snprintf(error, errorSize, "%s", strerror(errno));
+        return NULL;
+    }
+    pIRFile file = calloc(1, sizeof(IRFile));
+    if (!file)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, sizeof(IRFile));
+        exit(EXIT_FAILURE);
+    }
+    file->mapped = base;
+    file->length = st.st_size;
+    if (!checkIRFile(file, error, errorSize))
+    {
+        closeIRFile(file);
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * @brief 字符串表中的一个名字，直接指向映射的内存，以\0结尾
+ *
+ * @param file
+ * @param index 字符串表的下标
+ * @return const char*
+ */
+const char *getIRString(pIRFile file, uint32_t index)
+{
+    assert(index < file->header->stringCount);
+    return file->stringData + file->strings[index].offset;
+}
+
+/**
+ * @brief 按字符串表的下标取名字，printIRFile用
+ *
+ * @param names IRFile
+ * @param id 字符串表的下标
+ * @param length 名字的长度写到这里
+ * @return const char*
+ */
+static const char *getIRName(const void *names, int id, uint32_t *length)
+{
+    pIRFile file = (pIRFile)names;
+    *length = file->strings[id].length;
+    return file->stringData + file->strings[id].offset;
+}
+
+/**
+ * @brief 把文件中的指令按文本格式输出，和编译时直接输出的文本一样，一次还原IR_DECODE_CHUNK条
+ *
+ * @param file
+ * @param out 输出
+ */
+void printIRFile(pIRFile file, FILE *out)
+{
+    struct InterCode_ *codes = malloc(IR_DECODE_CHUNK * sizeof(struct InterCode_));
+    if (!codes)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, IR_DECODE_CHUNK * sizeof(struct InterCode_));
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t first = 0; first < file->header->codeCount; first += IR_DECODE_CHUNK)
+    {
+        uint32_t n = file->header->codeCount - first < IR_DECODE_CHUNK ? file->header->codeCount - first : IR_DECODE_CHUNK;
+        for (uint32_t i = 0; i < n; i++)
+            decodeIRRecord(&file->codes[first + i], &codes[i]);
+        writeInterCodes(out, codes, n, getIRName, file);
+    }
+    free(codes);
+}
+
+/**
+ * @brief 解除映射，从文件中拿到的指针都随之失效
+ *
+ * @param file
+ */
+void closeIRFile(pIRFile file)
+{
+    if (file == NULL)
+        return;
+    munmap(file->mapped, file->length);
+    free(file);
+}
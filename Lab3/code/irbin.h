@@ -0,0 +1,100 @@
+#ifndef IRBIN_H
+#define IRBIN_H
+
+#include "inter.h"
+
+/*
+    二进制中间代码文件。整个文件按下面的顺序排列，每一段都从8字节对齐的位置开始，
+    所有整数都是本机字节序，偏移都从文件开头算起：
+        文件头      IRFileHeader
+        字符串表    IRString[stringCount]，字符串本身在后面的字符串区中，每个都以\0结尾
+        字符串区    stringDataSize个字节
+        函数表      IRFunction[functionCount]
+        指令        IRRecord[codeCount]，每条都是定长的
+        标号表      int32_t[labelCount]，第i项是标号i所在的指令下标，-1表示没有这个标号
+    读的时候把文件映射到内存中，检查一遍以后直接拿着这些数组用，不用再解析。
+*/
+
+#define IR_FILE_MAGIC "CMIR" //文件开头的4个字节
+#define IR_FILE_VERSION 1    //格式改了就加1，读的时候只认同一个版本
+
+/**
+ * @brief 文件头，记下各段的位置和长度
+ *
+ */
+typedef struct IRFileHeader_
+{
+    char magic[4];           //IR_FILE_MAGIC
+    uint32_t version;        //IR_FILE_VERSION，字节序不同时读出来也对不上
+    uint32_t fileSize;       //整个文件的字节数
+    uint32_t tempCount;      //临时变量的编号都小于它
+    uint32_t stringCount;    //字符串表的项数
+    uint32_t stringsOffset;  //字符串表的位置
+    uint32_t stringDataSize; //字符串区的字节数
+    uint32_t stringDataOffset;
+    uint32_t functionCount;  //函数表的项数
+    uint32_t functionsOffset;
+    uint32_t codeCount;      //指令条数
+    uint32_t codesOffset;
+    uint32_t labelCount;     //标号表的项数，标号的编号都小于它
+    uint32_t labelsOffset;
+    uint32_t reserved[2];    //写成0
+} IRFileHeader;
+
+/**
+ * @brief 字符串表的一项，变量、函数、地址和逻辑运算符的名字
+ *
+ */
+typedef struct IRString_
+{
+    uint32_t offset; //在字符串区中的位置
+    uint32_t length; //不包括\0
+} IRString;
+
+/**
+ * @brief 函数表的一项，一个函数的指令从FUNCTION开始连续存放
+ *
+ */
+typedef struct IRFunction_
+{
+    uint32_t name;  //函数名在字符串表中的下标
+    uint32_t first; //FUNCTION指令的下标
+    uint32_t count; //指令条数，包括FUNCTION
+} IRFunction;
+
+/**
+ * @brief 一条指令，运算分量的顺序和文本格式中出现的顺序一样：
+ * 赋值类是左边、右边，四则运算是结果、两个运算对象，IF是x、relop、y、z，DEC是变量、大小（常量）
+ *
+ */
+typedef struct IRRecord_
+{
+    uint8_t kind;        //InterCode_的kind
+    uint8_t opKinds[4];  //各个运算分量的kind，用不到的写成0
+    uint8_t reserved[3]; //写成0
+    int32_t ops[4];      //常量的值，临时变量和标号的编号，有名字的运算分量是字符串表的下标
+} IRRecord;
+
+/**
+ * @brief 映射到内存中的二进制中间代码文件，各个指针都直接指向映射的内存
+ *
+ */
+typedef struct IRFile_
+{
+    const IRFileHeader *header;
+    const IRString *strings;
+    const char *stringData;
+    const IRFunction *functions;
+    const IRRecord *codes;
+    const int32_t *labels;
+    void *mapped;  //映射的内存
+    size_t length; //映射的长度
+} IRFile, *pIRFile;
+
+bool writeIRFile(pCompiler compiler, pInterCodesWrap interCodesWrap);
+pIRFile openIRFile(const char *fileName, char *error, size_t errorSize);
+const char *getIRString(pIRFile file, uint32_t index);
+void decodeIRRecord(const IRRecord *record, struct InterCode_ *code);
+void printIRFile(pIRFile file, FILE *out);
+void closeIRFile(pIRFile file);
+#endif
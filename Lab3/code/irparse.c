@@ -0,0 +1,570 @@
+#include "compiler.h"
+#include "irparse.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief 解析的状态，直接在文本上扫描，除了驻留名字和放中间代码以外不申请内存
+ *
+ */
+typedef struct IRParser_
+{
+    const char *p;         //下一个字符
+    const char *end;       //文本的末尾，文本不需要以\0结尾
+    const char *lineStart; //当前行的开头，算列号用
+    unsigned line;         //当前行号，从1开始
+    size_t length;         //文本的长度，标号的编号不能比它大
+    int maxTemp, maxLabel; //见过的最大的临时变量和标号编号
+    pInternTable strings;  //名字驻留到这里
+    char *error;
+    size_t errorSize;
+} IRParser;
+
+/**
+ * @brief 一个单词，单词之间用空白分开，长度为0表示这一行已经没有单词了
+ *
+ */
+typedef struct IRToken_
+{
+    const char *start;
+    size_t length;
+} IRToken;
+
+/*单词是不是字符串常量，长度在编译时就知道了*/
+#define IS_WORD(token, literal) ((token).length == sizeof(literal) - 1 && !memcmp((token).start, literal, sizeof(literal) - 1))
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief 取当前行的下一个单词，不会越过行尾
+ *
+ * @param parser
+ * @return IRToken
+ */
+static inline IRToken nextToken(IRParser *parser)
+{
+    const char *p = parser->p;
+    while (p < parser->end && isBlank(*p))
+        p++;
+    IRToken token = {p, 0};
+    while (p < parser->end && !isBlank(*p) && *p != '\n')
+        p++;
+    token.length = p - token.start;
+    parser->p = p;
+    return token;
+}
+
+/**
+ * @brief 记下错误，开头是出错的行号和列号
+ *
+ * @param parser
+ * @param where 出错的位置，在当前行中
+ * @param format 错误信息的格式
+ * @param ...
+ * @return false 总是false，直接return出去
+ */
+static bool parseError(IRParser *parser, const char *where, const char *format, ...)
+{
+    int n = snprintf(parser->error, parser->errorSize, "%u:%u: ", parser->line, (unsigned)(where - parser->lineStart) + 1);
+    if (n >= 0 && (size_t)n < parser->errorSize)
+    {
+        va_list vaList;
+        va_start(vaList, format);
+        vsnprintf(parser->error + n, parser->errorSize - n, format, vaList);
+        va_end(vaList);
+    }
+    return false;
+}
+
+/**
+ * @brief 单词不是想要的东西，错误信息中带上这个单词，太长的只带前32个字符
+ *
+ * @param parser
+ * @param token 读到的单词
+ * @param expected 想要的是什么
+ * @return false
+ */
+static bool expectError(IRParser *parser, IRToken token, const char *expected)
+{
+    if (token.length == 0)
+        return parseError(parser, token.start, "expected %s at end of line", expected);
+    return parseError(parser, token.start, "expected %s but found '%.*s'", expected,
+                      (int)(token.length > 32 ? 32 : token.length), token.start);
+}
+
+/**
+ * @brief 把一串十进制数字转成int，前面可以有一个负号
+ *
+ * @param str 数字
+ * @param length 长度
+ * @param value 结果写到这里
+ * @return true 格式正确并且没有超出int的范围
+ * @return false
+ */
+static bool parseInt(const char *str, size_t length, int *value)
+{
+    bool negative = length && *str == '-';
+    size_t i = negative;
+    if (i == length)
+        return false;
+    int64_t magnitude = 0;
+    for (; i < length; i++)
+    {
+        if (str[i] < '0' || str[i] > '9')
+            return false;
+        magnitude = magnitude * 10 + (str[i] - '0');
+        if (magnitude > (int64_t)INT_MAX + negative)
+            return false;
+    }
+    *value = negative ? (int)-magnitude : (int)magnitude;
+    return true;
+}
+
+/**
+ * @brief 单词是不是合法的名字，字母或下划线开头，后面是字母、数字和下划线
+ *
+ * @param token
+ * @return true
+ * @return false
+ */
+static bool isName(IRToken token)
+{
+    for (size_t i = 0; i < token.length; i++)
+    {
+        char c = token.start[i];
+        if (!(c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (i && c >= '0' && c <= '9')))
+            return false;
+    }
+    return token.length != 0;
+}
+
+/**
+ * @brief 解析一个值：#N是常量，tN是临时变量，其他的名字是变量
+ *
+ * @param parser
+ * @param token 单词
+ * @param allowConstant 能不能是常量，被赋值的地方不能是常量
+ * @param operand 结果写到这里
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool parseValue(IRParser *parser, IRToken token, bool allowConstant, pOperand operand)
+{
+    int value;
+    if (token.length && token.start[0] == '#')
+    {
+        if (!allowConstant)
+            return expectError(parser, token, "a variable or temporary");
+        if (!parseInt(token.start + 1, token.length - 1, &value))
+            return parseError(parser, token.start, "invalid constant '%.*s'",
+                              (int)(token.length > 32 ? 32 : token.length), token.start);
+        *operand = newOperand(OPERAND_CONSTANT, value);
+        return true;
+    }
+    if (token.length > 1 && token.start[0] == 't' && token.start[1] != '-' &&
+        parseInt(token.start + 1, token.length - 1, &value))
+    {
+        if (value > parser->maxTemp)
+            parser->maxTemp = value;
+        *operand = newOperand(OPERAND_TEMP, value);
+        return true;
+    }
+    if (!isName(token))
+        return expectError(parser, token, allowConstant ? "a variable, temporary or constant" : "a variable or temporary");
+    *operand = newOperand(OPERAND_VARIABLE, getInternId(internN(parser->strings, token.start, token.length)));
+    return true;
+}
+
+/**
+ * @brief 解析一个标号labelN
+ *
+ * @param parser
+ * @param token 单词
+ * @param operand 结果写到这里
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool parseLabel(IRParser *parser, IRToken token, pOperand operand)
+{
+    int value;
+    if (token.length <= 5 || memcmp(token.start, "label", 5) || token.start[5] == '-' ||
+        !parseInt(token.start + 5, token.length - 5, &value))
+        return expectError(parser, token, "a label");
+    //标号表按编号直接下标，编号大得离谱的标号会让它占用大量内存
+    if ((size_t)value > parser->length)
+        return parseError(parser, token.start, "label number %d is too large", value);
+    if (value > parser->maxLabel)
+        parser->maxLabel = value;
+    *operand = newOperand(OPERAND_LABEL, value);
+    return true;
+}
+
+/**
+ * @brief 解析一个函数名
+ *
+ * @param parser
+ * @param token 单词
+ * @param operand 结果写到这里
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool parseFunctionName(IRParser *parser, IRToken token, pOperand operand)
+{
+    if (!isName(token))
+        return expectError(parser, token, "a function name");
+    *operand = newOperand(OPERAND_FUNCTION, getInternId(internN(parser->strings, token.start, token.length)));
+    return true;
+}
+
+/**
+ * @brief 下一个单词必须是word
+ *
+ * @param parser
+ * @param word 想要的单词
+ * @param expected 出错时怎么描述它
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool expectWord(IRParser *parser, const char *word, const char *expected)
+{
+    IRToken token = nextToken(parser);
+    if (token.length != strlen(word) || memcmp(token.start, word, token.length))
+        return expectError(parser, token, expected);
+    return true;
+}
+
+/**
+ * @brief 这一行必须已经结束了
+ *
+ * @param parser
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool expectEnd(IRParser *parser)
+{
+    IRToken token = nextToken(parser);
+    if (token.length)
+        return expectError(parser, token, "end of line");
+    return true;
+}
+
+/**
+ * @brief 解析"x := ..."这一类以被赋值的对象开头的中间代码，x已经读过了
+ *
+ * @param parser
+ * @param codes 中间代码加到这里
+ * @param left 被赋值的对象
+ * @param writeAddr x前面有*，是写内存
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool parseAssignment(IRParser *parser, pInterCodesWrap codes, Operand left, bool writeAddr)
+{
+    if (!expectWord(parser, ":=", "':='"))
+        return false;
+    IRToken token = nextToken(parser);
+    Operand right, op2;
+    if (writeAddr)
+    {
+        if (!parseValue(parser, token, true, &right))
+            return false;
+        addInterCode(codes, IR_WRITE_ADDR, 2, left, right);
+        return expectEnd(parser);
+    }
+    if (IS_WORD(token, "CALL"))
+    {
+        if (!parseFunctionName(parser, nextToken(parser), &right))
+            return false;
+        addInterCode(codes, IR_CALL, 2, left, right);
+        return expectEnd(parser);
+    }
+    //取地址和读内存的&和*直接贴在运算对象前面
+    if (token.length > 1 && (token.start[0] == '&' || token.start[0] == '*'))
+    {
+        int kind = token.start[0] == '&' ? IR_GET_ADDR : IR_READ_ADDR;
+        IRToken name = {token.start + 1, token.length - 1};
+        if (!parseValue(parser, name, false, &right))
+            return false;
+        addInterCode(codes, kind, 2, left, right);
+        return expectEnd(parser);
+    }
+    if (!parseValue(parser, token, true, &right))
+        return false;
+    IRToken op = nextToken(parser);
+    if (op.length == 0)
+    {
+        addInterCode(codes, IR_ASSIGN, 2, left, right);
+        return true;
+    }
+    int kind;
+    if (IS_WORD(op, "+"))
+        kind = IR_ADD;
+    else if (IS_WORD(op, "-"))
+        kind = IR_SUB;
+    else if (IS_WORD(op, "*"))
+        kind = IR_MUL;
+    else if (IS_WORD(op, "/"))
+        kind = IR_DIV;
+    else
+        return expectError(parser, op, "'+', '-', '*', '/' or end of line");
+    if (!parseValue(parser, nextToken(parser), true, &op2))
+        return false;
+    addInterCode(codes, kind, 3, left, right, op2);
+    return expectEnd(parser);
+}
+
+/**
+ * @brief 解析一行，空行什么也不加
+ *
+ * @param parser 指向行首，结束时指向行尾的\n或者文本末尾
+ * @param codes 中间代码加到这里
+ * @return true
+ * @return false 已经记下了错误
+ */
+static bool parseLine(IRParser *parser, pInterCodesWrap codes)
+{
+    IRToken first = nextToken(parser);
+    Operand x, y, relop, z;
+    if (first.length == 0)
+        return true;
+    if (IS_WORD(first, "LABEL"))
+    {
+        IRToken token = nextToken(parser);
+        if (!parseLabel(parser, token, &x))
+            return false;
+        if (getLabelIndex(codes, x.u.id) != -1)
+            return parseError(parser, token.start, "label%d is defined twice", x.u.id);
+        if (!expectWord(parser, ":", "':'"))
+            return false;
+        addInterCode(codes, IR_LABEL, 1, x);
+    }
+    else if (IS_WORD(first, "FUNCTION"))
+    {
+        if (!parseFunctionName(parser, nextToken(parser), &x) || !expectWord(parser, ":", "':'"))
+            return false;
+        addInterCode(codes, IR_FUNCTION, 1, x);
+    }
+    else if (IS_WORD(first, "GOTO"))
+    {
+        if (!parseLabel(parser, nextToken(parser), &x))
+            return false;
+        addInterCode(codes, IR_GOTO, 1, x);
+    }
+    else if (IS_WORD(first, "IF"))
+    {
+        if (!parseValue(parser, nextToken(parser), true, &x))
+            return false;
+        IRToken token = nextToken(parser);
+        if (!(IS_WORD(token, "==") || IS_WORD(token, "!=") || IS_WORD(token, "<") ||
+              IS_WORD(token, ">") || IS_WORD(token, "<=") || IS_WORD(token, ">=")))
+            return expectError(parser, token, "a relational operator");
+        relop = newOperand(OPERAND_RELOP, getInternId(internN(parser->strings, token.start, token.length)));
+        if (!parseValue(parser, nextToken(parser), true, &y) || !expectWord(parser, "GOTO", "'GOTO'") ||
+            !parseLabel(parser, nextToken(parser), &z))
+            return false;
+        addInterCode(codes, IR_IF_GOTO, 4, x, relop, y, z);
+    }
+    else if (IS_WORD(first, "RETURN") || IS_WORD(first, "ARG") || IS_WORD(first, "WRITE"))
+    {
+        if (!parseValue(parser, nextToken(parser), true, &x))
+            return false;
+        addInterCode(codes, IS_WORD(first, "RETURN") ? IR_RETURN : IS_WORD(first, "ARG") ? IR_ARG : IR_WRITE, 1, x);
+    }
+    else if (IS_WORD(first, "PARAM") || IS_WORD(first, "READ"))
+    {
+        if (!parseValue(parser, nextToken(parser), false, &x))
+            return false;
+        addInterCode(codes, IS_WORD(first, "PARAM") ? IR_PARAM : IR_READ, 1, x);
+    }
+    else if (IS_WORD(first, "DEC"))
+    {
+        if (!parseValue(parser, nextToken(parser), false, &x))
+            return false;
+        IRToken token = nextToken(parser);
+        int size;
+        if (!parseInt(token.start, token.length, &size) || size <= 0)
+            return expectError(parser, token, "a positive size");
+        addInterCode(codes, IR_DEC, 2, x, size);
+    }
+    else if (first.length > 1 && first.start[0] == '*')
+    {
+        IRToken name = {first.start + 1, first.length - 1};
+        if (!parseValue(parser, name, false, &x))
+            return false;
+        return parseAssignment(parser, codes, x, true);
+    }
+    else
+    {
+        if (!parseValue(parser, first, false, &x))
+            return false;
+        return parseAssignment(parser, codes, x, false);
+    }
+    return expectEnd(parser);
+}
+
+/**
+ * @brief 第index条中间代码在文本中的行号，只在报错时用，跳过空行数一遍
+ *
+ * @param text 文本
+ * @param length 长度
+ * @param index 中间代码的下标
+ * @return unsigned 行号
+ */
+static unsigned findCodeLine(const char *text, size_t length, unsigned index)
+{
+    unsigned line = 1;
+    const char *end = text + length;
+    for (const char *p = text; p < end; line++)
+    {
+        const char *next = memchr(p, '\n', end - p);
+        next = next ? next : end;
+        while (p < next && isBlank(*p))
+            p++;
+        if (p < next && index-- == 0)
+            return line;
+        p = next + 1;
+    }
+    return line;
+}
+
+/**
+ * @brief 解析文本格式的中间代码，逐行扫描，名字驻留到strings中。
+ * 读完以后检查跳转到的标号都有定义，再把临时变量和标号的计数设成最大的编号加1，之后可以接着生成中间代码
+ *
+ * @param strings 驻留池
+ * @param text 文本，不需要以\0结尾
+ * @param length 长度
+ * @param error 出错时错误信息写到这里
+ * @param errorSize error的长度
+ * @return pInterCodesWrap 出错时为NULL
+ */
+pInterCodesWrap parseInterCodes(pInternTable strings, const char *text, size_t length, char *error, size_t errorSize)
+{
+    IRParser parser = {text, text + length, text, 1, length, -1, -1, strings, error, errorSize};
+    pInterCodesWrap codes = newInterCodesWrap();
+    while (parser.p < parser.end)
+    {
+        if (!parseLine(&parser, codes))
+        {
+            freeInterCodesWrap(codes);
+            return NULL;
+        }
+        //parseLine停在行尾的\n上
+        parser.p++;
+        parser.line++;
+        parser.lineStart = parser.p;
+    }
+    for (unsigned i = 0; i < codes->count; i++)
+    {
+        pInterCode code = &codes->codes[i];
+        int label = code->kind == IR_GOTO ? code->u.oneOp.op.u.id : code->kind == IR_IF_GOTO ? code->u.ifGoto.z.u.id : -1;
+        if (label != -1 && getLabelIndex(codes, label) == -1)
+        {
+            snprintf(error, errorSize, "%u:1: label%d is never defined", findCodeLine(text, length, i), label);
+            freeInterCodesWrap(codes);
+            return NULL;
+        }
+    }
+    codes->tempVarNum = parser.maxTemp + 1;
+    codes->labelNum = parser.maxLabel + 1;
+    return codes;
+}
+
+/**
+ * @brief 把不能映射的文件（管道、空文件等）整个读到内存中
+ *
+ * @param fd 文件描述符
+ * @param length 读到的长度写到这里
+ * @return char* 读到的内容，出错时为NULL，errno是原因
+ */
+static char *readWhole(int fd, size_t *length)
+{
+    size_t capacity = 1 << 16, used = 0;
+    char *text = malloc(capacity);
+    for (;;)
+    {
+        if (!text)
+        {
+            fprintf(stderr, "[%s:%d]Out of memory(%zu bytes)\n", __FILE__, __LINE__, capacity);
+            exit(EXIT_FAILURE);
+        }
+        ssize_t n = read(fd, text + used, capacity - used);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(text);
+            return NULL;
+        }
+        if (n == 0)
+            break;
+        used += n;
+        if (used == capacity)
+        {
+            capacity *= 2;
+            text = realloc(text, capacity);
+        }
+    }
+    *length = used;
+    return text;
+}
+
+/**
+ * @brief 读一个文本格式的中间代码文件，普通文件映射到内存中直接解析，不经过stdio的缓冲区，管道之类的先整个读进来
+ *
+ * @param strings 驻留池
+ * @param fileName 文件名
+ * @param error 打不开或者格式不对时原因写到这里，开头是"文件名:"，格式不对时后面是行号和列号
+ * @param errorSize error的长度
+ * @return pInterCodesWrap 失败时为NULL
+ */
+pInterCodesWrap loadInterCodes(pInternTable strings, const char *fileName, char *error, size_t errorSize)
+{
+    int fd = open(fileName, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        snprintf(error, errorSize, "%s: %s", fileName, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    bool mapped = S_ISREG(st.st_mode) && st.st_size > 0;
+    size_t length = 0;
+    char *text = NULL;
+    if (mapped)
+    {
+        length = st.st_size;
+        text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED)
+            text = NULL;
+        else
+            madvise(text, length, MADV_SEQUENTIAL);
+    }
+    //空文件映射不了，/proc中的文件大小是0，都和管道一样读进来
+    else
+        text = readWhole(fd, &length);
+    int savedErrno = errno;
+    close(fd);
+    if (text == NULL)
+    {
+        snprintf(error, errorSize, "%s: %s", fileName, strerror(savedErrno));
+        return NULL;
+    }
+    char message[256];
+    pInterCodesWrap codes = parseInterCodes(strings, text, length, message, sizeof(message));
+    if (codes == NULL)
+        snprintf(error, errorSize, "%s:%s", fileName, message);
+    if (mapped)
+        munmap(text, length);
+    else
+        free(text);
+    return codes;
+}
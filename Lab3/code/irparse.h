@@ -0,0 +1,15 @@
+#ifndef IRPARSE_H
+#define IRPARSE_H
+
+#include "inter.h"
+
+/*
+    把printInterCodes输出的文本格式的中间代码读回来，变成和编译时一样的中间代码序列。
+    每行一条中间代码，单词之间用空格分开，空行跳过。tN是临时变量，labelN是标号，#N是常量，
+    其他的名字都驻留到给定的驻留池中，数组参数的地址在文本中和变量一样，读回来都是变量。
+    出错时错误信息的开头是"行:列: "，行和列都从1开始。
+*/
+
+pInterCodesWrap parseInterCodes(pInternTable strings, const char *text, size_t length, char *error, size_t errorSize);
+pInterCodesWrap loadInterCodes(pInternTable strings, const char *fileName, char *error, size_t errorSize);
+#endif
@@ -0,0 +1,61 @@
+import glob
+import sys
+
+import benchutil
+
+# 中间代码解析测试：用--parse-ir把测试目录中的.ir文件读回来再输出，必须和原来的文件完全一样，
+# 再加上--binary转成二进制，用--dump-binary读出来也要一样；写错的中间代码要报出正确的行号和列号。
+# 最后把一个大程序的中间代码读一遍，打印每秒能解析多少MB
+# 用法：python3 irparsetest.py [大文件的函数个数] [次数]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+binary = '/tmp/irparsetest.irb'
+broken = '/tmp/irparsetest.ir'
+
+files = sorted(glob.glob('../test/*/*.ir'))
+for f in files:
+    text = open(f, 'rb').read()
+    parsed = benchutil.run(['--parse-ir', f])
+    if parsed.returncode != 0 or parsed.stdout != text:
+        print('%s: --parse-ir output differs from the file' % f)
+        sys.exit(1)
+    converted = benchutil.run(['--parse-ir', '--binary', '-o', binary, f])
+    if converted.returncode != 0 or benchutil.run(['--dump-binary', binary]).stdout != text:
+        print('%s: --parse-ir --binary output differs from the file' % f)
+        sys.exit(1)
+
+# 每一项是写错的中间代码和错误信息的开头
+cases = [
+    ('FUNCTION main :\n  x = #1\n', '2:5: expected \':=\''),
+    ('FUNCTION main :\nGOTO label9\n', '2:1: label9 is never defined'),
+    ('LABEL label1 :\n\nLABEL label1 :\n', '3:7: label1 is defined twice'),
+    ('IF x <> #1 GOTO label1\n', '1:6: expected a relational operator'),
+    ('x := #99999999999\n', '1:6: invalid constant'),
+    ('DEC a -4\n', '1:7: expected a positive size'),
+    ('#1 := x\n', '1:1: expected a variable or temporary'),
+    ('x := y % z\n', '1:8: expected \'+\', \'-\', \'*\', \'/\' or end of line'),
+]
+for source, expected in cases:
+    open(broken, 'w').write(source)
+    result = benchutil.run(['--parse-ir', broken])
+    message = result.stderr.decode()
+    if result.returncode != 1 or not message.startswith('%s:%s' % (broken, expected)):
+        print('%r: expected "%s", got "%s"' % (source, expected, message.strip()))
+        sys.exit(1)
+print('%d .ir files OK, same text after parsing them back, %d broken inputs reported at the right place' %
+      (len(files), len(cases)))
+
+source = benchutil.cmmCorpus(funcs)
+ir = '/tmp/benchmark_%d.ir' % funcs
+benchutil.run([source, '-o', ir])
+text = open(ir, 'rb').read()
+if benchutil.run(['--parse-ir', ir]).stdout != text:
+    print('%s: --parse-ir output differs from the file' % ir)
+    sys.exit(1)
+times = []
+for i in range(rounds):
+    result = benchutil.run(['--time', '--parse-ir', '-o', '/dev/null', ir])
+    times.append(benchutil.phases(result.stderr.decode())['parse'])
+elapsed = benchutil.median(times)
+print('%s: %d bytes parsed in %.3f ms (median of %d), %.1f MB/s' %
+      (ir, len(text), elapsed, rounds, len(text) / elapsed / 1000))
@@ -0,0 +1,42 @@
+import glob
+import os
+import sys
+
+import benchutil
+
+# --jobs测试：没有语义错误的程序用--jobs编译，不管几个线程，输出的中间代码都必须和不用--jobs时完全一样；
+# 再用gencmm.py生成的大程序比较不同线程数的耗时，打印相对一个线程的加速比。
+# 加速比受机器上能用的CPU个数限制，一起打印出来
+# 用法：python3 jobsbench.py [函数个数] [次数] [最多几个线程]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+maxJobs = int(sys.argv[3]) if len(sys.argv) > 3 else 8
+source = benchutil.cmmCorpus(funcs)
+
+files = sorted(glob.glob('../test/*/test*')) + sorted(glob.glob('../../Lab2/test/*/test*'))
+files = [f for f in files if not f.endswith('.ir')] + [source]
+checked = 0
+for f in files:
+    expected = benchutil.run([f])
+    if expected.returncode != 0 or b'Error' in expected.stdout:
+        continue
+    checked += 1
+    for jobs in [1, 2, 4]:
+        result = benchutil.run(['--jobs=%d' % jobs, f])
+        if result.returncode != 0 or result.stdout != expected.stdout or result.stderr != expected.stderr:
+            print('%s: --jobs=%d output differs from compiling without --jobs' % (f, jobs))
+            sys.exit(1)
+print('%d files without errors OK, same intermediate code with --jobs=1, 2 and 4' % checked)
+
+cpus = len(os.sched_getaffinity(0)) if hasattr(os, 'sched_getaffinity') else os.cpu_count()
+print('%s: %d functions, %d CPUs available, median of %d runs' % (source, funcs, cpus, rounds))
+baseline = None
+jobs = 1
+while jobs <= maxJobs:
+    times = benchutil.medianPhases(['--jobs=%d' % jobs, '-o', '/dev/null', source], rounds)
+    work = times['semantic'] + times['intercode']
+    if baseline is None:
+        baseline = work
+    print('--jobs=%-2d semantic+intercode %9.3f ms, total %9.3f ms, speedup %.2fx' %
+          (jobs, work, sum(times.values()), baseline / work))
+    jobs *= 2
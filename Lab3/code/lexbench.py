@@ -0,0 +1,37 @@
+import json
+import sys
+
+import benchutil
+
+# 测词法分析的速度：用gencorpus.py生成语料，分别用stdio和--mmap跑./main --lex-only，
+# 每种模式取中位数，每种配置输出一行JSON，可以追加到文件里跟踪性能变化
+# 用法：python3 lexbench.py [MB数] [次数] [结果文件]
+size = float(sys.argv[1]) if len(sys.argv) > 1 else 32
+rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+output = sys.argv[3] if len(sys.argv) > 3 else None
+
+corpora = {
+    'mixed': [],
+    'long-lines': ['--line-length', '20000'],
+    'comments': ['--comment-ratio', '1'],
+    'long-idents': ['--ident-length', '64'],
+}
+
+results = []
+for name, options in corpora.items():
+    source = benchutil.script('/tmp/lexbench_%s_%g.cmm' % (name, size), ['gencorpus.py', '--size', str(size)] + options)
+    for mode in [[], ['--mmap']]:
+        runs = []
+        for i in range(rounds):
+            result = benchutil.run(['--lex-only'] + mode + [source], text=True, stderr=None, check=True)
+            runs.append(json.loads(result.stdout.splitlines()[-1]))
+        median = benchutil.median(runs, key=lambda run: run['seconds'])
+        median['corpus'] = name
+        median['rounds'] = rounds
+        results.append(median)
+        print(json.dumps(median))
+
+if output:
+    with open(output, 'a') as f:
+        for result in results:
+            f.write(json.dumps(result) + '\n')
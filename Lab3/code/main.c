@@ -1,79 +1,396 @@
-#include "node.h"
-#include "syntax.tab.h"
-#include "semantics.h"
-#include "inter.h"
+#include "compiler.h"
+#include "irbin.h"
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
 
-extern pNode root;
-extern pSymbolTable symbolTable;
-extern int yylineno;
-extern int yyparse();
-extern void yyrestart(FILE *);
-extern pFuncDecStack funcDeckStack;
-extern pInterCodesWrap interCodesWrap;
+/**
+ * @brief 命令行选项，每个文件的编译都用同一份
+ *
+ */
+typedef struct Options_
+{
+    bool memStats;
+    bool timing;
+    bool mapped;
+    bool lexOnly;
+    bool streaming;
+    bool symbolStats;
+    bool incremental;
+    bool binaryIR;      //--binary，-o写出二进制中间代码
+    bool dumpBinary;    //--dump-binary，命令行中的文件是二进制中间代码，按文本格式输出
+    bool parseIR;       //--parse-ir，命令行中的文件是文本格式的中间代码，读进来再输出
+    unsigned jobs;      //--jobs，分析函数体的线程数，0表示增量分析时和CPU个数一样、一次性编译时不分开
+    unsigned maxErrors; //--max-errors，最多输出的语义错误个数，0表示不限
+    const char *outputName; //-o，中间代码写到这个文件中，NULL表示写到标准输出
+    SymbolHash symbolHash;
+} Options;
+
+/**
+ * @brief 一个文件的编译任务，多个文件时每个任务在自己的线程中编译，输出先写到内存里
+ *
+ */
+typedef struct Job_
+{
+    const char *fileName;
+    const Options *options;
+    int status;      //compileFile的返回值
+    char *out;       //输出到stdout的内容
+    size_t outSize;
+    char *err;       //输出到stderr的内容
+    size_t errSize;
+} Job;
+
+/**
+ * @brief 编译一个文件，按照选项把统计信息打印到err
+ *
+ * @param fileName c--文件名
+ * @param options 命令行选项
+ * @param out 标准输出的内容写到这里
+ * @param err 标准错误的内容写到这里
+ * @return int compileFile或者compileIRFile的返回值
+ */
+static int runCompiler(const char *fileName, const Options *options, FILE *out, FILE *err)
+{
+    pCompiler compiler = newCompiler(out, err);
+    FILE *irOut = NULL;
+    if (options->outputName)
+    {
+        irOut = fopen(options->outputName, "w");
+        if (!irOut)
+        {
+            perror(options->outputName);
+            freeCompiler(compiler);
+            return 1;
+        }
+        compiler->irOut = irOut;
+    }
+    compiler->mapped = options->mapped;
+    compiler->lexOnly = options->lexOnly;
+    compiler->streaming = options->streaming;
+    compiler->symbolStats = options->symbolStats;
+    compiler->binaryIR = options->binaryIR;
+    compiler->symbolHash = options->symbolHash;
+    compiler->jobs = options->jobs;
+    compiler->errors.maxErrors = options->maxErrors;
+    int status = options->parseIR ? compileIRFile(compiler, fileName) : compileFile(compiler, fileName);
+    if (status == 0 && options->timing)
+    {
+        fprintf(err, "parse: %.3f ms\n", compiler->parseTime);
+        fprintf(err, "semantic: %.3f ms\n", compiler->semanticTime);
+        fprintf(err, "intercode: %.3f ms\n", compiler->interTime);
+        fprintf(err, "print: %.3f ms\n", compiler->printTime);
+    }
+    if (status == 0 && options->memStats)
+    {
+        uint32_t nodes = getNodeCount(&compiler->nodes);
+        fprintf(err, "syntax tree: %u nodes, %zu bytes used (%.1f bytes per node), %zu bytes committed\n",
+                nodes, getNodeArrayUsedBytes(&compiler->nodes),
+                nodes ? (double)getNodeArrayUsedBytes(&compiler->nodes) / nodes : 0.0,
+                getNodeArrayCommittedBytes(&compiler->nodes));
+        fprintf(err, "string pool: %u strings, %zu bytes\n",
+                getInternCount(compiler->strings), getInternUsedBytes(compiler->strings));
+        fprintf(err, "types: %u types, %zu bytes\n",
+                getTypeCount(compiler->types), getTypeTableBytes(compiler->types));
+    }
+    freeCompiler(compiler);
+    if (irOut && fclose(irOut))
+    {
+        perror(options->outputName);
+        status = 1;
+    }
+    return status;
+}
 
-bool lexerror = false;
-bool syntaxerror = false;
 /**
- * @brief 检查是否有函数声明了但是没有定义
+ * @brief 增量分析，把命令行中的文件看作同一个文件先后的版本，在一个会话中依次分析，每一版输出它的语义错误，
+ * 要重新分析的函数体分给--jobs个线程同时分析，
+ * --time时每一版向stderr多打印一行，说明重新分析了几个函数体、是否重新建立了全局作用域，
+ * --mem-stats时每一版打印一行类型表的大小，重复分析很多版时应该保持不变
  *
+ * @param fileNames 各个版本的文件名
+ * @param fileCount 版本数
+ * @param options 命令行选项
+ * @return int 有文件打不开时为1
  */
-void checkFucDeclare()
+static int runIncremental(const char **fileNames, int fileCount, const Options *options)
 {
-    pTableItem temp = funcDeckStack->item;
-    while(temp){
-        if(!checkTableItemConflict(symbolTable,temp)){
-            pError(DCLARE_BUTUNDEF_FUNC,temp->symbolDepth,temp->field->name);
+    int status = 0;
+    pSession session = newSession();
+    session->jobs = options->jobs ? options->jobs : (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < fileCount; i++)
+    {
+        pCompiler compiler = newSessionCompiler(session, stdout, stderr);
+        compiler->mapped = options->mapped;
+        compiler->symbolHash = options->symbolHash;
+        compiler->errors.maxErrors = options->maxErrors;
+        if (analyseRevision(session, compiler, fileNames[i]))
+            status = 1;
+        else if (options->timing)
+        {
+            fprintf(stderr, "revision %d: parse %.3f ms, semantic %.3f ms, print %.3f ms, %u ExtDefs, %u bodies re-analysed on up to %u threads, global scope %s\n",
+                    i, compiler->parseTime, compiler->semanticTime, compiler->printTime, session->count,
+                    session->reanalysed, session->jobs, session->rebuilt ? "rebuilt" : "reused");
         }
-        temp = temp->nextSymbol;
+        if (options->memStats)
+            fprintf(stderr, "revision %d: types: %u types, %zu bytes\n", i, getTypeCount(session->types),
+                    getTypeTableBytes(session->types));
+        freeCompiler(compiler);
+    }
+    if (options->memStats)
+    {
+        fprintf(stderr, "string pool: %u strings, %zu bytes\n",
+                getInternCount(session->strings), getInternUsedBytes(session->strings));
+        fprintf(stderr, "types: %u types, %zu bytes\n",
+                getTypeCount(session->types), getTypeTableBytes(session->types));
     }
+    freeSession(session);
+    return status;
+}
+
+/**
+ * @brief 读二进制中间代码文件，映射进来检查一遍以后直接按文本格式输出，
+ * --time时向stderr打印映射加检查和输出各自的耗时
+ *
+ * @param fileNames 二进制中间代码文件
+ * @param fileCount 文件个数
+ * @param options 命令行选项，-o时输出到文件
+ * @return int 有文件打不开或者格式不对时为1
+ */
+static int dumpBinaryFiles(const char **fileNames, int fileCount, const Options *options)
+{
+    int status = 0;
+    FILE *out = stdout;
+    if (options->outputName && !(out = fopen(options->outputName, "w")))
+    {
+        perror(options->outputName);
+        return 1;
+    }
+    for (int i = 0; i < fileCount; i++)
+    {
+        char error[128];
+        double start = nowMs();
+        pIRFile file = openIRFile(fileNames[i], error, sizeof(error));
+        if (!file)
+        {
+            fprintf(stderr, "%s: %s\n", fileNames[i], error);
+            status = 1;
+            continue;
+        }
+        double loadTime = nowMs() - start;
+        start = nowMs();
+        printIRFile(file, out);
+        if (options->timing)
+            fprintf(stderr, "%s: load %.3f ms, print %.3f ms, %u instructions, %u functions\n", fileNames[i],
+                    loadTime, nowMs() - start, file->header->codeCount, file->header->functionCount);
+        closeIRFile(file);
+    }
+    if (out != stdout && fclose(out))
+    {
+        perror(options->outputName);
+        status = 1;
+    }
+    return status;
+}
+
+/**
+ * @brief 解析--jobs=N这样的选项的值，整个字符串必须是一个unsigned放得下的正整数，
+ * 不接受空串、符号、空白和后面多出来的字符，比如"4x"、"-1"、" 4"
+ *
+ * @param text 等号后面的部分
+ * @param value 解析出来的值
+ * @return true 合法
+ * @return false 不合法
+ */
+static bool parsePositive(const char *text, unsigned *value)
+{
+    if (!isdigit((unsigned char)*text))
+        return false;
+    char *end;
+    errno = 0;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (*end || errno == ERANGE || parsed == 0 || parsed > UINT_MAX)
+        return false;
+    *value = (unsigned)parsed;
+    return true;
+}
+
+/**
+ * @brief 线程入口，编译一个文件，输出写到内存中，等所有线程结束后再按顺序打印
+ *
+ * @param arg Job
+ * @return void*
+ */
+static void *compileJob(void *arg)
+{
+    Job *job = arg;
+    FILE *out = open_memstream(&job->out, &job->outSize);
+    FILE *err = open_memstream(&job->err, &job->errSize);
+    if (!out || !err)
+    {
+        fprintf(stderr, "[%s:%d]Out of memory(memstream)\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    job->status = runCompiler(job->fileName, job->options, out, err);
+    fclose(out);
+    fclose(err);
+    return NULL;
 }
 
 /**
  * @brief 启动程序
  *
  * @param argc
- * @param argv c--文件名
+ * @param argv [--mem-stats] [--time] [--mmap] [--lex-only] [--stream] [--symbol-stats] [--incremental] [--jobs=N] [--max-errors=N] [-o 输出文件] [--binary] [--dump-binary] [--parse-ir] [--hash=intern|fnv1a|pjw] c--文件名...
+ * 给了多个文件时每个文件在自己的线程中同时编译，全部结束后按顺序输出，每个文件先输出stdout的内容再输出stderr的内容，
+ * --mem-stats会在结束时向stderr打印语法树、字符串驻留池和类型表占用的内存，
+ * --time会向stderr打印语法分析、语义分析、中间代码生成和输出各自的耗时，
+ * --mmap把源文件映射到内存中直接扫描，不经过stdio的缓冲区，
+ * --lex-only只跑词法分析，用JSON打印Token数、每秒Token数和每秒MB数，
+ * --stream流式编译，占用的内存只和最大的函数有关，和文件的大小无关，
+ * --symbol-stats在结束时向stderr打印符号表的槽数、探测长度和同名链表长度的直方图，以及每次查找平均看的槽数，
+ * --incremental把所有文件看作同一个文件先后的版本，只做语义分析，全局作用域没有变时只重新分析改过的函数体，见runIncremental，
+ * --jobs是分析函数体用的线程数，输出和线程数无关。--incremental默认和CPU个数一样；
+ * 一次性编译时给了--jobs就先建立全局作用域，再用这么多线程分析和翻译函数体，局部变量和--stream一样只在自己的函数中可见，见compileParallel，
+ * --stream边读边编译，不受影响，
+ * -o把中间代码写到文件中，语义错误和词法错误还是输出到标准输出，只能编译一个文件时使用，
+ * --binary和-o一起用，把中间代码按irbin.h中的二进制格式写到文件中，不能和--stream一起用，
+ * --dump-binary把命令行中的文件当作二进制中间代码，映射进来直接按文本格式输出到标准输出或者-o的文件，
+ * --parse-ir把命令行中的文件当作文本格式的中间代码，不经过前端，读进来以后和编译出来的中间代码一样输出，加上--binary可以转成二进制，
+ * --max-errors最多输出N个语义错误，超过以后提前结束语义分析，不再生成中间代码，同一行同一种错误总是只输出一次，
+ * --hash选择符号表的hash函数，默认是intern，直接用驻留时算好的FNV-1a值
  * @return int
  */
 int main(int argc, char **argv)
 {
-    if (argc <= 1)
+    Options options = {false, false, false, false, false, false, false, false, false, false, 0, 0, NULL, NULL};
+    const char **fileNames = malloc(argc * sizeof(char *));
+    assert(fileNames != NULL);
+    int fileCount = 0;
+    for (int i = 1; i < argc; i++)
     {
-        yyparse();
-        return 0;
+        if (!strcmp(argv[i], "--mem-stats"))
+            options.memStats = true;
+        else if (!strcmp(argv[i], "--time"))
+            options.timing = true;
+        else if (!strcmp(argv[i], "--mmap"))
+            options.mapped = true;
+        else if (!strcmp(argv[i], "--lex-only"))
+            options.lexOnly = true;
+        else if (!strcmp(argv[i], "--stream"))
+            options.streaming = true;
+        else if (!strcmp(argv[i], "--symbol-stats"))
+            options.symbolStats = true;
+        else if (!strcmp(argv[i], "--incremental"))
+            options.incremental = true;
+        else if (!strcmp(argv[i], "--binary"))
+            options.binaryIR = true;
+        else if (!strcmp(argv[i], "--dump-binary"))
+            options.dumpBinary = true;
+        else if (!strcmp(argv[i], "--parse-ir"))
+            options.parseIR = true;
+        else if (!strncmp(argv[i], "--jobs=", 7))
+        {
+            if (!parsePositive(argv[i] + 7, &options.jobs))
+            {
+                fprintf(stderr, "invalid job count '%s', expected a positive integer\n", argv[i] + 7);
+                return 1;
+            }
+        }
+        else if (!strncmp(argv[i], "--max-errors=", 13))
+        {
+            if (!parsePositive(argv[i] + 13, &options.maxErrors))
+            {
+                fprintf(stderr, "invalid error limit '%s', expected a positive integer\n", argv[i] + 13);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "-o"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "missing file name after '-o'\n");
+                return 1;
+            }
+            options.outputName = argv[++i];
+        }
+        else if (!strncmp(argv[i], "--hash=", 7))
+        {
+            options.symbolHash = getSymbolHash(argv[i] + 7);
+            if (options.symbolHash == NULL)
+            {
+                fprintf(stderr, "unknown hash function '%s', expected intern, fnv1a or pjw\n", argv[i] + 7);
+                return 1;
+            }
+        }
+        else
+            fileNames[fileCount++] = argv[i];
     }
-    setbuf(stdout, NULL);
-    FILE *f = fopen(argv[1], "r");
-    if (!f)
+    if (options.dumpBinary)
     {
-        perror(argv[1]);
+        int status = dumpBinaryFiles(fileNames, fileCount, &options);
+        free(fileNames);
+        return status;
+    }
+    if (options.outputName && (fileCount != 1 || options.incremental))
+    {
+        fprintf(stderr, "'-o' needs exactly one input file and cannot be used with --incremental\n");
         return 1;
     }
-    yyrestart(f);
-    yyparse();
-    /*如果既没有词法分析错误也没有语法分析错误就打印先根遍历打印语法树*/
-    if (!lexerror && !syntaxerror)
-    {
-        // printSyntaxTree(root, 0);
-        symbolTable = initSymbolTable();
-        // 不用考虑函数声明了因此直接注释掉
-        // funcDeckStack = malloc(sizeof(struct FuncDeclarationStack_));
-        // assert(funcDeckStack != NULL);
-        // funcDeckStack->stackDepth = 0;
-        // funcDeckStack->item = NULL;
-        
-        startSemanticAnalysis(root);
-        // checkFucDeclare();
-        interCodesWrap = newInterCodesWrap();
-        
-        generateInterCodes(root);
-        
-        printInterCodes(interCodesWrap);
-        
-        freeInterCodesWrap(interCodesWrap);
-        freeSymbolTable(symbolTable);
-    }
-    freeNode(root);
-    return 0;
+    if (options.binaryIR && (!options.outputName || options.streaming))
+    {
+        fprintf(stderr, "'--binary' needs '-o' and cannot be used with --stream\n");
+        return 1;
+    }
+    int status = 0;
+    if (fileCount == 0)
+    {
+        pCompiler compiler = newCompiler(stdout, stderr);
+        compileFile(compiler, NULL);
+        freeCompiler(compiler);
+    }
+    else if (options.incremental)
+    {
+        setbuf(stdout, NULL);
+        status = runIncremental(fileNames, fileCount, &options);
+    }
+    else if (fileCount == 1)
+    {
+        setbuf(stdout, NULL);
+        status = runCompiler(fileNames[0], &options, stdout, stderr);
+    }
+    else
+    {
+        //每个文件一个线程，全部结束以后按照命令行中的顺序输出
+        Job *jobs = calloc(fileCount, sizeof(Job));
+        pthread_t *threads = malloc(fileCount * sizeof(pthread_t));
+        assert(jobs != NULL && threads != NULL);
+        for (int i = 0; i < fileCount; i++)
+        {
+            jobs[i].fileName = fileNames[i];
+            jobs[i].options = &options;
+            if (pthread_create(&threads[i], NULL, compileJob, &jobs[i]))
+            {
+                fprintf(stderr, "pthread_create failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (int i = 0; i < fileCount; i++)
+        {
+            pthread_join(threads[i], NULL);
+            fwrite(jobs[i].out, 1, jobs[i].outSize, stdout);
+            fflush(stdout);
+            fwrite(jobs[i].err, 1, jobs[i].errSize, stderr);
+            free(jobs[i].out);
+            free(jobs[i].err);
+            if (jobs[i].status)
+                status = jobs[i].status;
+        }
+        free(jobs);
+        free(threads);
+    }
+    free(fileNames);
+    return status;
 }
-
@@ -0,0 +1,35 @@
+import sys
+
+import benchutil
+
+# 作用域测试：每个函数里有很多层嵌套的语句块，每一层都重新定义同样的几个局部变量，遮住外层的同名变量，
+# 同名的item在hash表里串成和嵌套层数一样长的链表。--jobs和--stream时每个函数分析完就清掉它的所有作用域，
+# 定义变量时的重复定义检查、查找变量和清除作用域的时间都应该只和符号个数有关，不能随着链表变长而变长。
+# 依次把嵌套层数翻倍，每千层的耗时应该基本不变，如果是平方级的就会跟着翻倍。
+# 嵌套层数受语法分析栈的限制（YYMAXDEPTH），最多三千层左右。
+# 普通的编译要求所有的变量都不重名，所以默认用--jobs=1，它单独记下语义分析的耗时；--stream边读边分析，语义分析算在语法分析里
+# 用法：python3 nestbench.py [函数个数] [次数] [传给main的其他参数]
+funcs = int(sys.argv[1]) if len(sys.argv) > 1 else 50
+rounds = int(sys.argv[2]) if len(sys.argv) > 2 else 3
+options = sys.argv[3:] or ['--jobs=1']
+names = ['v%d' % i for i in range(4)]
+
+
+def generate(f, depth):
+    for fn in range(funcs):
+        f.write('int fn%d(int p)\n{\n' % fn)
+        for d in range(depth):
+            f.write('{ int %s; %s = p + %d;\n' % (', '.join(names), names[d % len(names)], d))
+        f.write('}\n' * depth)
+        f.write('return p;\n}\n')
+    f.write('int main()\n{\nwrite(fn0(read()));\nreturn 0;\n}\n')
+
+
+print('%d functions, %d locals per block with the same names in every block, %d rounds, median, %s' %
+      (funcs, len(names), rounds, ' '.join(options)))
+for depth in [375, 750, 1500, 3000]:
+    source = benchutil.generate('/tmp/nestbench_%d_%d.cmm' % (funcs, depth), lambda f: generate(f, depth))
+    times = benchutil.medianPhases(options + [source], rounds)
+    median = sum(times.values())
+    print('depth %5d: %10.3f ms, %8.3f ms per 1000 blocks, semantic %8.3f ms per 1000 blocks' %
+          (depth, median, median / (funcs * depth / 1000), times['semantic'] / (funcs * depth / 1000)))
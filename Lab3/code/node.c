@@ -1,72 +1,329 @@
-#include "node.h"
+#include "compiler.h"
 #include "util.h"
+#include <sys/mman.h>
+
+/*节点里的枚举只用一个字节保存*/
+_Static_assert(SYMBOL_NUM <= 256 && PRODUCTION_NUM <= 256 && NON_TERMINAL < 256, "node enums must fit in uint8_t");
+
+/**
+ * @brief 预留节点数组的地址空间，先按limit预留，地址空间不够（比如ulimit -v）时减半再试，
+ * 减到NODE_ARRAY_MIN_NODES还不够才失败
+ *
+ * @param array 节点数组，还没有预留过
+ */
+static void reserveNodeArray(pNodeArray array)
+{
+    uint32_t nodes = array->limit ? array->limit : NODE_ARRAY_MAX_NODES;
+    for (;;)
+    {
+        array->nodes = mmap(NULL, (size_t)nodes * sizeof(Node), PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (array->nodes != MAP_FAILED)
+            break;
+        if (nodes <= NODE_ARRAY_MIN_NODES)
+        {
+            array->nodes = NULL;
+            fprintf(stderr, "[%s:%d]Out of memory(%zu bytes)\n", __FILE__, __LINE__, (size_t)nodes * sizeof(Node));
+            exit(EXIT_FAILURE);
+        }
+        nodes = nodes / 2 / NODE_ARRAY_GROW_NODES * NODE_ARRAY_GROW_NODES;
+        if (nodes < NODE_ARRAY_MIN_NODES)
+            nodes = NODE_ARRAY_MIN_NODES;
+    }
+    array->reserved = nodes;
+    array->count = 1; //下标0不用
+}
+
+/**
+ * @brief 从节点数组中分配一个节点，第一次使用时预留地址空间，用完已提交的部分时再提交一段
+ *
+ * @param array 节点数组
+ * @return pNode 分配到的节点，内容没有初始化
+ */
+static inline pNode allocNode(pNodeArray array)
+{
+    if (array->count == array->committed)
+    {
+        if (array->nodes == NULL)
+            reserveNodeArray(array);
+        if (array->committed + NODE_ARRAY_GROW_NODES > array->reserved ||
+            mprotect(array->nodes + array->committed, NODE_ARRAY_GROW_NODES * sizeof(Node), PROT_READ | PROT_WRITE))
+        {
+            fprintf(stderr, "[%s:%d]Out of memory(%u nodes)\n", __FILE__, __LINE__, array->committed + NODE_ARRAY_GROW_NODES);
+            exit(EXIT_FAILURE);
+        }
+        array->committed += NODE_ARRAY_GROW_NODES;
+    }
+    return array->nodes + array->count++;
+}
+
+/**
+ * @brief to相对于from的下标，节点之间的链接用它表示
+ *
+ * @param from 发出链接的节点
+ * @param to 链接到的节点，可以为NULL
+ * @return int32_t NULL返回0
+ */
+static inline int32_t linkTo(pNode from, pNode to)
+{
+    return to ? (int32_t)(to - from) : 0;
+}
+
+/**
+ * @brief 在宽数值表中放一个数
+ *
+ * @param array 节点数组
+ * @return uint32_t 下标
+ */
+static uint32_t newWideNumber(pNodeArray array)
+{
+    if (array->wideNumberCount == array->wideNumberCapacity)
+    {
+        array->wideNumberCapacity = array->wideNumberCapacity ? array->wideNumberCapacity * 2 : 64;
+        array->wideNumbers = realloc(array->wideNumbers, array->wideNumberCapacity * sizeof(*array->wideNumbers));
+        if (!array->wideNumbers)
+        {
+            fprintf(stderr, "[%s:%d]Out of memory(%zu bytes)\n", __FILE__, __LINE__, array->wideNumberCapacity * sizeof(*array->wideNumbers));
+            exit(EXIT_FAILURE);
+        }
+    }
+    return array->wideNumberCount++;
+}
+
+/*文法符号的名字，打印语法树时使用*/
+static const char *symbolNames[SYMBOL_NUM] = {
+    [SYMBOL_INT] = "INT",
+    [SYMBOL_FLOAT] = "FLOAT",
+    [SYMBOL_ID] = "ID",
+    [SYMBOL_TYPE] = "TYPE",
+    [SYMBOL_COMMA] = "COMMA",
+    [SYMBOL_DOT] = "DOT",
+    [SYMBOL_SEMI] = "SEMI",
+    [SYMBOL_RELOP] = "RELOP",
+    [SYMBOL_ASSIGNOP] = "ASSIGNOP",
+    [SYMBOL_PLUS] = "PLUS",
+    [SYMBOL_MINUS] = "MINUS",
+    [SYMBOL_STAR] = "STAR",
+    [SYMBOL_DIV] = "DIV",
+    [SYMBOL_AND] = "AND",
+    [SYMBOL_OR] = "OR",
+    [SYMBOL_NOT] = "NOT",
+    [SYMBOL_LP] = "LP",
+    [SYMBOL_RP] = "RP",
+    [SYMBOL_LB] = "LB",
+    [SYMBOL_RB] = "RB",
+    [SYMBOL_LC] = "LC",
+    [SYMBOL_RC] = "RC",
+    [SYMBOL_IF] = "IF",
+    [SYMBOL_ELSE] = "ELSE",
+    [SYMBOL_WHILE] = "WHILE",
+    [SYMBOL_STRUCT] = "STRUCT",
+    [SYMBOL_RETURN] = "RETURN",
+    [SYMBOL_Program] = "Program",
+    [SYMBOL_ExtDefList] = "ExtDefList",
+    [SYMBOL_ExtDef] = "ExtDef",
+    [SYMBOL_ExtDecList] = "ExtDecList",
+    [SYMBOL_Specifier] = "Specifier",
+    [SYMBOL_StructSpecifier] = "StructSpecifier",
+    [SYMBOL_OptTag] = "OptTag",
+    [SYMBOL_Tag] = "Tag",
+    [SYMBOL_VarDec] = "VarDec",
+    [SYMBOL_FunDec] = "FunDec",
+    [SYMBOL_VarList] = "VarList",
+    [SYMBOL_ParamDec] = "ParamDec",
+    [SYMBOL_CompSt] = "CompSt",
+    [SYMBOL_StmtList] = "StmtList",
+    [SYMBOL_Stmt] = "Stmt",
+    [SYMBOL_DefList] = "DefList",
+    [SYMBOL_Def] = "Def",
+    [SYMBOL_DecList] = "DecList",
+    [SYMBOL_Dec] = "Dec",
+    [SYMBOL_Exp] = "Exp",
+    [SYMBOL_Args] = "Args",
+};
+
+/*每个产生式左边的非终结符*/
+static const SymbolKind productionHead[PRODUCTION_NUM] = {
+    [PROGRAM] = SYMBOL_Program,
+    [EXTDEFLIST] = SYMBOL_ExtDefList,
+    [EXTDEF_VAR] = SYMBOL_ExtDef,
+    [EXTDEF_STRUCT] = SYMBOL_ExtDef,
+    [EXTDEF_FUNC] = SYMBOL_ExtDef,
+    [EXTDEF_FUNC_DEC] = SYMBOL_ExtDef,
+    [EXTDECLIST_ONE] = SYMBOL_ExtDecList,
+    [EXTDECLIST_MORE] = SYMBOL_ExtDecList,
+    [SPECIFIER_TYPE] = SYMBOL_Specifier,
+    [SPECIFIER_STRUCT] = SYMBOL_Specifier,
+    [STRUCTSPECIFIER_DEF] = SYMBOL_StructSpecifier,
+    [STRUCTSPECIFIER_TAG] = SYMBOL_StructSpecifier,
+    [OPTTAG] = SYMBOL_OptTag,
+    [TAG] = SYMBOL_Tag,
+    [VARDEC_ID] = SYMBOL_VarDec,
+    [VARDEC_ARRAY] = SYMBOL_VarDec,
+    [FUNDEC_ARGS] = SYMBOL_FunDec,
+    [FUNDEC_NOARGS] = SYMBOL_FunDec,
+    [VARLIST_MORE] = SYMBOL_VarList,
+    [VARLIST_ONE] = SYMBOL_VarList,
+    [PARAMDEC] = SYMBOL_ParamDec,
+    [COMPST] = SYMBOL_CompSt,
+    [STMTLIST] = SYMBOL_StmtList,
+    [STMT_EXP] = SYMBOL_Stmt,
+    [STMT_COMPST] = SYMBOL_Stmt,
+    [STMT_RETURN] = SYMBOL_Stmt,
+    [STMT_IF] = SYMBOL_Stmt,
+    [STMT_IF_ELSE] = SYMBOL_Stmt,
+    [STMT_WHILE] = SYMBOL_Stmt,
+    [DEFLIST] = SYMBOL_DefList,
+    [DEF] = SYMBOL_Def,
+    [DECLIST_ONE] = SYMBOL_DecList,
+    [DECLIST_MORE] = SYMBOL_DecList,
+    [DEC_VAR] = SYMBOL_Dec,
+    [DEC_ASSIGN] = SYMBOL_Dec,
+    [EXP_ASSIGNOP] = SYMBOL_Exp,
+    [EXP_AND] = SYMBOL_Exp,
+    [EXP_OR] = SYMBOL_Exp,
+    [EXP_RELOP] = SYMBOL_Exp,
+    [EXP_PLUS] = SYMBOL_Exp,
+    [EXP_MINUS] = SYMBOL_Exp,
+    [EXP_STAR] = SYMBOL_Exp,
+    [EXP_DIV] = SYMBOL_Exp,
+    [EXP_PAREN] = SYMBOL_Exp,
+    [EXP_NEG] = SYMBOL_Exp,
+    [EXP_NOT] = SYMBOL_Exp,
+    [EXP_CALL_ARGS] = SYMBOL_Exp,
+    [EXP_CALL] = SYMBOL_Exp,
+    [EXP_ARRAY] = SYMBOL_Exp,
+    [EXP_DOT] = SYMBOL_Exp,
+    [EXP_ID] = SYMBOL_Exp,
+    [EXP_INT] = SYMBOL_Exp,
+    [EXP_FLOAT] = SYMBOL_Exp,
+    [ARGS_MORE] = SYMBOL_Args,
+    [ARGS_ONE] = SYMBOL_Args,
+};
+
+/**
+ * @brief 文法符号的名字
+ *
+ * @param kind 文法符号
+ * @return const char* 和syntax.y中写法一样的名字
+ */
+const char *getSymbolName(SymbolKind kind)
+{
+    assert(kind >= 0 && kind < SYMBOL_NUM);
+    return symbolNames[kind];
+}
+
+/**
+ * @brief Token的值，也就是它在源程序中的原文
+ *
+ * @param compiler 节点所在的编译
+ * @param node 语法节点
+ * @return const char* 驻留池中的字符串，非终结符返回空串
+ */
+const char *getNodeValue(pCompiler compiler, pNode node)
+{
+    assert(node != NULL);
+    return node->value ? getInternString(compiler->strings, node->value) : "";
+}
+
+/**
+ * @brief 取INT节点的值，超出int范围的按C的规则截断
+ *
+ * @param compiler 节点所在的编译
+ * @param node INT或FLOAT节点
+ * @return int32_t
+ */
+int32_t getNodeInt(pCompiler compiler, pNode node)
+{
+    assert(node != NULL);
+    switch (node->numberKind)
+    {
+    case NUMBER_INT32:
+        return (int32_t)node->number;
+    case NUMBER_INT64:
+        return (int32_t)compiler->nodes.wideNumbers[node->number].i64;
+    case NUMBER_DOUBLE:
+        return (int32_t)compiler->nodes.wideNumbers[node->number].f64;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief 取FLOAT节点的值
+ *
+ * @param compiler 节点所在的编译
+ * @param node INT或FLOAT节点
+ * @return double
+ */
+double getNodeFloat(pCompiler compiler, pNode node)
+{
+    assert(node != NULL);
+    switch (node->numberKind)
+    {
+    case NUMBER_INT32:
+        return (int32_t)node->number;
+    case NUMBER_INT64:
+        return (double)compiler->nodes.wideNumbers[node->number].i64;
+    case NUMBER_DOUBLE:
+        return compiler->nodes.wideNumbers[node->number].f64;
+    default:
+        return 0;
+    }
+}
+
 /**
  * @brief 建立词法分析时的Token项的值
  *
+ * @param compiler 当前的编译
  * @param lineno 行号
  * @param type 值类型
- * @param name 词法属性
- * @param value 值
+ * @param kind 词法属性
+ * @param text Token的原文，不需要以\0结尾
+ * @param length 原文的长度
  * @return pNode 建立好的Token项的值
  */
-inline pNode newTokenNode(uint32_t lineno, nodeType type,
-                          const char *name, const char *value)
+inline pNode newTokenNode(pCompiler compiler, uint32_t lineno, nodeType type,
+                          SymbolKind kind, const char *text, uint32_t length)
 {
-
-    pNode tokenNode = malloc(sizeof(Node));
-    assert(tokenNode != NULL);
+    pNodeArray array = &compiler->nodes;
+    pNode tokenNode = allocNode(array);
 
     tokenNode->lineno = lineno;
     tokenNode->type = type;
+    tokenNode->kind = kind;
+    tokenNode->production = NO_PRODUCTION;
 
-    size_t nameLength = 0;
-    size_t valueLength = 0;
-
-    /*因为strlen返回不带字符串的\0，所以加一*/
-    if (name != NULL)
+    //原文驻留一份，节点里只记编号
+    const char *value = internN(compiler->strings, text, length);
+    tokenNode->value = getInternId(value);
+    tokenNode->numberKind = NUMBER_NONE;
+    tokenNode->number = 0;
+    if (type == INT_TYPE)
     {
-        nameLength = strlen(name) + 1;
-        tokenNode->name = malloc(nameLength * sizeof(char));
-        strncpy(tokenNode->name, name, nameLength);
-    }
-
-    if (value != NULL && type == INT_TYPE)
-    {
-        valueLength = strlen(value);
-        /*整数类型的重新判断以下*/
-        if ((!strncmp(value, "0X", 2) || !strncmp(value, "0x", 2)) && valueLength >= 3)
+        int64_t number = parseIntLiteral(text, length);
+        if (number >= INT32_MIN && number <= INT32_MAX)
         {
-            valueLength = 2 * valueLength + 1; //十六进制数转化成十进制数后会变长，这里就直接乘两倍了。
-            tokenNode->value = malloc(valueLength);
-            sprintf(tokenNode->value, "%d", convertHexToDec(value)); //将整数转字符串
-        }
-        else if (!strncmp(value, "0", 1))
-        {
-            valueLength += 1;
-            tokenNode->value = malloc(valueLength);
-            sprintf(tokenNode->value, "%d", convertOctToDec(value));
+            tokenNode->numberKind = NUMBER_INT32;
+            tokenNode->number = (uint32_t)(int32_t)number;
         }
         else
         {
-            valueLength += 1;
-            tokenNode->value = malloc(valueLength);
-            strncpy(tokenNode->value, value, valueLength);
+            tokenNode->numberKind = NUMBER_INT64;
+            tokenNode->number = newWideNumber(array);
+            array->wideNumbers[tokenNode->number].i64 = number;
         }
     }
-    else if (value != NULL)
-    {
-        valueLength = strlen(value) + 1;
-        tokenNode->value = malloc(valueLength * sizeof(char));
-        strncpy(tokenNode->value, value, valueLength);
-    }
-    else
+    else if (type == FLOAT_TYPE)
     {
-        tokenNode->value = NULL;
+        //驻留过的字符串以\0结尾，可以直接交给strtod
+        tokenNode->numberKind = NUMBER_DOUBLE;
+        tokenNode->number = newWideNumber(array);
+        array->wideNumbers[tokenNode->number].f64 = strtod(value, NULL);
     }
 
-    //此处并不使用，所以有一点空间浪费
-    tokenNode->child = NULL;
-    tokenNode->brother = NULL;
+    tokenNode->child = 0;
+    tokenNode->brother = 0;
 
     return tokenNode;
 }
@@ -74,32 +331,41 @@ inline pNode newTokenNode(uint32_t lineno, nodeType type,
 /**
  * @brief 创建语法节点
  *
+ * @param compiler 当前的编译
  * @param lineno 行号
- * @param type 值类型
- * @param name 词法属性
+ * @param production 归约用的产生式，节点的文法符号就是产生式的左部
  * @param argc 儿子节点数量
  * @param ... 儿子节点
  * @return pNode 建立好的语法节点
  */
-inline pNode newSyntaxNode(uint32_t lineno, nodeType type,
-                     const char *name, int argc, ...)
+inline pNode newSyntaxNode(pCompiler compiler, uint32_t lineno, Production production, int argc, ...)
 {
-    /*此时是语法节点，不再需要节点的值了*/
-    pNode currentNode = newTokenNode(lineno, type, name, "");
+    assert(production > NO_PRODUCTION && production < PRODUCTION_NUM);
+    /*此时是语法节点，不再需要节点的值了，值统一是空串*/
+    pNode currentNode = allocNode(&compiler->nodes);
+    currentNode->lineno = lineno;
+    currentNode->type = NON_TERMINAL;
+    currentNode->kind = productionHead[production];
+    currentNode->production = production;
+    currentNode->value = 0;
+    currentNode->numberKind = NUMBER_NONE;
+    currentNode->number = 0;
+    currentNode->brother = 0;
 
     va_list vaList;
     va_start(vaList, argc);
 
     pNode tempNode = va_arg(vaList, pNode);
 
-    currentNode->child = tempNode;
+    currentNode->child = linkTo(currentNode, tempNode);
 
     for (int i = 1; i < argc; i++)
     {
-        tempNode->brother = va_arg(vaList, pNode);
-        if (tempNode->brother != NULL)
+        pNode nextNode = va_arg(vaList, pNode);
+        tempNode->brother = linkTo(tempNode, nextNode);
+        if (nextNode != NULL)
         {
-            tempNode = tempNode->brother;
+            tempNode = nextNode;
         }
     }
 
@@ -108,89 +374,221 @@ inline pNode newSyntaxNode(uint32_t lineno, nodeType type,
 }
 
 /**
- * @brief 释放语法树的节点避免内存泄漏
+ * @brief 左递归的 X -> X item 每次归约时调用，把item接到列表末尾。
+ * 新节点是 X -> item 的形状，它的兄弟位置留给下一个X，所以整条链和右递归 X -> item X 建出来的一样
  *
- * @param currentNode 语法树的一个节点
+ * @param compiler 当前的编译
+ * @param list 已经建好的列表，空列表的head和tail都是NULL
+ * @param lineno item的行号
+ * @param production 列表节点的产生式，比如STMTLIST
+ * @param item 新的元素
+ * @return NodeList 接上以后的列表
  */
-inline void freeNode(pNode currentNode)
+NodeList appendNodeList(pCompiler compiler, NodeList list, uint32_t lineno, Production production, pNode item)
 {
-    if (currentNode == NULL)
+    pNode node = newSyntaxNode(compiler, lineno, production, 2, item, NULL);
+    if (list.tail)
     {
-        return;
+        pNode last = getChild(list.tail);
+        last->brother = linkTo(last, node);
     }
     else
+        list.head = node;
+    list.tail = node;
+    return list;
+}
+
+/**
+ * @brief 按源文件的大小定下要预留多少个节点，小文件不用预留整个NODE_ARRAY_MAX_NODES，
+ * 同时编译很多文件或者地址空间受限时也够用。已经预留过时不起作用
+ *
+ * @param array 节点数组
+ * @param bytes 源文件的字节数
+ */
+void setNodeArraySourceSize(pNodeArray array, size_t bytes)
+{
+    if (array->nodes)
+        return;
+    uint64_t nodes = (uint64_t)bytes * NODE_ARRAY_NODES_PER_BYTE + NODE_ARRAY_MIN_NODES;
+    if (nodes > NODE_ARRAY_MAX_NODES)
+        nodes = NODE_ARRAY_MAX_NODES;
+    array->limit = (uint32_t)((nodes + NODE_ARRAY_GROW_NODES - 1) / NODE_ARRAY_GROW_NODES * NODE_ARRAY_GROW_NODES);
+}
+
+/**
+ * @brief 流式编译时处理完一个ExtDef就重置节点数组，之前的节点都不能再用。
+ * 已经提交的内存留着给下一个ExtDef用，所以占用的内存只和最大的ExtDef有关。
+ * bison可能已经读入了下一个Token，它的节点也在节点数组中，所以可以指定一个节点复制到重置后的数组中
+ *
+ * @param array 节点数组
+ * @param keep 需要保留的Token节点，没有儿子，可以为NULL
+ * @return pNode keep在重置后的拷贝
+ */
+pNode resetNodeArray(pNodeArray array, pNode keep)
+{
+    if (array->nodes == NULL)
+        return keep;
+    Node saved;
+    int64_t savedNumber = 0;
+    if (keep)
     {
-        while (currentNode->child != NULL)
-        {
-            pNode temp = currentNode->child;
-            currentNode->child = currentNode->child->brother;
-            freeNode(temp);
-        }
-        free(currentNode->name);
-        free(currentNode->value);
-        free(currentNode);
-        currentNode->name == NULL;
-        currentNode->value == NULL;
-        currentNode == NULL;
+        assert(keep->child == 0);
+        saved = *keep;
+        if (keep->numberKind == NUMBER_INT64 || keep->numberKind == NUMBER_DOUBLE)
+            savedNumber = array->wideNumbers[keep->number].i64; //按位保存，double也一样
     }
+    array->count = 1;
+    array->wideNumberCount = 0;
+    if (keep == NULL)
+        return NULL;
+    pNode copy = allocNode(array);
+    *copy = saved;
+    copy->brother = 0;
+    if (copy->numberKind == NUMBER_INT64 || copy->numberKind == NUMBER_DOUBLE)
+    {
+        copy->number = newWideNumber(array);
+        array->wideNumbers[copy->number].i64 = savedNumber;
+    }
+    return copy;
+}
+
+/**
+ * @brief 整体释放语法树，所有的节点都在节点数组中，因此不需要再一个一个的释放
+ *
+ * @param array 节点数组
+ */
+void freeNodeArray(pNodeArray array)
+{
+    if (array->nodes)
+        munmap(array->nodes, (size_t)array->reserved * sizeof(Node));
+    free(array->wideNumbers);
+    memset(array, 0, sizeof(NodeArray));
 }
 
 /**
- * @brief 按照先根遍历打印语法树
+ * @brief 语法树一共有多少个节点
  *
+ * @param array 节点数组
+ * @return uint32_t
+ */
+uint32_t getNodeCount(pNodeArray array)
+{
+    return array->count ? array->count - 1 : 0;
+}
+
+/**
+ * @brief 语法树一共用了多少字节，包括宽数值表
+ *
+ * @param array 节点数组
+ * @return size_t
+ */
+size_t getNodeArrayUsedBytes(pNodeArray array)
+{
+    return getNodeCount(array) * sizeof(Node) + array->wideNumberCount * sizeof(*array->wideNumbers);
+}
+
+/**
+ * @brief 节点数组向系统提交了多少字节
+ *
+ * @param array 节点数组
+ * @return size_t
+ */
+size_t getNodeArrayCommittedBytes(pNodeArray array)
+{
+    return array->committed * sizeof(Node) + array->wideNumberCapacity * sizeof(*array->wideNumbers);
+}
+
+/**
+ * @brief 按照先根遍历打印语法树。
+ * 列表很长时树也很深，所以不递归，用堆上的栈记下还没打印的兄弟
+ *
+ * @param compiler 语法树所在的编译，打印到compiler->out
  * @param currentNode 语法节点
  * @param height 树深度
  */
-inline void printSyntaxTree(pNode currentNode, int height)
+inline void printSyntaxTree(pCompiler compiler, pNode currentNode, int height)
 {
-    if (currentNode != NULL)
+    struct
+    {
+        pNode node;
+        int height;
+    } *stack = NULL;
+    size_t top = 0, capacity = 0;
+    while (currentNode != NULL || top > 0)
     {
-        if (currentNode->type == NON_TERMINAL && currentNode->child != NULL)
+        if (currentNode == NULL)
+        {
+            top--;
+            currentNode = stack[top].node;
+            height = stack[top].height;
+        }
+        if (currentNode->type == NON_TERMINAL && currentNode->child)
         {
             for (int i = 0; i < height; i++)
             {
-                printf("  ");
+                fprintf(compiler->out, "  ");
             }
             /*按要求打印第一个儿子的行号*/
-            fprintf(stdout, "%s (%d)\n", currentNode->name, currentNode->child->lineno);
+            fprintf(compiler->out, "%s (%d)\n", getSymbolName(currentNode->kind), getChild(currentNode)->lineno);
         }
         else if (currentNode->type == ID_TYPE || currentNode->type == TYPE_TYPE)
         {
             for (int i = 0; i < height; i++)
             {
-                printf("  ");
+                fprintf(compiler->out, "  ");
             }
-            fprintf(stdout, "%s: %s\n", currentNode->name, currentNode->value);
+            fprintf(compiler->out, "%s: %s\n", getSymbolName(currentNode->kind), getNodeValue(compiler, currentNode));
         }
         else if (currentNode->type == INT_TYPE)
         {
             for (int i = 0; i < height; i++)
             {
-                printf("  ");
+                fprintf(compiler->out, "  ");
             }
-            fprintf(stdout, "%s: %d\n", currentNode->name, atoi(currentNode->value));
+            fprintf(compiler->out, "%s: %d\n", getSymbolName(currentNode->kind), getNodeInt(compiler, currentNode));
         }
         else if (currentNode->type == FLOAT_TYPE)
         {
             for (int i = 0; i < height; i++)
             {
-                printf("  ");
+                fprintf(compiler->out, "  ");
             }
-            fprintf(stdout, "%s: %f\n", currentNode->name, atof(currentNode->value));
+            fprintf(compiler->out, "%s: %f\n", getSymbolName(currentNode->kind), getNodeFloat(compiler, currentNode));
         }
         else if (currentNode->type == KEYWORD_TYPE || currentNode->type == PUNCTUATION_TYPE || currentNode->type == OPERATOR_TYPE)
         {
             for (int i = 0; i < height; i++)
             {
-                printf("  ");
+                fprintf(compiler->out, "  ");
             }
-            fprintf(stdout, "%s\n", currentNode->name);
+            fprintf(compiler->out, "%s\n", getSymbolName(currentNode->kind));
+        }
+        //先打印儿子，兄弟留到儿子那棵子树打印完以后
+        if (currentNode->brother && currentNode->child)
+        {
+            if (top == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 64;
+                stack = realloc(stack, capacity * sizeof(*stack));
+                if (!stack)
+                {
+                    fprintf(stderr, "[%s:%d]Out of memory(%ld bytes)\n", __FILE__, __LINE__, capacity * sizeof(*stack));
+                    exit(EXIT_FAILURE);
+                }
+            }
+            stack[top].node = getBrother(currentNode);
+            stack[top].height = height;
+            top++;
+        }
+        if (currentNode->child)
+        {
+            currentNode = getChild(currentNode);
+            height++;
+        }
+        else
+        {
+            currentNode = getBrother(currentNode);
         }
-        printSyntaxTree(currentNode->child, height + 1);
-        printSyntaxTree(currentNode->brother, height);
-    }
-    else
-    {
-        return;
     }
+    free(stack);
 }
\ No newline at end of file
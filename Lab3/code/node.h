@@ -8,6 +8,8 @@
 #include <stdlib.h>
 #include <string.h> 
 #include <stdbool.h> //用于bool值
+#include "arena.h"
+#include "intern.h"
 
 /**
  * @brief 定义节点值的类型，可能是整型，浮点型等
@@ -24,24 +26,227 @@ typedef enum {
     NON_TERMINAL//非终结符，也就是语法单元
 }nodeType;
 
+/**
+ * @brief 数值字面量在词法分析时解码好的值属于哪一种
+ *
+ */
+typedef enum {
+    NUMBER_NONE,//不是数值
+    NUMBER_INT32,//能放进int的整数
+    NUMBER_INT64,//超出int范围的整数
+    NUMBER_DOUBLE//浮点数
+}NumberKind;
 
-typedef struct node{
-    uint32_t lineno;//行号
-    nodeType type;//类型
+/**
+ * @brief 文法符号的种类，前面是终结符，后面是非终结符，名字和syntax.y中的一致
+ * 
+ */
+typedef enum {
+    SYMBOL_INT,
+    SYMBOL_FLOAT,
+    SYMBOL_ID,
+    SYMBOL_TYPE,
+    SYMBOL_COMMA,
+    SYMBOL_DOT,
+    SYMBOL_SEMI,
+    SYMBOL_RELOP,
+    SYMBOL_ASSIGNOP,
+    SYMBOL_PLUS,
+    SYMBOL_MINUS,
+    SYMBOL_STAR,
+    SYMBOL_DIV,
+    SYMBOL_AND,
+    SYMBOL_OR,
+    SYMBOL_NOT,
+    SYMBOL_LP,
+    SYMBOL_RP,
+    SYMBOL_LB,
+    SYMBOL_RB,
+    SYMBOL_LC,
+    SYMBOL_RC,
+    SYMBOL_IF,
+    SYMBOL_ELSE,
+    SYMBOL_WHILE,
+    SYMBOL_STRUCT,
+    SYMBOL_RETURN,
+    //下面是非终结符
+    SYMBOL_Program,
+    SYMBOL_ExtDefList,
+    SYMBOL_ExtDef,
+    SYMBOL_ExtDecList,
+    SYMBOL_Specifier,
+    SYMBOL_StructSpecifier,
+    SYMBOL_OptTag,
+    SYMBOL_Tag,
+    SYMBOL_VarDec,
+    SYMBOL_FunDec,
+    SYMBOL_VarList,
+    SYMBOL_ParamDec,
+    SYMBOL_CompSt,
+    SYMBOL_StmtList,
+    SYMBOL_Stmt,
+    SYMBOL_DefList,
+    SYMBOL_Def,
+    SYMBOL_DecList,
+    SYMBOL_Dec,
+    SYMBOL_Exp,
+    SYMBOL_Args,
+    SYMBOL_NUM
+}SymbolKind;
+
+/**
+ * @brief 产生式编号，由syntax.y中的动作打到节点上，语义分析和中间代码生成直接用它switch
+ * 终结符节点的产生式是NO_PRODUCTION
+ * 
+ */
+typedef enum {
+    NO_PRODUCTION,
+    PROGRAM,                //Program -> ExtDefList
+    EXTDEFLIST,             //ExtDefList -> ExtDef ExtDefList
+    EXTDEF_VAR,             //ExtDef -> Specifier ExtDecList SEMI
+    EXTDEF_STRUCT,          //ExtDef -> Specifier SEMI
+    EXTDEF_FUNC,            //ExtDef -> Specifier FunDec CompSt
+    EXTDEF_FUNC_DEC,        //ExtDef -> Specifier FunDec SEMI
+    EXTDECLIST_ONE,         //ExtDecList -> VarDec
+    EXTDECLIST_MORE,        //ExtDecList -> VarDec COMMA ExtDecList
+    SPECIFIER_TYPE,         //Specifier -> TYPE
+    SPECIFIER_STRUCT,       //Specifier -> StructSpecifier
+    STRUCTSPECIFIER_DEF,    //StructSpecifier -> STRUCT OptTag LC DefList RC
+    STRUCTSPECIFIER_TAG,    //StructSpecifier -> STRUCT Tag
+    OPTTAG,                 //OptTag -> ID
+    TAG,                    //Tag -> ID
+    VARDEC_ID,              //VarDec -> ID
+    VARDEC_ARRAY,           //VarDec -> VarDec LB INT RB
+    FUNDEC_ARGS,            //FunDec -> ID LP VarList RP
+    FUNDEC_NOARGS,          //FunDec -> ID LP RP
+    VARLIST_MORE,           //VarList -> ParamDec COMMA VarList
+    VARLIST_ONE,            //VarList -> ParamDec
+    PARAMDEC,               //ParamDec -> Specifier VarDec
+    COMPST,                 //CompSt -> LC DefList StmtList RC
+    STMTLIST,               //StmtList -> Stmt StmtList
+    STMT_EXP,               //Stmt -> Exp SEMI
+    STMT_COMPST,            //Stmt -> CompSt
+    STMT_RETURN,            //Stmt -> RETURN Exp SEMI
+    STMT_IF,                //Stmt -> IF LP Exp RP Stmt
+    STMT_IF_ELSE,           //Stmt -> IF LP Exp RP Stmt ELSE Stmt
+    STMT_WHILE,             //Stmt -> WHILE LP Exp RP Stmt
+    DEFLIST,                //DefList -> Def DefList
+    DEF,                    //Def -> Specifier DecList SEMI
+    DECLIST_ONE,            //DecList -> Dec
+    DECLIST_MORE,           //DecList -> Dec COMMA DecList
+    DEC_VAR,                //Dec -> VarDec
+    DEC_ASSIGN,             //Dec -> VarDec ASSIGNOP Exp
+    EXP_ASSIGNOP,           //Exp -> Exp ASSIGNOP Exp
+    EXP_AND,                //Exp -> Exp AND Exp
+    EXP_OR,                 //Exp -> Exp OR Exp
+    EXP_RELOP,              //Exp -> Exp RELOP Exp
+    EXP_PLUS,               //Exp -> Exp PLUS Exp
+    EXP_MINUS,              //Exp -> Exp MINUS Exp
+    EXP_STAR,               //Exp -> Exp STAR Exp
+    EXP_DIV,                //Exp -> Exp DIV Exp
+    EXP_PAREN,              //Exp -> LP Exp RP
+    EXP_NEG,                //Exp -> MINUS Exp
+    EXP_NOT,                //Exp -> NOT Exp
+    EXP_CALL_ARGS,          //Exp -> ID LP Args RP
+    EXP_CALL,               //Exp -> ID LP RP
+    EXP_ARRAY,              //Exp -> Exp LB Exp RB
+    EXP_DOT,                //Exp -> Exp DOT ID
+    EXP_ID,                 //Exp -> ID
+    EXP_INT,                //Exp -> INT
+    EXP_FLOAT,              //Exp -> FLOAT
+    ARGS_MORE,              //Args -> Exp COMMA Args
+    ARGS_ONE,               //Args -> Exp
+    PRODUCTION_NUM
+}Production;
 
-    char * name;//名字
-    char * value;//值
+/*
+    一次编译的所有节点放在一个连续的数组中，节点之间用32位的相对下标相连，0表示空节点。
+    数组按源文件的大小预留一段地址空间，只在用到时才提交内存，所以扩大时不需要搬家，
+    bison的栈里和别处保存的pNode在整个编译过程中都有效。
+    链接是相对于节点自己的，所以从节点找儿子和兄弟不需要知道数组在哪里。
+*/
+#define NODE_ARRAY_MAX_NODES (1u << 28) //预留的节点个数上限，不知道输入有多大时（比如标准输入）预留这么多
+#define NODE_ARRAY_MIN_NODES (1u << 20) //预留的节点个数下限，地址空间不够时预留的大小减半，减到这里还不够才失败
+#define NODE_ARRAY_GROW_NODES (1u << 16) //每次提交的节点个数，乘以sizeof(Node)要是页大小的整数倍
+#define NODE_ARRAY_NODES_PER_BYTE 8      //源文件每个字节最多产生的节点数，实测最多的是一串{}和a;，每个字节2.5个
 
-    struct node* child;//儿子节点
-    struct node* brother;//兄弟节点
+typedef struct Compiler_ *pCompiler; //一次编译的上下文，见compiler.h
+
+typedef struct node{
+    uint32_t lineno;//行号
+    uint32_t value;//值在驻留池中的编号，非终结符为0，用getNodeValue得到字符串
+    int32_t child;//儿子节点相对于自己的下标，用getChild得到节点
+    int32_t brother;//兄弟节点相对于自己的下标，用getBrother得到节点
+    uint8_t type;//类型，取值是nodeType
+    uint8_t kind;//文法符号，取值是SymbolKind，名字用getSymbolName得到
+    uint8_t production;//非终结符用哪个产生式归约得到，取值是Production
+    uint8_t numberKind;//number中放的是哪一种值，取值是NumberKind
+    uint32_t number;//NUMBER_INT32时就是值本身，NUMBER_INT64和NUMBER_DOUBLE时是宽数值表的下标
 }Node;
 
 typedef Node* pNode;
 
-pNode newTokenNode(uint32_t lineno,nodeType type,
-    const char *name,const char *value);
-pNode newSyntaxNode(uint32_t lineno,nodeType type,
-    const char *name,int argc,...);
-void printSyntaxTree(pNode currentNode,int height);
-void freeNode(pNode currentNode);
+/**
+ * @brief 一次编译的节点数组
+ *
+ */
+typedef struct nodeArray{
+    pNode nodes;//预留的地址空间，下标0不用
+    uint32_t count;//已经用掉的下标个数，包括不用的下标0
+    uint32_t committed;//已经提交了内存、可以读写的节点个数
+    uint32_t reserved;//预留了地址空间的节点个数，第一次分配节点时定下来
+    uint32_t limit;//打算预留的节点个数，0表示NODE_ARRAY_MAX_NODES，见setNodeArraySourceSize
+    union {
+        int64_t i64;
+        double f64;
+    } *wideNumbers;//放不进32位的数值字面量，节点里只记下标
+    uint32_t wideNumberCount;
+    uint32_t wideNumberCapacity;
+}NodeArray;
+
+typedef NodeArray* pNodeArray;
+
+/*左递归的列表产生式用，记住头和尾，接出来的树和右递归时一样*/
+typedef struct nodeList{
+    pNode head;
+    pNode tail;
+}NodeList;
+
+/**
+ * @brief 儿子节点
+ *
+ * @param node 语法节点
+ * @return pNode 没有儿子时为NULL
+ */
+static inline pNode getChild(pNode node)
+{
+    return node->child ? node + node->child : NULL;
+}
+
+/**
+ * @brief 下一个兄弟节点
+ *
+ * @param node 语法节点
+ * @return pNode 没有兄弟时为NULL
+ */
+static inline pNode getBrother(pNode node)
+{
+    return node->brother ? node + node->brother : NULL;
+}
+
+pNode newTokenNode(pCompiler compiler,uint32_t lineno,nodeType type,
+    SymbolKind kind,const char *text,uint32_t length);
+pNode newSyntaxNode(pCompiler compiler,uint32_t lineno,Production production,int argc,...);
+NodeList appendNodeList(pCompiler compiler,NodeList list,uint32_t lineno,Production production,pNode item);
+const char *getSymbolName(SymbolKind kind);
+const char *getNodeValue(pCompiler compiler,pNode node);
+int32_t getNodeInt(pCompiler compiler,pNode node);
+double getNodeFloat(pCompiler compiler,pNode node);
+void printSyntaxTree(pCompiler compiler,pNode currentNode,int height);
+void setNodeArraySourceSize(pNodeArray array, size_t bytes);
+pNode resetNodeArray(pNodeArray array,pNode keep);
+void freeNodeArray(pNodeArray array);
+uint32_t getNodeCount(pNodeArray array);
+size_t getNodeArrayUsedBytes(pNodeArray array);
+size_t getNodeArrayCommittedBytes(pNodeArray array);
 #endif
\ No newline at end of file
@@ -1,131 +1,669 @@
-#include "semantics.h"
+#include "compiler.h"
 #include "util.h"
-
-pSymbolTable symbolTable;
-pFuncDecStack funcDeckStack;
+#include <limits.h>
 
 /**
- * @brief 来自P.J.Weinberger提供的hash函数
+ * @brief 来自P.J.Weinberger提供的hash函数，得到完整的32位hash值，由hash表按自己的大小取模
  *
  * @param name 符号名
  * @return unsigned int hash值
  */
-inline unsigned int hash_pjw(char *name)
+inline unsigned int hash_pjw(const char *name)
 {
     unsigned int val = 0, i;
     for (; *name; ++name)
     {
-        val = (val << 2) + *name;
-        if (i = val & ~SYMBOL_TABLE_SIZE)
+        val = (val << 4) + *name;
+        if (i = val & 0xF0000000)
         {
-            val = (val ^ (i >> 12)) & SYMBOL_TABLE_SIZE;
+            val = (val ^ (i >> 24)) & ~0xF0000000;
         }
     }
     return val;
 }
 
 /**
- * @brief 用于打印错误信息
+ * @brief FNV-1a hash，每个字符都会影响所有的位，t1、t2这样的名字也能分得很开
+ *
+ * @param name 符号名
+ * @return unsigned int hash值
+ */
+unsigned int hash_fnv1a(const char *name)
+{
+    unsigned int val = 2166136261u;
+    for (; *name; ++name)
+    {
+        val ^= (unsigned char)*name;
+        val *= 16777619u;
+    }
+    return val;
+}
+
+/**
+ * @brief 驻留池在驻留时已经算好的FNV-1a hash值，不用再扫一遍字符串。名字必须是intern返回的指针
+ *
+ * @param name 驻留过的符号名
+ * @return unsigned int hash值
+ */
+unsigned int hash_intern(const char *name)
+{
+    return getInternHash(name);
+}
+
+/*可以用--hash=名字选择的hash函数，第一个是默认的*/
+static const struct
+{
+    const char *name;
+    SymbolHash hash;
+} symbolHashes[] = {
+    {"intern", hash_intern},
+    {"fnv1a", hash_fnv1a},
+    {"pjw", hash_pjw},
+};
+
+/**
+ * @brief 按名字找hash函数
+ *
+ * @param hashName intern、fnv1a或者pjw，NULL表示默认的
+ * @return SymbolHash 没有这个名字时返回NULL
+ */
+SymbolHash getSymbolHash(const char *hashName)
+{
+    if (hashName == NULL)
+        return symbolHashes[0].hash;
+    for (size_t i = 0; i < sizeof(symbolHashes) / sizeof(symbolHashes[0]); i++)
+    {
+        if (!strcmp(symbolHashes[i].name, hashName))
+            return symbolHashes[i].hash;
+    }
+    return NULL;
+}
+
+/**
+ * @brief hash函数的名字，打印统计信息时用
+ *
+ * @param hash hash函数
+ * @return const char* 不是内置的hash函数时返回"custom"
+ */
+const char *getSymbolHashName(SymbolHash hash)
+{
+    for (size_t i = 0; i < sizeof(symbolHashes) / sizeof(symbolHashes[0]); i++)
+    {
+        if (symbolHashes[i].hash == hash)
+            return symbolHashes[i].name;
+    }
+    return "custom";
+}
+
+/**
+ * @brief 报告一个语义错误，先记在compiler->diagnostics中，分析完以后用flushDiagnostics一次写出去
  *
  * @param type 错误类型
  * @param lineNumber 行号
  * @param name 错误地方的名字
  */
-inline void pError(ErrorType type, int lineNumber, char *name)
-{
-    char msg[100] = "\0";
-    if (type == UNDEF_VAR)
-        sprintf(msg, "Undefined variable \"%s\".", name);
-    else if (type == UNDEF_FUNC)
-        sprintf(msg, "Undefined function \"%s\".", name);
-    else if (type == REDEF_VAR)
-        sprintf(msg, "Redefined variable \"%s\".", name);
-    else if (type == REDEF_FUNC)
-        sprintf(msg, "Redefined function \"%s\".", name);
-    else if (type == TYPE_MISMATCH_ASSIGN)
-        sprintf(msg, "Type mismatched for assignment.");
-    else if (type == LEFT_VAR_ASSIGN)
-        sprintf(msg, "The left-hand side of an assignment must be a variable.");
-    else if (type == TYPE_MISMATCH_OP)
-        sprintf(msg, "Type mismatched for operands.");
-    else if (type == TYPE_MISMATCH_RETURN)
-        sprintf(msg, "Type mismatched for return.");
-    else if (type == FUNC_AGRC_MISMATCH)
-        sprintf(msg, "Function \"%s\" is not applicable for arguments followed.", name);
-    else if (type == NOT_A_ARRAY)
-        sprintf(msg, "\"%s\" is not an array.", name);
-    else if (type == NOT_A_FUNC)
-        sprintf(msg, "\"%s\" is not a function.", name);
-    else if (type == NOT_A_INT)
-        sprintf(msg, "\"%s\" is not an integer.", name);
-    else if (type == ILLEGAL_USE_DOT)
-        sprintf(msg, "Illegal use of \".\".");
-    else if (type == NONEXISTFIELD)
-        sprintf(msg, "Non-existent field \"%s\".", name);
-    else if (type == REDEF_FEILD)
-    { // two different error report format
-        if (name == NULL)
-            sprintf(msg, "Field cannot be initialized.");
-        else
-            sprintf(msg, "Redefined field \"%s\".", name);
-    }
-    else if (type == DUPLICATED_NAME)
-        sprintf(msg, "Duplicated name \"%s\".", name);
-    else if (type == UNDEF_STRUCT)
-        sprintf(msg, "Undefined structure \"%s\".", name);
-    else if (type == DCLARE_BUTUNDEF_FUNC)
-        sprintf(msg, "Undefined function \"%s\".", name);
-    else if (type == DCLARE_FUNC_INCONSISTENT)
-        sprintf(msg, "Inconsistent declaration of function \"%s\".", name);
-    else
-        printf("Unknown type\n");
-    printf("Error type %d at Line %d: %s\n", type, lineNumber, msg);
+inline void pError(pCompiler compiler, ErrorType type, int lineNumber, const char *name)
+{
+    addDiagnostic(compiler->diagnostics, type, lineNumber, name);
 }
 
+/*每种错误的提示，%s是错误地方的名字，下标是ErrorType*/
+static const char *const diagnosticFormats[] = {
+    [UNDEF_VAR] = "Undefined variable \"%s\".",
+    [UNDEF_FUNC] = "Undefined function \"%s\".",
+    [REDEF_VAR] = "Redefined variable \"%s\".",
+    [REDEF_FUNC] = "Redefined function \"%s\".",
+    [TYPE_MISMATCH_ASSIGN] = "Type mismatched for assignment.",
+    [LEFT_VAR_ASSIGN] = "The left-hand side of an assignment must be a variable.",
+    [TYPE_MISMATCH_OP] = "Type mismatched for operands.",
+    [TYPE_MISMATCH_RETURN] = "Type mismatched for return.",
+    [FUNC_AGRC_MISMATCH] = "Function \"%s\" is not applicable for arguments followed.",
+    [NOT_A_ARRAY] = "\"%s\" is not an array.",
+    [NOT_A_FUNC] = "\"%s\" is not a function.",
+    [NOT_A_INT] = "\"%s\" is not an integer.",
+    [ILLEGAL_USE_DOT] = "Illegal use of \".\".",
+    [NONEXISTFIELD] = "Non-existent field \"%s\".",
+    [REDEF_FEILD] = "Redefined field \"%s\".",
+    [DUPLICATED_NAME] = "Duplicated name \"%s\".",
+    [UNDEF_STRUCT] = "Undefined structure \"%s\".",
+    [DCLARE_BUTUNDEF_FUNC] = "Undefined function \"%s\".",
+    [DCLARE_FUNC_INCONSISTENT] = "Inconsistent declaration of function \"%s\".",
+};
+
 /**
- * @brief 产生一个类型
+ * @brief 把一个错误格式化成一行，和snprintf一样，放不下时返回需要的长度
  *
- * @param kind
- * @param ...
- * @return pType
+ * @param buffer 写到这里
+ * @param size buffer的长度
+ * @param diagnostic 错误
+ * @return size_t 这一行的长度，不包括\0
+ */
+static size_t formatDiagnostic(char *buffer, size_t size, const Diagnostic *diagnostic)
+{
+    int type = diagnostic->type;
+    const char *format = type > 0 && type <= DCLARE_FUNC_INCONSISTENT ? diagnosticFormats[type] : NULL;
+    // two different error report format
+    if (type == REDEF_FEILD && diagnostic->name == NULL)
+        format = "Field cannot be initialized.";
+    size_t length = snprintf(buffer, size, "%sError type %d at Line %d: ", format ? "" : "Unknown type\n",
+                             type, diagnostic->line);
+    length += snprintf(length < size ? buffer + length : NULL, length < size ? size - length : 0,
+                       format ? format : "", diagnostic->name);
+    length += snprintf(length < size ? buffer + length : NULL, length < size ? size - length : 0, "\n");
+    return length;
+}
+
+/**
+ * @brief 把列表中的错误按加入的顺序格式化到一块内存中，一次写到out，然后清空列表。
+ * 去重用的记录不清空，流式编译时每个ExtDef写一次，整个文件中重复的错误都只出现一次
+ *
+ * @param list 错误列表
+ * @param out 输出到这里
+ */
+void flushDiagnostics(pDiagnosticList list, FILE *out)
+{
+    if (list->count == 0)
+        return;
+    size_t size = list->count * 64 + 256, used = 0;
+    char *buffer = malloc(size);
+    assert(buffer != NULL);
+    for (unsigned i = 0; i < list->count; i++)
+    {
+        size_t length = formatDiagnostic(buffer + used, size - used, &list->items[i]);
+        if (used + length >= size)
+        {
+            size = (used + length + 1) * 2;
+            buffer = realloc(buffer, size);
+            assert(buffer != NULL);
+            length = formatDiagnostic(buffer + used, size - used, &list->items[i]);
+        }
+        used += length;
+    }
+    fwrite(buffer, 1, used, out);
+    free(buffer);
+    list->count = 0;
+}
+
+/**
+ * @brief 把一个语义错误加到列表的末尾，不够时扩容到两倍。
+ * 同一行同一种错误往往是前一个错误连带出来的，只留第一个；
+ * 已经有maxErrors个错误时不再加入，记下truncated，语义分析看到它就提前结束
+ *
+ * @param list 错误列表
+ * @param type 错误类型
+ * @param line 行号
+ * @param name 错误地方的名字，必须是驻留过的或者NULL
+ */
+void addDiagnostic(pDiagnosticList list, ErrorType type, int line, const char *name)
+{
+    //(行号, 错误类型)放在开放定址的集合中，0表示空槽，装满一半就扩容
+    uint64_t key = ((uint64_t)(uint32_t)line << 8 | (unsigned)type) + 1;
+    if ((list->kept + 1) * 2 > list->seenCapacity)
+    {
+        uint64_t *old = list->seen;
+        unsigned oldCapacity = list->seenCapacity;
+        list->seenCapacity = oldCapacity ? oldCapacity * 2 : 16;
+        list->seen = calloc(list->seenCapacity, sizeof(uint64_t));
+        assert(list->seen != NULL);
+        for (unsigned i = 0; i < oldCapacity; i++)
+        {
+            if (old[i] == 0)
+                continue;
+            unsigned slot = (unsigned)(old[i] * 0x9E3779B97F4A7C15ULL >> 32) & (list->seenCapacity - 1);
+            while (list->seen[slot])
+                slot = (slot + 1) & (list->seenCapacity - 1);
+            list->seen[slot] = old[i];
+        }
+        free(old);
+    }
+    unsigned slot = (unsigned)(key * 0x9E3779B97F4A7C15ULL >> 32) & (list->seenCapacity - 1);
+    while (list->seen[slot])
+    {
+        if (list->seen[slot] == key)
+            return;
+        slot = (slot + 1) & (list->seenCapacity - 1);
+    }
+    if (list->maxErrors && list->kept >= list->maxErrors)
+    {
+        list->truncated = true;
+        return;
+    }
+    list->seen[slot] = key;
+    list->kept++;
+
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->items = realloc(list->items, list->capacity * sizeof(Diagnostic));
+        assert(list->items != NULL);
+    }
+    list->items[list->count].type = type;
+    list->items[list->count].line = line;
+    list->items[list->count].name = name;
+    list->count++;
+}
+
+/**
+ * @brief 清空错误列表，去重用的记录也清空，maxErrors不变
+ *
+ * @param list 错误列表
+ */
+void clearDiagnosticList(pDiagnosticList list)
+{
+    list->count = 0;
+    list->kept = 0;
+    list->truncated = false;
+    if (list->seen)
+        memset(list->seen, 0, list->seenCapacity * sizeof(uint64_t));
+}
+
+/**
+ * @brief 释放错误列表中的错误，列表本身不释放
+ *
+ * @param list 错误列表
  */
-pType newType(Kind kind, ...)
+void freeDiagnosticList(pDiagnosticList list)
 {
-    pType type = malloc(sizeof(struct Type_));
-    assert(type != NULL);
+    FREE(list->items);
+    FREE(list->seen);
+    list->count = list->capacity = 0;
+    list->kept = list->seenCapacity = 0;
+    list->truncated = false;
+}
+
+/**
+ * @brief 新建一个类型表，int和float两个基本类型一开始就有
+ *
+ * @return pTypeTable
+ */
+pTypeTable newTypeTable()
+{
+    pTypeTable table = malloc(sizeof(struct TypeTable_));
+    assert(table != NULL);
+    table->arena = newArena(0);
+    table->capacity = TYPE_TABLE_INIT_SIZE;
+    table->count = 0;
+    table->buckets = calloc(table->capacity, sizeof(pType));
+    assert(table->buckets != NULL);
+    table->intType.kind = BASIC;
+    table->intType.u.basic = INT_TYPE_;
+    table->floatType.kind = BASIC;
+    table->floatType.u.basic = FLOAT_TYPE_;
+    table->typeCount = 2;
+    pthread_mutex_init(&table->lock, NULL);
+    return table;
+}
+
+/**
+ * @brief 释放类型表，表中所有的类型和类型里的域都一起释放
+ *
+ * @param table 类型表
+ */
+void freeTypeTable(pTypeTable table)
+{
+    if (table == NULL)
+        return;
+    pthread_mutex_destroy(&table->lock);
+    freeArena(table->arena);
+    FREE(table->buckets);
+    FREE(table);
+}
+
+/**
+ * @brief 清空类型表，建过的类型和类型里的域都一起释放，只剩下int和float，arena的第一块和hash表留着接着用。
+ * 调用时不能再有符号或者类型引用表中的类型
+ *
+ * @param table 类型表
+ */
+void resetTypeTable(pTypeTable table)
+{
+    arenaReset(table->arena);
+    memset(table->buckets, 0, table->capacity * sizeof(pType));
+    table->count = 0;
+    table->typeCount = 2;
+}
+
+unsigned getTypeCount(pTypeTable table)
+{
+    return table->typeCount;
+}
+
+size_t getTypeTableBytes(pTypeTable table)
+{
+    return sizeof(struct TypeTable_) + table->capacity * sizeof(pType) + arenaUsedBytes(table->arena);
+}
+
+/**
+ * @brief 数组类型的键是(元素类型, 长度)，结构体变量的类型的键是(结构体名, 定义中的域)，都是两个值
+ *
+ * @param kind ARRAY或者STRUCTURE
+ * @param first 元素类型或者结构体名
+ * @param second 长度或者域
+ * @return unsigned hash值
+ */
+static unsigned hashTypeKey(Kind kind, const void *first, uintptr_t second)
+{
+    uint64_t h = (uint64_t)(uintptr_t)first * 0x9E3779B97F4A7C15ull;
+    h ^= ((uint64_t)second + kind) * 0xC2B2AE3D27D4EB4Full;
+    return (unsigned)(h >> 32) ^ (unsigned)h;
+}
+
+static unsigned hashType(pType type)
+{
+    if (type->kind == ARRAY)
+        return hashTypeKey(ARRAY, type->u.array.elem, (unsigned)type->u.array.size);
+    return hashTypeKey(STRUCTURE, type->u.structure.name, (uintptr_t)type->u.structure.structureField);
+}
+
+static bool sameTypeKey(pType type, Kind kind, const void *first, uintptr_t second)
+{
+    if (type->kind != kind)
+        return false;
+    if (kind == ARRAY)
+        return type->u.array.elem == first && (unsigned)type->u.array.size == second;
+    return type->u.structure.name == first && (uintptr_t)type->u.structure.structureField == second;
+}
+
+/**
+ * @brief 类型占的字节数，int和float都是4个字节，数组和结构体的大小在建立类型时就算好了
+ *
+ * @param type
+ * @return unsigned int
+ */
+unsigned int getSize(pType type)
+{
+    if (type == NULL)
+        return 0;
+    else if (type->kind == BASIC)
+        return 4;
+    else if (type->kind == ARRAY)
+        return type->u.array.bytes;
+    else if (type->kind == STRUCTURE)
+        return type->u.structure.size;
+    return 0;
+}
+
+/**
+ * @brief 算出数组的大小和每一维的步长。元素类型比数组先建立，所以它的步长表可以直接接在后面
+ *
+ * @param table 类型表，步长表放在它的arena中
+ * @param type 刚建立的数组类型
+ */
+static void layoutArray(pTypeTable table, pType type)
+{
+    pType elem = type->u.array.elem;
+    unsigned elemSize = getSize(elem);
+    type->u.array.bytes = type->u.array.size * elemSize;
+    type->u.array.dims = elem && elem->kind == ARRAY ? elem->u.array.dims + 1 : 1;
+    type->u.array.strides = arenaAlloc(table->arena, type->u.array.dims * sizeof(unsigned));
+    type->u.array.strides[0] = elemSize;
+    if (type->u.array.dims > 1)
+        memcpy(type->u.array.strides + 1, elem->u.array.strides, elem->u.array.dims * sizeof(unsigned));
+}
+
+static unsigned hashFieldName(const char *name, unsigned mask)
+{
+    return (unsigned)(((uint64_t)(uintptr_t)name * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/**
+ * @brief 给结构体变量的类型排布内存：按定义的顺序算出每个域的偏移和整个结构体的大小，
+ * 再把域放进一个按名字开放定址的小hash表，访问域时不用再沿着链表找
+ *
+ * @param table 类型表，hash表放在它的arena中
+ * @param type 刚建立的结构体变量的类型，它的域已经不会再改了
+ */
+static void layoutStructure(pTypeTable table, pType type)
+{
+    unsigned offset = 0, fieldCount = 0;
+    for (pFieldList field = type->u.structure.structureField; field; field = field->tail)
+    {
+        field->offset = offset;
+        offset += getSize(field->type);
+        fieldCount++;
+    }
+    type->u.structure.size = offset;
+    unsigned capacity = 1;
+    while (capacity < fieldCount * 2)
+        capacity <<= 1;
+    type->u.structure.fieldMask = capacity - 1;
+    type->u.structure.fieldIndex = arenaAlloc(table->arena, capacity * sizeof(pFieldList));
+    memset(type->u.structure.fieldIndex, 0, capacity * sizeof(pFieldList));
+    for (pFieldList field = type->u.structure.structureField; field; field = field->tail)
+    {
+        unsigned slot = hashFieldName(field->name, capacity - 1);
+        while (type->u.structure.fieldIndex[slot])
+            slot = (slot + 1) & (capacity - 1);
+        type->u.structure.fieldIndex[slot] = field;
+    }
+}
+
+/**
+ * @brief 按名字找结构体变量的类型中的域
+ *
+ * @param type 结构体变量的类型（getStructureType得到的）
+ * @param name 驻留过的域名
+ * @return pFieldList 找不到时为NULL
+ */
+pFieldList getStructField(pType type, const char *name)
+{
+    unsigned mask = type->u.structure.fieldMask;
+    for (unsigned slot = hashFieldName(name, mask); type->u.structure.fieldIndex[slot]; slot = (slot + 1) & mask)
+    {
+        if (type->u.structure.fieldIndex[slot]->name == name)
+            return type->u.structure.fieldIndex[slot];
+    }
+    return NULL;
+}
+
+/**
+ * @brief 找到键对应的类型，没有就新建一个放进表中。类型表装满一半时扩容到两倍
+ *
+ * @param table 类型表
+ * @param kind ARRAY或者STRUCTURE
+ * @param first 元素类型或者结构体名
+ * @param second 长度或者域
+ * @return pType 唯一的类型
+ */
+static pType internType(pTypeTable table, Kind kind, const void *first, uintptr_t second)
+{
+    pthread_mutex_lock(&table->lock);
+    unsigned mask = table->capacity - 1;
+    unsigned slot = hashTypeKey(kind, first, second) & mask;
+    while (table->buckets[slot])
+    {
+        if (sameTypeKey(table->buckets[slot], kind, first, second))
+        {
+            pType type = table->buckets[slot];
+            pthread_mutex_unlock(&table->lock);
+            return type;
+        }
+        slot = (slot + 1) & mask;
+    }
+    pType type = arenaAlloc(table->arena, sizeof(struct Type_));
     type->kind = kind;
-    va_list vaList;
-    switch (kind)
+    if (kind == ARRAY)
     {
-    case BASIC:
-        va_start(vaList, 1);
-        type->u.basic = va_arg(vaList, BasicType);
-        break;
-    case ARRAY:
-        va_start(vaList, 2);
-        type->u.array.elem = va_arg(vaList, pType);
-        type->u.array.size = va_arg(vaList, int);
-        break;
-    case STRUCTURE:
-        va_start(vaList, 2);
-        type->u.structure.name = va_arg(vaList, char *);
-        type->u.structure.structureField = va_arg(vaList, pFieldList);
-        break;
-    case FUNCTION:
-        va_start(vaList, 3);
-        type->u.function.argc = va_arg(vaList, int);
-        type->u.function.argv = va_arg(vaList, pFieldList);
-        type->u.function.returnType = va_arg(vaList, pType);
-        break;
-    default:
-        perror("error kind");
-        exit(1);
-        break;
+        type->u.array.elem = (pType)first;
+        type->u.array.size = (int)second;
+        layoutArray(table, type);
     }
-    va_end(vaList);
+    else
+    {
+        type->u.structure.name = first;
+        type->u.structure.structureField = (pFieldList)second;
+        layoutStructure(table, type);
+    }
+    table->buckets[slot] = type;
+    table->count++;
+    table->typeCount++;
+    if (table->count * 2 > table->capacity)
+    {
+        pType *oldBuckets = table->buckets;
+        unsigned oldCapacity = table->capacity;
+        table->capacity *= 2;
+        table->buckets = calloc(table->capacity, sizeof(pType));
+        assert(table->buckets != NULL);
+        mask = table->capacity - 1;
+        for (unsigned i = 0; i < oldCapacity; i++)
+        {
+            if (oldBuckets[i] == NULL)
+                continue;
+            slot = hashType(oldBuckets[i]) & mask;
+            while (table->buckets[slot])
+                slot = (slot + 1) & mask;
+            table->buckets[slot] = oldBuckets[i];
+        }
+        free(oldBuckets);
+    }
+    pthread_mutex_unlock(&table->lock);
+    return type;
+}
+
+/**
+ * @brief 基本类型
+ *
+ * @param table 类型表
+ * @param basic INT_TYPE_或者FLOAT_TYPE_
+ * @return pType
+ */
+pType getBasicType(pTypeTable table, BasicType basic)
+{
+    return basic == INT_TYPE_ ? &table->intType : &table->floatType;
+}
+
+/**
+ * @brief 数组类型，元素类型和长度都相同的数组类型是同一个对象，第一次建立时算好大小和每一维的步长
+ *
+ * @param table 类型表
+ * @param elem 元素类型，必须来自同一个类型表
+ * @param size 长度
+ * @return pType
+ */
+pType getArrayType(pTypeTable table, pType elem, int size)
+{
+    return internType(table, ARRAY, elem, (unsigned)size);
+}
+
+/**
+ * @brief 结构体变量的类型。同一个结构体定义的变量类型是同一个对象，直接用定义中的域，不复制。
+ * 第一次建立时算好每个域的偏移、结构体的大小和按名字的索引。
+ * 用定义中的域而不只是名字作为键，是因为流式编译时函数里定义的结构体会被清掉，后面可能有同名的另一个定义
+ *
+ * @param table 类型表
+ * @param name 结构体名，驻留过的
+ * @param fields 结构体定义中的域，定义结束以后就不会再改
+ * @return pType
+ */
+pType getStructureType(pTypeTable table, const char *name, pFieldList fields)
+{
+    return internType(table, STRUCTURE, name, (uintptr_t)fields);
+}
+
+/**
+ * @brief 结构体定义本身的类型，名字为NULL，分析DefList时往里面加域，所以每个定义一个，不放进hash表
+ *
+ * @param table 类型表
+ * @return pType
+ */
+pType newStructureDefType(pTypeTable table)
+{
+    pthread_mutex_lock(&table->lock);
+    pType type = arenaAlloc(table->arena, sizeof(struct Type_));
+    type->kind = STRUCTURE;
+    type->u.structure.name = NULL;
+    type->u.structure.structureField = NULL;
+    type->u.structure.fieldIndex = NULL;
+    type->u.structure.fieldMask = 0;
+    type->u.structure.size = 0;
+    table->typeCount++;
+    pthread_mutex_unlock(&table->lock);
+    return type;
+}
+
+/**
+ * @brief 未命名的结构体的名字。名字不放进驻留池，每个未命名的结构体的名字都是不同的指针，
+ * 按名字比较结构体类型时不会和别的结构体相等，也不会和任何符号重名
+ *
+ * @param table 类型表
+ * @param number 编号，只用来打印
+ * @return const char* 可以当作驻留过的名字用
+ */
+const char *newStructName(pTypeTable table, unsigned number)
+{
+    char name[16];
+    sprintf(name, "%u", number);
+    pthread_mutex_lock(&table->lock);
+    const char *unique = newUniqueString(table->arena, name);
+    pthread_mutex_unlock(&table->lock);
+    return unique;
+}
+
+/**
+ * @brief 函数类型。函数类型之间从来不比较（见checkType），所以每个函数一个，不放进hash表
+ *
+ * @param table 类型表
+ * @param argc 参数个数
+ * @param argv 参数，必须是类型表中的域（newTypeField或者copyTypeFieldList得到的）
+ * @param returnType 返回类型
+ * @return pType
+ */
+pType newFunctionType(pTypeTable table, int argc, pFieldList argv, pType returnType)
+{
+    pthread_mutex_lock(&table->lock);
+    pType type = arenaAlloc(table->arena, sizeof(struct Type_));
+    type->kind = FUNCTION;
+    type->u.function.argc = argc;
+    type->u.function.argv = argv;
+    type->u.function.returnType = returnType;
+    table->typeCount++;
+    pthread_mutex_unlock(&table->lock);
     return type;
 }
 
+/**
+ * @brief 新建一个属于类型表的域，用在结构体的域和函数的参数中，和类型表一起释放
+ *
+ * @param table 类型表
+ * @param name 驻留过的名字
+ * @param type 域的类型
+ * @return pFieldList
+ */
+pFieldList newTypeField(pTypeTable table, const char *name, pType type)
+{
+    pthread_mutex_lock(&table->lock);
+    pFieldList fieldList = arenaAlloc(table->arena, sizeof(struct FieldList_));
+    pthread_mutex_unlock(&table->lock);
+    fieldList->name = name;
+    fieldList->type = type;
+    fieldList->isParam = false;
+    fieldList->offset = 0;
+    fieldList->tail = NULL;
+    return fieldList;
+}
+
+/**
+ * @brief 把一串域复制到类型表中，类型本身不用复制
+ *
+ * @param table 类型表
+ * @param srcFeildList 要复制的域，可以为NULL
+ * @return pFieldList
+ */
+pFieldList copyTypeFieldList(pTypeTable table, pFieldList srcFeildList)
+{
+    pFieldList head = NULL, cur = NULL;
+    for (pFieldList temp = srcFeildList; temp; temp = temp->tail)
+    {
+        pFieldList copy = newTypeField(table, temp->name, temp->type);
+        if (head)
+            cur->tail = copy;
+        else
+            head = copy;
+        cur = copy;
+    }
+    return head;
+}
+
 void printType(pType type)
 {
     if (type == NULL)
@@ -165,49 +703,20 @@ void printType(pType type)
 }
 
 /**
- * @brief 用于复制type类型，在结构体内部定义中很有用，避免因为删除某一个Type导致出现其他
- * fieldList中的type不可以使用
+ * @brief 比较两个类型是否相容。类型都来自类型表，同一个对象一定相容，
+ * 只有数组（不比较长度）和出错时的情况才需要往下比较
  *
- * @param srcType
- * @return pType
+ * @param type1
+ * @param type2
+ * @return true
+ * @return false
  */
-pType copyType(pType srcType)
-{
-    if (srcType == NULL)
-        return NULL;
-    pType p = (pType)malloc(sizeof(struct Type_));
-    assert(p != NULL);
-    p->kind = srcType->kind;
-    switch (p->kind)
-    {
-    case BASIC:
-        p->u.basic = srcType->u.basic;
-        break;
-    case ARRAY:
-        p->u.array.elem = copyType(srcType->u.array.elem);
-        p->u.array.size = srcType->u.array.size;
-        break;
-    case STRUCTURE:
-        p->u.structure.name = newString(srcType->u.structure.name);
-        p->u.structure.structureField = copyFieldList(srcType->u.structure.structureField);
-        break;
-    case FUNCTION:
-        p->u.function.argc = srcType->u.function.argc;
-        p->u.function.argv = copyFieldList(srcType->u.function.argv);
-        p->u.function.returnType = copyType(srcType->u.function.returnType);
-        break;
-    default:
-        fprintf(stderr, "error kind in %s", __FUNCTION__);
-        exit(1);
-        break;
-    }
-    return p;
-}
-
 bool checkType(pType type1, pType type2)
 {
     if (type1 == NULL || type2 == NULL)
         return true;
+    if (type1 == type2 && type1->kind != FUNCTION)
+        return true;
     if (type1->kind == FUNCTION || type2->kind == FUNCTION)
     {
         /*  如果比较两个的是函数，应当比较它们的名字，而不以checkType的判断为准，
@@ -226,54 +735,12 @@ bool checkType(pType type1, pType type2)
         case ARRAY:
             return checkType(type1->u.array.elem, type2->u.array.elem);
         case STRUCTURE:
-            return !strcmp(type1->u.structure.name,
-                           type2->u.structure.name);
+            return type1->u.structure.name == type2->u.structure.name;
             //这个对于大多数结构体好像返回的都是true，因为设计不合理。。
         }
     }
 }
 
-void freeType(pType type)
-{
-    assert(type != NULL);
-    switch (type->kind)
-    {
-    case BASIC:
-        break;
-    case ARRAY:
-        freeType(type->u.array.elem); //  递归删除多维数组
-        type->u.array.elem = NULL;
-        break;
-    case STRUCTURE:
-        if (type->u.structure.name)
-            FREE(type->u.structure.name);
-        type->u.structure.name = NULL;
-
-        pFieldList temp = type->u.structure.structureField;
-        while (temp)
-        {
-            pFieldList toBeFree = temp;
-            temp = temp->tail;
-            freeFieldList(toBeFree);
-        }
-        type->u.structure.structureField = NULL;
-        break;
-    case FUNCTION:
-        freeType(type->u.function.returnType);
-        type->u.function.returnType = NULL;
-        temp = type->u.function.argv;
-        while (temp)
-        {
-            pFieldList toBeFree = temp;
-            temp = temp->tail;
-            freeFieldList(toBeFree);
-        }
-        type->u.function.argv = NULL;
-        break;
-    }
-    FREE(type);
-}
-
 /**
  * @brief 新建一个表项
  *
@@ -288,10 +755,121 @@ pTableItem newTableItem(int depth, pFieldList feildList)
     tableItem->symbolDepth = depth;
     tableItem->field = feildList;
     tableItem->nextHash = NULL;
+    tableItem->prevHash = NULL;
+    tableItem->hashSlot = 0;
+    tableItem->hash = 0;
     tableItem->nextSymbol = NULL;
+    tableItem->builtin = NULL;
     return tableItem;
 }
 
+/*删除后留在槽里的墓碑，线性探测遇到它要继续往后找*/
+static struct TableItem_ deletedItem;
+#define DELETED_ITEM (&deletedItem)
+
+/**
+ * @brief hash值对应的理想的槽。hash_pjw对t1、t2这样只差最后一个字符的名字算出的值是挨着的，
+ * 线性探测时会连成很长的一段，所以先乘上黄金分割数打散，再取高位
+ *
+ * @param hashTable hash表
+ * @param hash 名字的hash值
+ * @return unsigned 槽的下标
+ */
+static inline unsigned homeHashSlot(pHashTable hashTable, unsigned hash)
+{
+    return (hash * 2654435769u) >> hashTable->shift;
+}
+
+/**
+ * @brief 找到名字所在的槽，名字不在表中时返回可以放它的槽：探测中遇到的第一个墓碑，没有墓碑就是停下来的空槽
+ *
+ * @param hashTable hash表
+ * @param name 驻留过的名字
+ * @param hash 名字的hash值
+ * @param probes 不为NULL时加上这次看过的槽数
+ * @return unsigned 槽的下标
+ */
+static unsigned findHashSlot(pHashTable hashTable, const char *name, unsigned hash, unsigned long *probes)
+{
+    unsigned mask = hashTable->capacity - 1;
+    unsigned slot = homeHashSlot(hashTable, hash);
+    unsigned firstDeleted = hashTable->capacity;
+    if (probes)
+        (*probes)++;
+    while (hashTable->hashArray[slot])
+    {
+        if (hashTable->hashArray[slot] == DELETED_ITEM)
+        {
+            if (firstDeleted == hashTable->capacity)
+                firstDeleted = slot;
+        }
+        else if (hashTable->hashArray[slot]->field->name == name)
+            return slot;
+        slot = (slot + 1) & mask;
+        if (probes)
+            (*probes)++;
+    }
+    return firstDeleted != hashTable->capacity ? firstDeleted : slot;
+}
+
+/**
+ * @brief 重建hash表并清掉所有墓碑，同名的链表原样搬过去。名字和墓碑占满一半时insertTableItem调用这里，
+ * 如果名字超过四分之一就扩容到两倍，否则大小不变、只清墓碑，重建以后名字最多占四分之一
+ *
+ * @param hashTable hash表
+ */
+static void rebuildHashTable(pHashTable hashTable)
+{
+    pTableItem *oldArray = hashTable->hashArray;
+    unsigned oldCapacity = hashTable->capacity;
+    if ((hashTable->count + 1) * 4 > oldCapacity)
+    {
+        hashTable->capacity = oldCapacity * 2;
+        hashTable->shift--;
+    }
+    hashTable->hashArray = calloc(hashTable->capacity, sizeof(pTableItem));
+    assert(hashTable->hashArray != NULL);
+    hashTable->deleted = 0;
+    for (unsigned i = 0; i < oldCapacity; i++)
+    {
+        if (oldArray[i] && oldArray[i] != DELETED_ITEM)
+        {
+            unsigned slot = findHashSlot(hashTable, oldArray[i]->field->name, oldArray[i]->hash, NULL);
+            hashTable->hashArray[slot] = oldArray[i];
+            oldArray[i]->hashSlot = slot;
+        }
+    }
+    free(oldArray);
+}
+
+/**
+ * @brief 把一个item从hash表中摘下来。
+ * 同名的item是双向链表，它在槽里时记着槽的下标，所以不用重新算hash，也不用沿着链表找它的前一个
+ *
+ * @param hashTable hash表
+ * @param item 要摘下来的item，必须在表中
+ */
+static void unlinkTableItem(pHashTable hashTable, pTableItem item)
+{
+    if (item->prevHash)
+        item->prevHash->nextHash = item->nextHash;
+    else if (item->nextHash)
+    {
+        //被它遮住的item重新露出来
+        hashTable->hashArray[item->hashSlot] = item->nextHash;
+        item->nextHash->hashSlot = item->hashSlot;
+    }
+    else
+    {
+        hashTable->hashArray[item->hashSlot] = DELETED_ITEM;
+        hashTable->count--;
+        hashTable->deleted++;
+    }
+    if (item->nextHash)
+        item->nextHash->prevHash = item->prevHash;
+    item->nextHash = item->prevHash = NULL;
+}
+
 /**
  * @brief 向符号表中加入一个符号项
  *
@@ -300,37 +878,81 @@ pTableItem newTableItem(int depth, pFieldList feildList)
 void insertTableItem(pSymbolTable symbolTable, pTableItem newTableItem)
 {
     assert(newTableItem != NULL);
-    unsigned int hashCode = hash_pjw(newTableItem->field->name);
     pHashTable hashTable = symbolTable->hashTable;
     pStack stack = symbolTable->stack;
 
-    newTableItem->nextHash = GET_HASH_HEAD(hashTable, hashCode);
-    SET_HASH_HEAD(hashTable, hashCode, newTableItem);
+    newTableItem->hash = hashTable->hash(newTableItem->field->name);
+    unsigned slot = findHashSlot(hashTable, newTableItem->field->name, newTableItem->hash, NULL);
+    pTableItem shadowed = hashTable->hashArray[slot];
+    if (shadowed == NULL && (hashTable->count + hashTable->deleted + 1) * 2 > hashTable->capacity)
+    {
+        rebuildHashTable(hashTable);
+        slot = findHashSlot(hashTable, newTableItem->field->name, newTableItem->hash, NULL);
+    }
+    if (shadowed == NULL || shadowed == DELETED_ITEM)
+    {
+        if (shadowed == DELETED_ITEM)
+            hashTable->deleted--;
+        hashTable->count++;
+        shadowed = NULL;
+    }
+    else
+        shadowed->prevHash = newTableItem;
+    newTableItem->nextHash = shadowed;
+    newTableItem->prevHash = NULL;
+    newTableItem->shadowDepth = newTableItem->symbolDepth;
+    newTableItem->shadowStructure = newTableItem->field->type && newTableItem->field->type->kind == STRUCTURE;
+    if (shadowed)
+    {
+        if (shadowed->shadowDepth > newTableItem->shadowDepth)
+            newTableItem->shadowDepth = shadowed->shadowDepth;
+        newTableItem->shadowStructure |= shadowed->shadowStructure;
+    }
+    newTableItem->hashSlot = slot;
+    hashTable->hashArray[slot] = newTableItem;
 
+    newTableItem->order = symbolTable->order;
     newTableItem->nextSymbol = GET_STACK_HEAD(stack);
     SET_STACK_HEAD(stack, newTableItem);
+    if (stack->stackDepth > stack->deepest)
+        stack->deepest = stack->stackDepth;
+}
+
+/**
+ * @brief 在一个hash表中查找名字最近的item，跳过horizon之后的ExtDef加入的item，不修改hash表
+ *
+ * @param hashTable hash表
+ * @param name 驻留过的名字
+ * @param horizon 看得到的最后一个ExtDef的序号
+ * @param probes 看过的槽数加到这里
+ * @return pTableItem
+ */
+static pTableItem findVisibleItem(pHashTable hashTable, const char *name, unsigned horizon, unsigned long *probes)
+{
+    pTableItem item = hashTable->hashArray[findHashSlot(hashTable, name, hashTable->hash(name), probes)];
+    if (item == DELETED_ITEM)
+        return NULL;
+    while (item && item->order > horizon)
+        item = item->nextHash;
+    return item;
 }
 
 /**
- * @brief 按照name在hash表中查找最近的tableItem
+ * @brief 按照name在hash表中查找最近的tableItem，跳过table->horizon之后的ExtDef加入的item。
+ * 函数体私有的局部作用域中找不到时再到全局作用域中找，统计只记在table上，不写全局作用域
  *
  * @param hashTable hash表
- * @param name 项名
+ * @param name 项名，必须是驻留过的字符串，因为这里只比较指针
  * @return pTableItem 如果存在则返回，否则返回NULL
  */
-pTableItem getSymbolTableItem(pSymbolTable table, char *name)
+pTableItem getSymbolTableItem(pSymbolTable table, const char *name)
 {
-    unsigned int hashCode = hash_pjw(name);
-    pTableItem temp = GET_HASH_HEAD(table->hashTable, hashCode);
-    while (temp)
-    {
-        if (!strcmp(temp->field->name, name))
-        {
-            return temp;
-        }
-        temp = temp->nextHash;
-    }
-    return NULL;
+    pHashTable hashTable = table->hashTable;
+    hashTable->lookups++;
+    pTableItem item = findVisibleItem(hashTable, name, table->horizon, &hashTable->probes);
+    if (item == NULL && table->globals)
+        item = findVisibleItem(table->globals->hashTable, name, table->horizon, &hashTable->probes);
+    return item;
 }
 
 /**
@@ -341,18 +963,28 @@ pTableItem getSymbolTableItem(pSymbolTable table, char *name)
 void freeTableItem(pTableItem tableItem)
 {
     assert(tableItem != NULL);
+    if (tableItem->builtin != NULL)
+        return;
     if (tableItem->field != NULL)
         freeFieldList(tableItem->field);
     FREE(tableItem);
 }
 
-pFieldList newFieldList(char *name, pType type)
+/**
+ * @brief 新建一个域
+ *
+ * @param name 驻留过的名字，可以为NULL
+ * @param type 域的类型
+ * @return pFieldList
+ */
+pFieldList newFieldList(const char *name, pType type)
 {
     pFieldList fieldList = (pFieldList)malloc(sizeof(struct FieldList_));
     assert(fieldList != NULL);
-    fieldList->name = newString(name);
+    fieldList->name = name;
     fieldList->type = type;
     fieldList->isParam = false;
+    fieldList->offset = 0;
     fieldList->tail = NULL;
     return fieldList;
 }
@@ -376,83 +1008,67 @@ void printFieldList(pFieldList fieldList)
     }
 }
 
-pFieldList copyFieldList(pFieldList srcFeildList)
-{
-    pFieldList head = NULL, cur = NULL;
-    pFieldList temp = srcFeildList;
-
-    while (temp)
-    {
-        if (!head)
-        {
-            head = newFieldList(temp->name, copyType(temp->type));
-            cur = head;
-            temp = temp->tail;
-        }
-        else
-        {
-            cur->tail = newFieldList(temp->name, copyType(temp->type));
-            cur = cur->tail;
-            temp = temp->tail;
-        }
-    }
-    return head;
-}
+/**
+ * @brief 释放一个域，域的类型属于类型表，不在这里释放
+ *
+ * @param feildList
+ */
 void freeFieldList(pFieldList feildList)
 {
     assert(feildList != NULL);
-    FREE(feildList->name);
-    if (feildList->type)
-        freeType(feildList->type);
-    feildList->type == NULL;
     FREE(feildList);
 }
 
 /**
- * @brief 新建一个hash表
+ * @brief 新建一个hash表，一开始只有SYMBOL_TABLE_INIT_SIZE个槽，随着名字变多扩容
  *
+ * @param hash hash函数
  * @return pHashTable
  */
-pHashTable newHashTable()
+pHashTable newHashTable(SymbolHash hash)
 {
     pHashTable hashTable = malloc(sizeof(struct HashTable_));
     assert(hashTable != NULL);
-    hashTable->hashArray = malloc(sizeof(struct TableItem_) * SYMBOL_TABLE_SIZE);
+    hashTable->hash = hash;
+    hashTable->lookups = 0;
+    hashTable->probes = 0;
+    hashTable->capacity = SYMBOL_TABLE_INIT_SIZE;
+    hashTable->shift = 32;
+    for (unsigned capacity = SYMBOL_TABLE_INIT_SIZE; capacity > 1; capacity >>= 1)
+        hashTable->shift--;
+    hashTable->count = 0;
+    hashTable->deleted = 0;
+    hashTable->hashArray = calloc(hashTable->capacity, sizeof(pTableItem));
     assert(hashTable->hashArray != NULL);
-    for (int i = 0; i < SYMBOL_TABLE_SIZE; i++)
-    {
-        hashTable->hashArray[i] = NULL;
-    }
     return hashTable;
 }
 
 /**
- * @brief 释放hash表的空间
+ * @brief 释放hash表的空间，表中所有的item都一起释放
  *
  * @param hashTable hash表
  */
 void freeHashTable(pHashTable hashTable)
 {
     if (!hashTable)
+        return;
+    for (unsigned i = 0; i < hashTable->capacity; i++)
     {
-        for (int i = 0; i < SYMBOL_TABLE_SIZE; i++)
+        pTableItem temp = hashTable->hashArray[i] == DELETED_ITEM ? NULL : hashTable->hashArray[i];
+        while (temp)
         {
-            pTableItem temp = hashTable->hashArray[i];
-            while (temp)
-            {
-                pTableItem toBeFreeTemp = temp;
-                temp = temp->nextHash;
-                freeTableItem(toBeFreeTemp);
-            }
-            hashTable->hashArray[i] = NULL;
+            pTableItem toBeFreeTemp = temp;
+            temp = temp->nextHash;
+            freeTableItem(toBeFreeTemp);
         }
+        hashTable->hashArray[i] = NULL;
     }
     FREE(hashTable->hashArray);
     FREE(hashTable);
 }
 
 /**
- * @brief 新建一个栈
+ * @brief 新建一个栈，一开始只有SCOPE_STACK_INIT_SIZE层，嵌套得更深时扩容
  *
  * @return pStack
  */
@@ -460,22 +1076,38 @@ pStack newStack()
 {
     pStack stack = malloc(sizeof(struct Stack_));
     assert(stack != NULL);
-    stack->stackArray = malloc(sizeof(struct TableItem_) * SYMBOL_TABLE_SIZE);
+    stack->capacity = SCOPE_STACK_INIT_SIZE;
+    stack->stackArray = calloc(stack->capacity, sizeof(pTableItem));
     assert(stack->stackArray != NULL);
-    for (int i = 0; i < SYMBOL_TABLE_SIZE; i++)
-    {
-        stack->stackArray[i] = NULL;
-    }
     stack->stackDepth = 0;
+    stack->deepest = 0;
     return stack;
 }
 
+/**
+ * @brief 进入一层新的作用域，层数不够时扩容到两倍，新的层都是空的
+ *
+ * @param stack 栈
+ */
+void pushStackLayer(pStack stack)
+{
+    if (stack->stackDepth + 1 >= stack->capacity)
+    {
+        int capacity = stack->capacity * 2;
+        stack->stackArray = realloc(stack->stackArray, capacity * sizeof(pTableItem));
+        assert(stack->stackArray != NULL);
+        memset(stack->stackArray + stack->capacity, 0, (capacity - stack->capacity) * sizeof(pTableItem));
+        stack->capacity = capacity;
+    }
+    stack->stackDepth++;
+}
+
 void printStack(pStack stack)
 {
     pTableItem item = GET_STACK_HEAD(stack);
     while (item)
     {
-        printf("[%d] -> name: %s depth: %d address :%p \n", hash_pjw(item->field->name), item->field->name,
+        printf("[%u] -> name: %s depth: %d address :%p \n", item->hash, item->field->name,
                item->symbolDepth, item);
         printf("========FiledList========\n");
         printFieldList(item->field);
@@ -485,7 +1117,8 @@ void printStack(pStack stack)
     }
 }
 /**
- * @brief 清除符号表的栈的最高层
+ * @brief 清除符号表的栈的最高层，花的时间只和这一层的符号个数有关，
+ * 不需要重新算hash，也不需要沿着同名的链表找
  *
  * @param symbolTable 一个符号表
  */
@@ -493,37 +1126,86 @@ void clearHeadLayerStack(pSymbolTable symbolTable)
 {
     assert(symbolTable != NULL);
     pStack stack = symbolTable->stack;
-    pHashTable hashTable = symbolTable->hashTable;
     pTableItem temp = GET_STACK_HEAD(stack);
     while (temp)
     {
         pTableItem tobeFree = temp;
         temp = temp->nextSymbol;
-        unsigned hashCode = hash_pjw(tobeFree->field->name);
-        pTableItem prev = GET_HASH_HEAD(hashTable, hashCode);
-        //  上面一定要用pTableItem承接GET_HASH_HEAD的值，不然比较不了。可能是因为我宏定
-        //  义的是一个三元表达式
-        //  如果要删除的项在hash表最内层那就很容易，直接删掉链接就好了
-        if (tobeFree == prev)
-        {
-            SET_HASH_HEAD(hashTable, hashCode, tobeFree->nextHash);
-        }
-        //  如果要删除的项在hash表的中间层及更后面
-        else
-        {
-            //  因为prev肯定不是了，所以直接比较它的儿子
-            while (prev->nextHash != tobeFree && prev->nextHash != NULL)
-            {
-                prev = prev->nextHash;
-            }
-            prev->nextHash = tobeFree->nextHash;
-        }
+        unlinkTableItem(symbolTable->hashTable, tobeFree);
         freeTableItem(tobeFree);
     }
 
     SET_STACK_HEAD(stack, NULL);
 }
 
+/**
+ * @brief 清除全局作用域以外的所有符号。流式编译时一个函数翻译完以后它的参数和局部变量就不会再被用到了，
+ * 清掉以后符号表的大小只和全局符号以及最大的函数有关
+ *
+ * @param symbolTable 一个符号表，当前必须在全局作用域
+ */
+void clearLocalSymbols(pSymbolTable symbolTable)
+{
+    assert(symbolTable != NULL);
+    pStack stack = symbolTable->stack;
+    assert(stack->stackDepth == 0);
+    for (int depth = stack->deepest; depth > 0; depth--)
+    {
+        stack->stackDepth = depth;
+        clearHeadLayerStack(symbolTable);
+    }
+    stack->stackDepth = 0;
+    stack->deepest = 0;
+}
+
+/**
+ * @brief 把某一层的符号按加入的顺序复制到类型表里，符号表清掉这一层以后还可以用restoreScopeSymbols放回去。
+ * 增量分析用它记下FunDec放在第1层的参数和参数里定义的结构体，重新分析函数体之前再放回去
+ *
+ * @param compiler
+ * @param depth 层数
+ * @return pFieldList 复制出来的域，和类型表一起释放
+ */
+pFieldList saveScopeSymbols(pCompiler compiler, int depth)
+{
+    pStack stack = compiler->symbolTable->stack;
+    if (depth > stack->deepest)
+        return NULL;
+    //一层中的item是后加入的在前面，头插以后就是加入的顺序
+    pFieldList head = NULL;
+    for (pTableItem item = stack->stackArray[depth]; item; item = item->nextSymbol)
+    {
+        pFieldList field = newTypeField(compiler->types, item->field->name, item->field->type);
+        field->isParam = item->field->isParam;
+        field->tail = head;
+        head = field;
+    }
+    return head;
+}
+
+/**
+ * @brief 把saveScopeSymbols复制出来的符号按原来的顺序放回第depth层，不再检查冲突，
+ * item的order是符号表当前的order
+ *
+ * @param compiler
+ * @param depth 层数，当前必须在全局作用域
+ * @param symbols saveScopeSymbols的返回值
+ */
+void restoreScopeSymbols(pCompiler compiler, int depth, pFieldList symbols)
+{
+    pStack stack = compiler->symbolTable->stack;
+    assert(stack->stackDepth == 0);
+    while (stack->stackDepth < depth)
+        pushStackLayer(stack);
+    for (; symbols; symbols = symbols->tail)
+    {
+        pTableItem item = newTableItem(depth, newFieldList(symbols->name, symbols->type));
+        item->field->isParam = symbols->isParam;
+        insertTableItem(compiler->symbolTable, item);
+    }
+    stack->stackDepth = 0;
+}
+
 /**
  * @brief 释放栈空间，需要注意的是由于这个函数需配合freeHashTable使用，并且在其后调用，不然存在内存泄露
  *
@@ -537,43 +1219,87 @@ void freeStack(pStack stack)
     FREE(stack);
 }
 
+static const struct Type_ builtinInt = {BASIC, {.basic = INT_TYPE_}};
+static const struct FieldList_ builtinIntArg = {"arg1", (pType)&builtinInt, false, 0, NULL};
+
+/**
+ * @brief 内置函数表，加新的内置函数时在这里加一项，再改BUILTIN_COUNT，翻译函数写在inter.c中
+ *
+ */
+static const struct Builtin_ builtins[BUILTIN_COUNT] = {
+    {"read", {FUNCTION, {.function = {0, NULL, (pType)&builtinInt}}}, lowerRead},
+    {"write", {FUNCTION, {.function = {1, (pFieldList)&builtinIntArg, (pType)&builtinInt}}}, lowerWrite},
+};
+
+const struct Builtin_ *getBuiltin(int index)
+{
+    return &builtins[index];
+}
+
 /**
  * @brief 新建一个符号表
  *
  * @return pSymbolTable
  */
-pSymbolTable initSymbolTable()
+pSymbolTable initSymbolTable(pCompiler compiler)
+{
+    pSymbolTable symbolTable = malloc(sizeof(struct SymbolTable_));
+    assert(symbolTable != NULL);
+    symbolTable->hashTable = newHashTable(compiler->symbolHash ? compiler->symbolHash : getSymbolHash(NULL));
+    symbolTable->stack = newStack();
+    symbolTable->unamedStructNum = 0;
+    symbolTable->order = 0;
+    symbolTable->horizon = UINT_MAX;
+    symbolTable->globals = NULL;
+    // 添加read和write等内置函数，item和域都在符号表里，类型是静态的
+    for (int i = 0; i < BUILTIN_COUNT; i++)
+    {
+        const struct Builtin_ *builtin = getBuiltin(i);
+        pFieldList field = &symbolTable->builtinFields[i];
+        field->name = intern(compiler->strings, builtin->name);
+        field->type = (pType)&builtin->type;
+        field->isParam = false;
+        field->offset = 0;
+        field->tail = NULL;
+        pTableItem item = &symbolTable->builtinItems[i];
+        memset(item, 0, sizeof(struct TableItem_));
+        item->symbolDepth = 0;
+        item->field = field;
+        item->builtin = builtin;
+        insertTableItem(symbolTable, item);
+    }
+    return symbolTable;
+}
+
+/**
+ * @brief 新建一个函数体私有的局部作用域，分析函数体时加入的符号都放在这里，
+ * 找不到的名字再到globals中找。多个线程可以各用一个局部作用域同时分析不同的函数体，共用同一个全局作用域
+ *
+ * @param globals 全局作用域，用的时候不能修改
+ * @return pSymbolTable
+ */
+pSymbolTable newLocalSymbolTable(pSymbolTable globals)
 {
     pSymbolTable symbolTable = malloc(sizeof(struct SymbolTable_));
     assert(symbolTable != NULL);
-    symbolTable->hashTable = newHashTable();
+    symbolTable->hashTable = newHashTable(globals->hashTable->hash);
     symbolTable->stack = newStack();
     symbolTable->unamedStructNum = 0;
-    // 添加read和write函数
-    pTableItem readFun = newTableItem(
-        0, newFieldList(newString("read"),
-                        newType(FUNCTION, 0, NULL, newType(BASIC, INT_TYPE_))));
-
-    pTableItem writeFun = newTableItem(
-        0, newFieldList(newString("write"),
-                        newType(FUNCTION, 1,
-                                newFieldList("arg1", newType(BASIC, INT_TYPE_)),
-                                newType(BASIC, INT_TYPE_))));
-
-    insertTableItem(symbolTable, readFun);
-    insertTableItem(symbolTable, writeFun);
+    symbolTable->order = 0;
+    symbolTable->horizon = UINT_MAX;
+    symbolTable->globals = globals;
     return symbolTable;
 }
 
 void printSymbolTable(pSymbolTable table)
 {
     printf("----------------hash_table----------------\n");
-    for (int i = 0; i < SYMBOL_TABLE_SIZE; i++)
+    for (unsigned i = 0; i < table->hashTable->capacity; i++)
     {
-        pTableItem item = GET_HASH_HEAD(table->hashTable, i);
-        if (item)
+        pTableItem item = table->hashTable->hashArray[i];
+        if (item && item != DELETED_ITEM)
         {
-            printf("[%d]", i);
+            printf("[%u]", i);
             while (item)
             {
                 printf(" -> name: %s depth: %d address:%p\n", item->field->name,
@@ -589,6 +1315,101 @@ void printSymbolTable(pSymbolTable table)
     printf("-------------------end--------------------\n");
 }
 
+/**
+ * @brief 按2的幂分组打印直方图，第i组是长度在(2^(i-1), 2^i]之间的个数
+ *
+ * @param out 输出
+ * @param title 直方图的名字
+ * @param histogram 各组的个数
+ * @param longest 最长的长度
+ */
+static void printHistogram(FILE *out, const char *title, const unsigned long *histogram, unsigned longest)
+{
+    fprintf(out, "%s (longest %u):", title, longest);
+    for (int i = 0; i < 32; i++)
+    {
+        if (histogram[i] == 0)
+            continue;
+        if (i <= 1)
+            fprintf(out, " %u: %lu", 1u << i, histogram[i]);
+        else
+            fprintf(out, " %u-%u: %lu", (1u << (i - 1)) + 1, 1u << i, histogram[i]);
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * @brief 长度放到哪一组，和printHistogram的分组一致
+ *
+ * @param length 大于0的长度
+ * @return int 组的下标
+ */
+static int histogramBucket(unsigned length)
+{
+    int bucket = 0;
+    while ((1u << bucket) < length)
+        bucket++;
+    return bucket;
+}
+
+/**
+ * @brief --symbol-stats，打印符号表的占用情况：
+ * 每个名字离它理想的槽有多远（找到它要看几个槽）、连续被占用的槽有多长、同名的item串得多长，
+ * 以及getSymbolTableItem平均要看几个槽
+ *
+ * @param table 符号表
+ * @param out 输出
+ */
+void printSymbolTableStats(pSymbolTable table, FILE *out)
+{
+    pHashTable hashTable = table->hashTable;
+    unsigned long probeHistogram[32] = {0}, clusterHistogram[32] = {0}, shadowHistogram[32] = {0};
+    unsigned longestProbe = 0, longestCluster = 0, longestShadow = 0;
+    unsigned mask = hashTable->capacity - 1;
+    //从一个空槽开始数连续被占用的槽，表不会满，所以一定有空槽
+    unsigned start = 0;
+    while (hashTable->hashArray[start])
+        start++;
+    unsigned cluster = 0;
+    for (unsigned i = 1; i <= hashTable->capacity; i++)
+    {
+        unsigned slot = (start + i) & mask;
+        pTableItem item = hashTable->hashArray[slot];
+        if (item == NULL)
+        {
+            if (cluster)
+            {
+                clusterHistogram[histogramBucket(cluster)]++;
+                if (cluster > longestCluster)
+                    longestCluster = cluster;
+            }
+            cluster = 0;
+            continue;
+        }
+        cluster++;
+        if (item == DELETED_ITEM)
+            continue;
+        unsigned probe = ((slot - homeHashSlot(hashTable, item->hash)) & mask) + 1;
+        probeHistogram[histogramBucket(probe)]++;
+        if (probe > longestProbe)
+            longestProbe = probe;
+        unsigned shadow = 0;
+        for (; item; item = item->nextHash)
+            shadow++;
+        shadowHistogram[histogramBucket(shadow)]++;
+        if (shadow > longestShadow)
+            longestShadow = shadow;
+    }
+    fprintf(out, "symbol table: hash %s, %u slots, %u names, %u tombstones, load %.3f\n",
+            getSymbolHashName(hashTable->hash), hashTable->capacity, hashTable->count, hashTable->deleted,
+            (double)(hashTable->count + hashTable->deleted) / hashTable->capacity);
+    fprintf(out, "symbol lookups: %lu, %lu probes, %.3f probes per lookup\n", hashTable->lookups,
+            hashTable->probes, hashTable->lookups ? (double)hashTable->probes / hashTable->lookups : 0.0);
+    printHistogram(out, "probe length", probeHistogram, longestProbe);
+    printHistogram(out, "cluster length", clusterHistogram, longestCluster);
+    printHistogram(out, "same-name chain", shadowHistogram, longestShadow);
+}
+
 /**
  * @brief 这个函数的实现对于结构体的定义，也就是结构体中的变量到底算第几级
  * 有问题，如果不影响验收就不改了，当然也有可能是我还没有想明白
@@ -601,22 +1422,31 @@ void printSymbolTable(pSymbolTable table)
  */
 bool checkTableItemConflict(pSymbolTable table, pTableItem item)
 {
-    pTableItem temp = getSymbolTableItem(table, item->field->name);
-    if (temp == NULL)
-        return false;
-    while (temp)
+    table->hashTable->lookups++;
+    //先看自己的同名链表，是函数体私有的局部作用域时再看全局作用域的
+    for (pSymbolTable scope = table; scope; scope = scope->globals)
     {
-        if (!strcmp(temp->field->name, item->field->name))
+        pTableItem temp = findVisibleItem(scope->hashTable, item->field->name, table->horizon, &table->hashTable->probes);
+        while (temp)
         {
-            if (temp->field->type->kind == STRUCTURE ||
-                item->field->type->kind == STRUCTURE)
-                return true;
-            if (temp->symbolDepth == table->stack->stackDepth)
+            //  剩下的item都比当前这一层浅，也没有结构体，不会再冲突了。
+            //  同名的变量一层层遮住外层的变量时链表很长，不能每次都走到底
+            bool structure = item->field->type && item->field->type->kind == STRUCTURE;
+            if (!structure && !temp->shadowStructure &&
+                temp->shadowDepth < table->stack->stackDepth)
+                break;
+            if (temp->field->name == item->field->name && temp->order <= table->horizon)
             {
-                return true;
+                if (temp->field->type->kind == STRUCTURE ||
+                    item->field->type->kind == STRUCTURE)
+                    return true;
+                if (temp->symbolDepth == table->stack->stackDepth)
+                {
+                    return true;
+                }
             }
+            temp = temp->nextHash;
         }
-        temp = temp->nextHash;
     }
     return false;
 }
@@ -637,22 +1467,22 @@ void freeSymbolTable(pSymbolTable symbolTable)
 }
 
 /**
- * @brief 按照先根遍历开始语义分析
+ * @brief 开始语义分析，沿着ExtDefList循环分析每一个ExtDef，不会因为文件很长而递归很深
  *
- * @param currentNode 语法树的节点
+ * @param currentNode 语法树的根节点Program
  */
-void startSemanticAnalysis(pNode currentNode)
+void startSemanticAnalysis(pCompiler compiler, pNode currentNode)
 {
-    if (currentNode)
+    /*
+    Program:            ExtDefList
+    ExtDefList:         ExtDef ExtDefList
+        |
+    */
+    pNode extDefList = currentNode ? getChild(currentNode) : NULL;
+    while (extDefList && !compiler->diagnostics->truncated)
     {
-        if (!strcmp(currentNode->name, "ExtDef"))
-        {
-            ExtDef(currentNode);
-            startSemanticAnalysis(currentNode->brother);
-            return;
-        }
-        startSemanticAnalysis(currentNode->child);
-        startSemanticAnalysis(currentNode->brother);
+        ExtDef(compiler, getChild(extDefList));
+        extDefList = getBrother(getChild(extDefList));
     }
 }
 
@@ -661,7 +1491,7 @@ void startSemanticAnalysis(pNode currentNode)
  *
  * @param currentNode 当前节点要求为ExtDef
  */
-void ExtDef(pNode currentNode)
+void ExtDef(pCompiler compiler, pNode currentNode)
 {
     /*
     ExtDef:             Specifier ExtDecList SEMI
@@ -670,28 +1500,28 @@ void ExtDef(pNode currentNode)
         |               Specifier FunDec SEMI
     */
     assert(currentNode != NULL);
-    pNode secondChild = currentNode->child->brother;
-    pType type = Specifier(currentNode->child);
-    if (!strcmp(secondChild->name, "ExtDecList"))
-    {
-        ExtDecList(secondChild, type);
-    }
-    else if (!strcmp(secondChild->name, "FunDec"))
+    pNode secondChild = getBrother(getChild(currentNode));
+    pType type = Specifier(compiler, getChild(currentNode));
+    switch (currentNode->production)
     {
-        FunDec(secondChild, type);
-        if (!strcmp(secondChild->brother->name, "CompSt"))
-        {
-            //只有函数定义的时候才需要进来
-            CompSt(secondChild->brother, type);
-        }
-        else
-        {
-            // 不再需要关注函数声明了
-            // //需要将FunDec中添加的深度为1的栈清除
-            // STACK_INC_DEPTH(symbolTable->stack);
-            // clearHeadLayerStack(symbolTable);
-            // STACK_DEC_DEPTH(symbolTable->stack);
-        }
+    case EXTDEF_VAR:
+        ExtDecList(compiler, secondChild, type);
+        break;
+    case EXTDEF_FUNC:
+        FunDec(compiler, secondChild, type);
+        //只有函数定义的时候才需要进来
+        CompSt(compiler, getBrother(secondChild), type);
+        break;
+    case EXTDEF_FUNC_DEC:
+        FunDec(compiler, secondChild, type);
+        // 不再需要关注函数声明了
+        // //需要将FunDec中添加的深度为1的栈清除
+        // STACK_INC_DEPTH(compiler->symbolTable->stack);
+        // clearHeadLayerStack(compiler->symbolTable);
+        // STACK_DEC_DEPTH(compiler->symbolTable->stack);
+        break;
+    default:
+        break;
     }
 }
 
@@ -701,7 +1531,7 @@ void ExtDef(pNode currentNode)
  * @param currentNode
  * @return pType
  */
-pType Specifier(pNode currentNode)
+pType Specifier(pCompiler compiler, pNode currentNode)
 {
     /*
     Specifier:          TYPE
@@ -709,22 +1539,22 @@ pType Specifier(pNode currentNode)
     */
     assert(currentNode != NULL);
     pType resultType;
-    assert(currentNode->child != NULL);
-    pNode child = currentNode->child;
-    if (!strcmp(child->name, "TYPE"))
+    assert(getChild(currentNode) != NULL);
+    pNode child = getChild(currentNode);
+    if (currentNode->production == SPECIFIER_TYPE)
     {
-        if (!strcmp(child->value, "float"))
+        if (!strcmp(getNodeValue(compiler, child), "float"))
         {
-            return newType(BASIC, FLOAT_TYPE_);
+            return getBasicType(compiler->types, FLOAT_TYPE_);
         }
-        else if (!strcmp(child->value, "int"))
+        else
         {
-            return newType(BASIC, INT_TYPE_);
+            return getBasicType(compiler->types, INT_TYPE_);
         }
     }
-    else if (!strcmp(child->name, "StructSpecifier"))
+    else
     {
-        return StructSpecifier(currentNode->child);
+        return StructSpecifier(compiler, getChild(currentNode));
     }
 }
 
@@ -739,7 +1569,7 @@ bool isStructDef(pTableItem tableItem)
     return true;
 }
 
-pType StructSpecifier(pNode currentNode)
+pType StructSpecifier(pCompiler compiler, pNode currentNode)
 {
     /*
     StructSpecifier:    STRUCT OptTag LC DefList RC
@@ -751,62 +1581,58 @@ pType StructSpecifier(pNode currentNode)
 
     assert(currentNode != NULL);
     pType returnType = NULL;
-    assert(currentNode->child != NULL);
-    pNode child = currentNode->child->brother;
+    assert(getChild(currentNode) != NULL);
+    pNode child = getBrother(getChild(currentNode));
 
-    if (!strcmp(child->name, "Tag"))
+    if (currentNode->production == STRUCTSPECIFIER_TAG)
     {
-        pTableItem structureItem = getSymbolTableItem(symbolTable, child->child->value);
+        pTableItem structureItem = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, getChild(child)));
 
         if (structureItem == NULL || !isStructDef(structureItem))
         {
-            pError(UNDEF_STRUCT, currentNode->lineno, child->child->value);
+            pError(compiler, UNDEF_STRUCT, currentNode->lineno, getNodeValue(compiler, getChild(child)));
         }
         else
-            returnType = newType(
-                STRUCTURE, newString(structureItem->field->name),
-                copyFieldList(structureItem->field->type->u.structure.structureField));
+            returnType = getStructureType(compiler->types, structureItem->field->name,
+                                          structureItem->field->type->u.structure.structureField);
     }
     // OptTag -> ID | e
     else
     {
         pTableItem structureItem =
-            newTableItem(symbolTable->stack->stackDepth,
-                         newFieldList(NULL, newType(STRUCTURE, NULL, NULL)));
+            newTableItem(compiler->symbolTable->stack->stackDepth,
+                         newFieldList(NULL, newStructureDefType(compiler->types)));
         // OptTag -> ID
-        if (!strcmp(child->name, "OptTag"))
+        if (child->kind == SYMBOL_OptTag)
         {
-            SET_FEILDLIST_NAME(structureItem->field, child->child->value);
-            child = child->brother->brother;
+            SET_FEILDLIST_NAME(structureItem->field, getNodeValue(compiler, getChild(child)));
+            child = getBrother(getBrother(child));
         }
         // OptTag -> e
         else
         {
-            char msg[30] = "\0";
-            sprintf(msg, "%d", symbolTable->unamedStructNum++);
-            SET_FEILDLIST_NAME(structureItem->field, msg);
-            child = child->brother;
+            SET_FEILDLIST_NAME(structureItem->field, newStructName(compiler->types, compiler->symbolTable->unamedStructNum++));
+            child = getBrother(child);
         }
-        if (!strcmp(child->name, "DefList"))
+        if (child->kind == SYMBOL_DefList)
         {
-            DefList(child, structureItem);
+            DefList(compiler, child, structureItem);
         }
 
         //存在相同结构体定义
-        if (checkTableItemConflict(symbolTable, structureItem))
+        if (checkTableItemConflict(compiler->symbolTable, structureItem))
         {
-            pError(DUPLICATED_NAME, currentNode->lineno, structureItem->field->name);
+            pError(compiler, DUPLICATED_NAME, currentNode->lineno, structureItem->field->name);
             freeTableItem(structureItem);
         }
         //不存在相同结构体定义
         else
         {
-            returnType = newType(
-                STRUCTURE, newString(structureItem->field->name),
-                copyFieldList(structureItem->field->type->u.structure.structureField));
-            if (!strcmp(currentNode->child->brother->name, "OptTag"))
+            returnType = getStructureType(compiler->types, structureItem->field->name,
+                                          structureItem->field->type->u.structure.structureField);
+            if (getBrother(getChild(currentNode))->kind == SYMBOL_OptTag)
             {
-                insertTableItem(symbolTable, structureItem);
+                insertTableItem(compiler->symbolTable, structureItem);
             }
             // OptTag -> e
             else
@@ -825,17 +1651,17 @@ pType StructSpecifier(pNode currentNode)
  * @param currentNode
  * @param structureItem
  */
-void DefList(pNode currentNode, pTableItem structureItem)
+void DefList(pCompiler compiler, pNode currentNode, pTableItem structureItem)
 {
     /*
     因为DefList可能是空的
     DefList:            Def DefList
         |
     */
-    while (currentNode)
+    while (currentNode && !compiler->diagnostics->truncated)
     {
-        Def(currentNode->child, structureItem);
-        currentNode = currentNode->child->brother;
+        Def(compiler, getChild(currentNode), structureItem);
+        currentNode = getBrother(getChild(currentNode));
     }
 }
 
@@ -845,18 +1671,16 @@ void DefList(pNode currentNode, pTableItem structureItem)
  * @param currentNode
  * @param structureItem
  */
-void Def(pNode currentNode, pTableItem structureItem)
+void Def(pCompiler compiler, pNode currentNode, pTableItem structureItem)
 {
     /*
     Def:                Specifier DecList SEMI
         ;
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
-    pType type = Specifier(child);
-    DecList(currentNode->child->brother, type, structureItem);
-    if (type)
-        freeType(type); //使用完后有关的type就已经在structureItem中了，因此可以去掉了
+    pNode child = getChild(currentNode);
+    pType type = Specifier(compiler, child);
+    DecList(compiler, getBrother(getChild(currentNode)), type, structureItem);
 }
 
 /**
@@ -866,7 +1690,7 @@ void Def(pNode currentNode, pTableItem structureItem)
  * @param type
  * @param structureItem
  */
-void DecList(pNode currentNode, pType type, pTableItem structureItem)
+void DecList(pCompiler compiler, pNode currentNode, pType type, pTableItem structureItem)
 {
     /*
     DecList:            Dec
@@ -875,26 +1699,26 @@ void DecList(pNode currentNode, pType type, pTableItem structureItem)
     */
     while (currentNode)
     {
-        Dec(currentNode->child, type, structureItem);
-        currentNode = currentNode->child->brother ? currentNode->child->brother->brother : NULL;
+        Dec(compiler, getChild(currentNode), type, structureItem);
+        currentNode = getBrother(getChild(currentNode)) ? getBrother(getBrother(getChild(currentNode))) : NULL;
     }
 }
 
-void Dec(pNode currentNode, pType type, pTableItem structureItem)
+void Dec(pCompiler compiler, pNode currentNode, pType type, pTableItem structureItem)
 {
     /*
     Dec:                VarDec
         |               VarDec ASSIGNOP Exp
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
+    pNode child = getChild(currentNode);
     // Dec -> VarDec ASSIGNOP Exp
-    if (child->brother)
+    if (getBrother(child))
     {
         //处在结构体定义内
         if (structureItem)
         {
-            pError(REDEF_FEILD, currentNode->lineno,
+            pError(compiler, REDEF_FEILD, currentNode->lineno,
                    NULL);
         }
         //在函数的定义语句中的赋值语句
@@ -903,35 +1727,32 @@ void Dec(pNode currentNode, pType type, pTableItem structureItem)
             // 判断赋值类型是否相符
             //如果成功，注册该符号
             pTableItem tableItem = newTableItem(
-                symbolTable->stack->stackDepth, VarDec(child, type));
-            pType exptype = Exp(child->brother->brother);
-            if (checkTableItemConflict(symbolTable, tableItem))
+                compiler->symbolTable->stack->stackDepth, VarDec(compiler, child, type));
+            pType exptype = Exp(compiler, getBrother(getBrother(child)));
+            if (checkTableItemConflict(compiler->symbolTable, tableItem))
             {
-                pError(REDEF_VAR, currentNode->lineno, tableItem->field->name);
+                pError(compiler, REDEF_VAR, currentNode->lineno, tableItem->field->name);
                 freeTableItem(tableItem);
             }
             if (!checkType(tableItem->field->type, exptype))
             {
                 //类型不相符
                 //报错
-                pError(TYPE_MISMATCH_ASSIGN, currentNode->lineno,
+                pError(compiler, TYPE_MISMATCH_ASSIGN, currentNode->lineno,
                        NULL);
                 freeTableItem(tableItem);
             }
             if (tableItem->field->type && tableItem->field->type->kind == ARRAY)
             {
                 //报错，对非basic类型赋值
-                pError(TYPE_MISMATCH_ASSIGN, currentNode->lineno,
+                pError(compiler, TYPE_MISMATCH_ASSIGN, currentNode->lineno,
                        NULL);
                 freeTableItem(tableItem);
             }
             else
             {
-                insertTableItem(symbolTable, tableItem);
+                insertTableItem(compiler->symbolTable, tableItem);
             }
-            // exp不出意外应该返回一个无用的type，删除
-            if (exptype)
-                freeType(exptype);
         }
     }
     // Dec -> VarDec
@@ -941,15 +1762,15 @@ void Dec(pNode currentNode, pType type, pTableItem structureItem)
         if (structureItem)
         {
 
-            pFieldList feildList = VarDec(child, type);
+            pFieldList feildList = VarDec(compiler, child, type);
             pFieldList structField = structureItem->field->type->u.structure.structureField;
             pFieldList last = NULL;
             while (structField != NULL)
             {
                 // then we have to check
-                if (!strcmp(feildList->name, structField->name))
+                if (feildList->name == structField->name)
                 {
-                    pError(REDEF_FEILD, currentNode->lineno, feildList->name);
+                    pError(compiler, REDEF_FEILD, currentNode->lineno, feildList->name);
                     freeFieldList(feildList);
                     return;
                 }
@@ -959,16 +1780,16 @@ void Dec(pNode currentNode, pType type, pTableItem structureItem)
                     structField = structField->tail;
                 }
             }
-            //新建一个fieldlist,删除之前的item
+            //结构体的域放在类型表中，删除VarDec返回的fieldlist
             if (last == NULL)
             {
                 // that is good
                 structureItem->field->type->u.structure.structureField =
-                    copyFieldList(feildList);
+                    newTypeField(compiler->types, feildList->name, feildList->type);
             }
             else
             {
-                last->tail = copyFieldList(feildList);
+                last->tail = newTypeField(compiler->types, feildList->name, feildList->type);
             }
             freeFieldList(feildList);
         }
@@ -976,93 +1797,93 @@ void Dec(pNode currentNode, pType type, pTableItem structureItem)
         else
         {
             // 非结构体内，判断返回的item有无冲突，无冲突放入表中，有冲突报错就删除
-            pTableItem tableItem = newTableItem(symbolTable->stack->stackDepth, VarDec(child, type));
-            if (checkTableItemConflict(symbolTable, tableItem))
+            pTableItem tableItem = newTableItem(compiler->symbolTable->stack->stackDepth, VarDec(compiler, child, type));
+            if (checkTableItemConflict(compiler->symbolTable, tableItem))
             {
-                pError(REDEF_VAR, currentNode->lineno, tableItem->field->name);
+                pError(compiler, REDEF_VAR, currentNode->lineno, tableItem->field->name);
                 freeTableItem(tableItem);
             }
             else
             {
-                insertTableItem(symbolTable, tableItem);
+                insertTableItem(compiler->symbolTable, tableItem);
             }
         }
     }
 }
 
-pFieldList VarDec(pNode currentNode, pType type)
+pFieldList VarDec(pCompiler compiler, pNode currentNode, pType type)
 {
     /*
     VarDec:             ID
         |               VarDec LB INT RB
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
+    pNode child = getChild(currentNode);
     // VarDec -> ID
-    if (!strcmp(child->name, "ID"))
+    if (currentNode->production == VARDEC_ID)
     {
-        return newFieldList(child->value, copyType(type));
+        return newFieldList(getNodeValue(compiler, child), type);
     }
     // VarDec -> VarDec LB INT RB
     else
     {
         //需要注意的是ID在里面
         pType temp = type;
-        while (child->child)
+        while (getChild(child))
         {
-            temp = newType(ARRAY, copyType(temp), atoi(child->brother->brother->value));
-            child = child->child;
+            temp = getArrayType(compiler->types, temp, getNodeInt(compiler, getBrother(getBrother(child))));
+            child = getChild(child);
         }
-        return newFieldList(child->value, temp);
+        return newFieldList(getNodeValue(compiler, child), temp);
     }
 }
 
-void ExtDecList(pNode currentNode, pType type)
+void ExtDecList(pCompiler compiler, pNode currentNode, pType type)
 {
     /*
     ExtDecList:         VarDec
         |               VarDec COMMA ExtDecList
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
+    pNode child = getChild(currentNode);
     while (child)
     {
-        pFieldList fieldList = VarDec(child, type);
-        pTableItem tableItem = newTableItem(symbolTable->stack->stackDepth, fieldList);
-        if (checkTableItemConflict(symbolTable, tableItem))
+        pFieldList fieldList = VarDec(compiler, child, type);
+        pTableItem tableItem = newTableItem(compiler->symbolTable->stack->stackDepth, fieldList);
+        if (checkTableItemConflict(compiler->symbolTable, tableItem))
         {
-            pError(REDEF_VAR, child->lineno, tableItem->field->name);
+            pError(compiler, REDEF_VAR, child->lineno, tableItem->field->name);
             freeTableItem(tableItem);
         }
         else
         {
-            insertTableItem(symbolTable, tableItem);
+            insertTableItem(compiler->symbolTable, tableItem);
         }
-        if (child->brother)
-            child = child->brother->brother->child;
+        if (getBrother(child))
+            child = getChild(getBrother(getBrother(child)));
         else
             child = NULL;
     }
 }
 
-void FunDec(pNode currentNode, pType type)
+void FunDec(pCompiler compiler, pNode currentNode, pType type)
 {
     /*
     FunDec:             ID LP VarList RP
         |               ID LP RP
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
-    pTableItem tableItem = newTableItem(symbolTable->stack->stackDepth, newFieldList(child->value,
-                                                                                     newType(FUNCTION, 0, NULL, copyType(type))));
-    if (!strcmp(child->brother->brother->name, "VarList"))
+    pNode child = getChild(currentNode);
+    pTableItem tableItem = newTableItem(compiler->symbolTable->stack->stackDepth, newFieldList(getNodeValue(compiler, child),
+                                                                                     newFunctionType(compiler->types, 0, NULL, type)));
+    if (currentNode->production == FUNDEC_ARGS)
     {
         unsigned argc = 0;
-        tableItem->field->type->u.function.argv = VarList(child->brother->brother, &argc);
+        tableItem->field->type->u.function.argv = VarList(compiler, getBrother(getBrother(child)), &argc);
         tableItem->field->type->u.function.argc = argc;
     }
     //是声明语句
-    // if (!strcmp(currentNode->brother->name, "SEMI"))
+    // if (!strcmp(getBrother(currentNode)->name, "SEMI"))
     // {
     //     pTableItem temp = funcDeckStack->item;
     //     while (temp)
@@ -1083,7 +1904,7 @@ void FunDec(pNode currentNode, pType type)
     //         // 首先检查返回值
     //         if (!checkType(p1->type->u.function.returnType, p2->type->u.function.returnType))
     //         {
-    //             pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+    //             pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
     //             freeTableItem(tableItem);
     //             tableItem = NULL;
     //             return;
@@ -1096,7 +1917,7 @@ void FunDec(pNode currentNode, pType type)
     //             //名字不相同或者类型不相同就说明有问题
     //             if (!checkType(p1->type, p2->type) || strcmp(p1->name, p2->name))
     //             {
-    //                 pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+    //                 pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
     //                 break;
     //             }
     //             p1 = p1->tail;
@@ -1105,11 +1926,11 @@ void FunDec(pNode currentNode, pType type)
     //         //参数数量不一致
     //         if (p1 && !p2)
     //         {
-    //             pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+    //             pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
     //         }
     //         else if (!p1 && p2)
     //         {
-    //             pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+    //             pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
     //         }
     //         freeTableItem(tableItem);
     //         tableItem = NULL;
@@ -1124,9 +1945,9 @@ void FunDec(pNode currentNode, pType type)
     // }
 
     //函数定义语句，是否冲突
-    if (checkTableItemConflict(symbolTable, tableItem))
+    if (checkTableItemConflict(compiler->symbolTable, tableItem))
     {
-        pError(REDEF_FUNC, currentNode->lineno, tableItem->field->name);
+        pError(compiler, REDEF_FUNC, currentNode->lineno, tableItem->field->name);
         freeTableItem(tableItem);
         tableItem = NULL;
     }
@@ -1151,7 +1972,7 @@ void FunDec(pNode currentNode, pType type)
         //     // 首先检查返回值
         //     if (!checkType(p1->type->u.function.returnType, p2->type->u.function.returnType))
         //     {
-        //         pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+        //         pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
         //         freeTableItem(tableItem);
         //         tableItem = NULL;
         //         return;
@@ -1165,7 +1986,7 @@ void FunDec(pNode currentNode, pType type)
         //         //名字不相同或者类型不相同就说明有问题
         //         if (!checkType(p1->type, p2->type) || strcmp(p1->name, p2->name))
         //         {
-        //             pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+        //             pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
         //             break;
         //         }
         //         p1 = p1->tail;
@@ -1174,35 +1995,35 @@ void FunDec(pNode currentNode, pType type)
         //     //参数数量不一致
         //     if (p1 && !p2)
         //     {
-        //         pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+        //         pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
         //     }
         //     else if (!p1 && p2)
         //     {
-        //         pError(DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
+        //         pError(compiler, DCLARE_FUNC_INCONSISTENT, currentNode->lineno, temp->field->name);
         //     }
         // }
         //不管是不是不一致，定义都加入符号表。
 
 
-        insertTableItem(symbolTable, tableItem);
+        insertTableItem(compiler->symbolTable, tableItem);
     }
 }
 
-pFieldList VarList(pNode currentNode, int *argc)
+pFieldList VarList(pCompiler compiler, pNode currentNode, int *argc)
 {
     /*
     VarList:            ParamDec COMMA VarList
         |               ParamDec
     */
     assert(currentNode != NULL);
-    STACK_INC_DEPTH(symbolTable->stack);
+    STACK_INC_DEPTH(compiler->symbolTable->stack);
     pFieldList head = NULL, tail = NULL;
-    pNode child = currentNode->child;
+    pNode child = getChild(currentNode);
     while (child)
     {
         if (head)
         {
-            tail->tail = copyFieldList(ParamDec(child));
+            tail->tail = copyTypeFieldList(compiler->types, ParamDec(compiler, child));
             if (tail->tail)
             {
                 tail = tail->tail;
@@ -1211,42 +2032,40 @@ pFieldList VarList(pNode currentNode, int *argc)
         }
         else
         {
-            head = copyFieldList(ParamDec(child));
+            head = copyTypeFieldList(compiler->types, ParamDec(compiler, child));
             tail = head;
             (*argc)++; //第一个参数肯定不会重复定义，直接加一
         }
-        if (child->brother)
-            child = child->brother->brother->child;
+        if (getBrother(child))
+            child = getChild(getBrother(getBrother(child)));
         else
             child = NULL;
     }
-    STACK_DEC_DEPTH(symbolTable->stack);
+    STACK_DEC_DEPTH(compiler->symbolTable->stack);
     return head;
 }
 
-pFieldList ParamDec(pNode currentNode)
+pFieldList ParamDec(pCompiler compiler, pNode currentNode)
 {
     /*
     ParamDec:           Specifier VarDec
     */
     assert(currentNode != NULL);
-    pNode child = currentNode->child;
-    pType type = Specifier(child);
-    pTableItem tableItem = newTableItem(symbolTable->stack->stackDepth, VarDec(child->brother, type));
+    pNode child = getChild(currentNode);
+    pType type = Specifier(compiler, child);
+    pTableItem tableItem = newTableItem(compiler->symbolTable->stack->stackDepth, VarDec(compiler, getBrother(child), type));
 
-    if (type)
-        freeType(type);
     // 重复定义
-    if (checkTableItemConflict(symbolTable, tableItem))
+    if (checkTableItemConflict(compiler->symbolTable, tableItem))
     {
-        pError(REDEF_VAR, currentNode->lineno, tableItem->field->name);
+        pError(compiler, REDEF_VAR, currentNode->lineno, tableItem->field->name);
         freeTableItem(tableItem);
         return NULL;
     }
     else
     {
         tableItem->field->isParam = true;
-        insertTableItem(symbolTable, tableItem);
+        insertTableItem(compiler->symbolTable, tableItem);
         return tableItem->field;
     }
 }
@@ -1257,43 +2076,43 @@ pFieldList ParamDec(pNode currentNode)
  * @param currentNode
  * @param returnType 如果是函数的语句块就是函数的返回类型，否则为空
  */
-void CompSt(pNode currentNode, pType returnType)
+void CompSt(pCompiler compiler, pNode currentNode, pType returnType)
 {
     /*
     CompSt:             LC DefList StmtList RC
      */
     assert(currentNode != NULL);
     //局部变量了，所以加一层
-    STACK_INC_DEPTH(symbolTable->stack);
-    pNode child = currentNode->child;
-    if (!strcmp(child->brother->name, "DefList"))
+    STACK_INC_DEPTH(compiler->symbolTable->stack);
+    pNode child = getChild(currentNode);
+    if (getBrother(child)->kind == SYMBOL_DefList)
     {
-        DefList(child->brother, NULL);
-        child = child->brother; //这条语句不是没有用的，因为DefList和StmtList可能为空
+        DefList(compiler, getBrother(child), NULL);
+        child = getBrother(child); //这条语句不是没有用的，因为DefList和StmtList可能为空
     }
-    if (!strcmp(child->brother->name, "StmtList"))
+    if (getBrother(child)->kind == SYMBOL_StmtList)
     {
-        StmtList(child->brother, returnType);
+        StmtList(compiler, getBrother(child), returnType);
     }
     // 所有的变量都不重名，因此不在需要清除了
-    // clearHeadLayerStack(symbolTable);
-    STACK_DEC_DEPTH(symbolTable->stack);
+    // clearHeadLayerStack(compiler->symbolTable);
+    STACK_DEC_DEPTH(compiler->symbolTable->stack);
 }
 
-void StmtList(pNode currentNode, pType returnType)
+void StmtList(pCompiler compiler, pNode currentNode, pType returnType)
 {
     /*
     StmtList:           Stmt StmtList
         |         e
     */
-    while (currentNode)
+    while (currentNode && !compiler->diagnostics->truncated)
     {
-        Stmt(currentNode->child, returnType);
-        currentNode = currentNode->child->brother;
+        Stmt(compiler, getChild(currentNode), returnType);
+        currentNode = getBrother(getChild(currentNode));
     }
 }
 
-void Stmt(pNode currentNode, pType returnType)
+void Stmt(pCompiler compiler, pNode currentNode, pType returnType)
 {
     /*
     Stmt:               Exp SEMI
@@ -1304,48 +2123,46 @@ void Stmt(pNode currentNode, pType returnType)
         |               WHILE LP Exp RP Stmt
     */
     pType expType = NULL;
-    pNode child = currentNode->child;
-    // Stmt -> Exp SEMI
-    if (!strcmp(child->name, "Exp"))
+    pNode child = getChild(currentNode);
+    switch (currentNode->production)
     {
-        expType = Exp(child);
-    }
+    // Stmt -> Exp SEMI
+    case STMT_EXP:
+        expType = Exp(compiler, child);
+        break;
     // Stmt -> CompSt
-    else if (!strcmp(child->name, "CompSt"))
-        CompSt(child, returnType);
-
+    case STMT_COMPST:
+        CompSt(compiler, child, returnType);
+        break;
     // Stmt -> RETURN Exp SEMI
-    else if (!strcmp(child->name, "RETURN"))
-    {
-        expType = Exp(child->brother);
+    case STMT_RETURN:
+        expType = Exp(compiler, getBrother(child));
 
         // check return type
         if (!checkType(returnType, expType))
-            pError(TYPE_MISMATCH_RETURN, currentNode->lineno, NULL);
-    }
-
+            pError(compiler, TYPE_MISMATCH_RETURN, currentNode->lineno, NULL);
+        break;
     // Stmt -> IF LP Exp RP Stmt 因为语义分析只是判断类型，不关注执行逻辑
     //，所以接下来就是检查各个表达式是否合适
-    else if (!strcmp(child->name, "IF"))
+    // Stmt -> IF LP Exp RP Stmt ELSE Stmt
+    case STMT_IF:
+    case STMT_IF_ELSE:
     {
-        pNode stmt = child->brother->brother->brother->brother;
-        expType = Exp(child->brother->brother);
-        Stmt(stmt, returnType);
-        // Stmt -> IF LP Exp RP Stmt ELSE Stmt
-        if (stmt->brother != NULL)
-            Stmt(stmt->brother->brother, returnType);
+        pNode stmt = getBrother(getBrother(getBrother(getBrother(child))));
+        expType = Exp(compiler, getBrother(getBrother(child)));
+        Stmt(compiler, stmt, returnType);
+        if (currentNode->production == STMT_IF_ELSE)
+            Stmt(compiler, getBrother(getBrother(stmt)), returnType);
+        break;
     }
-
     // Stmt -> WHILE LP Exp RP Stmt
-    else if (!strcmp(child->name, "WHILE"))
-    {
-        expType = Exp(child->brother->brother);
-        Stmt(child->brother->brother->brother->brother, returnType);
+    case STMT_WHILE:
+        expType = Exp(compiler, getBrother(getBrother(child)));
+        Stmt(compiler, getBrother(getBrother(getBrother(getBrother(child)))), returnType);
+        break;
+    default:
+        break;
     }
-
-    //释放无用类型，因为已经判断完了
-    if (expType)
-        freeType(expType);
 }
 
 /**
@@ -1354,7 +2171,7 @@ void Stmt(pNode currentNode, pType returnType)
  * @param currentNode
  * @return pType
  */
-pType Exp(pNode currentNode)
+pType Exp(pCompiler compiler, pNode currentNode)
 {
     assert(currentNode != NULL);
     /*  Exp -> Exp ASSIGNOP Exp
@@ -1376,274 +2193,216 @@ pType Exp(pNode currentNode)
             | INT
             | FLOAT
     */
-    pNode child = currentNode->child;
-    /*
-    Exp -> Exp ASSIGNOP Exp
-        | Exp AND Exp
-        | Exp OR Exp
-        | Exp RELOP Exp
-        | Exp PLUS Exp
-        | Exp MINUS Exp
-        | Exp STAR Exp
-        | Exp DIV Exp
-        | Exp LB Exp RB
-        | Exp DOT ID
-    */
-    if (!strcmp(child->name, "Exp"))
+    pNode child = getChild(currentNode);
+    switch (currentNode->production)
     {
-        // 基本数学运算符
-        /*
-        Exp -> Exp ASSIGNOP Exp
-            | Exp AND Exp
-            | Exp OR Exp
-            | Exp RELOP Exp
-            | Exp PLUS Exp
-            | Exp MINUS Exp
-            | Exp STAR Exp
-            | Exp DIV Exp
-        */
-        if (strcmp(child->brother->name, "LB") && strcmp(child->brother->name, "DOT"))
-        {
-            pType p1 = Exp(child);                   //左边的类型
-            pType p2 = Exp(child->brother->brother); //右边的类型
-            pType returnType = NULL;
+    // 基本数学运算符
+    case EXP_ASSIGNOP:
+    case EXP_AND:
+    case EXP_OR:
+    case EXP_RELOP:
+    case EXP_PLUS:
+    case EXP_MINUS:
+    case EXP_STAR:
+    case EXP_DIV:
+    {
+        pType p1 = Exp(compiler, child);                   //左边的类型
+        pType p2 = Exp(compiler, getBrother(getBrother(child))); //右边的类型
+        pType returnType = NULL;
 
-            // Exp -> Exp ASSIGNOP Exp
-            if (!strcmp(child->brother->name, "ASSIGNOP"))
+        // Exp -> Exp ASSIGNOP Exp
+        if (currentNode->production == EXP_ASSIGNOP)
+        {
+            //检查左值，只有变量、函数调用、数组和结构体访问可以放在左边
+            switch (child->production)
             {
-                //检查左值
-                pNode lchild = child->child;
-                
-                if (!strcmp(lchild->name, "FLOAT") ||
-                    !strcmp(lchild->name, "INT"))
-                {
-                    //报错，左值
-                    pError(LEFT_VAR_ASSIGN, child->lineno, NULL);
-                }
-                else if (!strcmp(lchild->name, "ID") ||
-                         !strcmp(lchild->brother->name, "LB") ||
-                         !strcmp(lchild->brother->name, "DOT"))
+            case EXP_ID:
+            case EXP_CALL:
+            case EXP_CALL_ARGS:
+            case EXP_ARRAY:
+            case EXP_DOT:
+                if (!checkType(p1, p2))
                 {
-                    if (!checkType(p1, p2))
-                    {
-                        perror("2");
-                        //报错，类型不匹配
-                        pError(TYPE_MISMATCH_ASSIGN, child->lineno, NULL);
-                    }
-                    else
-                        returnType = copyType(p1);
+                    perror("2");
+                    //报错，类型不匹配
+                    pError(compiler, TYPE_MISMATCH_ASSIGN, child->lineno, NULL);
                 }
                 else
-                {
-                    //报错，左值
-                    pError(LEFT_VAR_ASSIGN, child->lineno, NULL);
-                }
+                    returnType = p1;
+                break;
+            default:
+                //报错，左值
+                pError(compiler, LEFT_VAR_ASSIGN, child->lineno, NULL);
+                break;
+            }
+        }
+        // Exp -> Exp AND Exp
+        //      | Exp OR Exp
+        //      | Exp RELOP Exp
+        //      | Exp PLUS Exp
+        //      | Exp MINUS Exp
+        //      | Exp STAR Exp
+        //      | Exp DIV Exp
+        else
+        {
+            if (p1 && p2 && (p1->kind == ARRAY || p2->kind == ARRAY))
+            {
+                //报错，数组，结构体运算
+                pError(compiler, TYPE_MISMATCH_OP, child->lineno, NULL);
+            }
+            else if (!checkType(p1, p2))
+            {
+                //报错，类型不匹配
+                pError(compiler, TYPE_MISMATCH_OP, child->lineno, NULL);
             }
-            // Exp -> Exp AND Exp
-            //      | Exp OR Exp
-            //      | Exp RELOP Exp
-            //      | Exp PLUS Exp
-            //      | Exp MINUS Exp
-            //      | Exp STAR Exp
-            //      | Exp DIV Exp
             else
             {
-                if (p1 && p2 && (p1->kind == ARRAY || p2->kind == ARRAY))
-                {
-                    //报错，数组，结构体运算
-                    pError(TYPE_MISMATCH_OP, child->lineno, NULL);
-                }
-                else if (!checkType(p1, p2))
-                {
-                    //报错，类型不匹配
-                    pError(TYPE_MISMATCH_OP, child->lineno, NULL);
-                }
-                else
+                if (p1 && p2)
                 {
-                    if (p1 && p2)
-                    {
-                        returnType = copyType(p1);
-                    }
+                    returnType = p1;
                 }
             }
+        }
 
-            if (p1)
-                freeType(p1);
-            if (p2)
-                freeType(p2);
-            return returnType;
+        return returnType;
+    }
+    // Exp -> Exp LB Exp RB
+    case EXP_ARRAY:
+    {
+        //数组
+        pType p1 = Exp(compiler, child);
+        pType p2 = Exp(compiler, getBrother(getBrother(child)));
+        pType returnType = NULL;
+
+        if (!p1)
+        {
+            // 第一个exp为null，上层报错，这里不用再管
+        }
+        else if (p1 && p1->kind != ARRAY)
+        {
+            //报错，非数组使用[]运算符
+            pError(compiler, NOT_A_ARRAY, child->lineno, getNodeValue(compiler, getChild(child)));
+        }
+        else if (!p2 || p2->kind != BASIC ||
+                 p2->u.basic != INT_TYPE_)
+        {
+            //报错，不用int索引[]
+            pError(compiler, NOT_A_INT, child->lineno, getNodeValue(compiler, getChild(getBrother(getBrother(child)))));
+        }
+        else
+        {
+            returnType = p1->u.array.elem;
+        }
+        return returnType;
+    }
+    // Exp -> Exp DOT ID
+    case EXP_DOT:
+    {
+        pType p1 = Exp(compiler, child);
+        pType returnType = NULL;
+        if (!p1 || p1->kind != STRUCTURE ||
+            !p1->u.structure.name)
+        {
+            //报错，对非结构体使用.运算符
+            pError(compiler, ILLEGAL_USE_DOT, child->lineno, NULL);
         }
-        // 数组和结构体访问
         else
         {
-            // Exp -> Exp LB Exp RB
-            if (!strcmp(child->brother->name, "LB"))
+            pNode ref_id = getBrother(getBrother(child));
+            pFieldList structfield = getStructField(p1, getNodeValue(compiler, ref_id));
+            if (structfield == NULL)
             {
-                //数组
-                pType p1 = Exp(child);
-                pType p2 = Exp(child->brother->brother);
-                pType returnType = NULL;
-
-                if (!p1)
-                {
-                    // 第一个exp为null，上层报错，这里不用再管
-                }
-                else if (p1 && p1->kind != ARRAY)
-                {
-                    //报错，非数组使用[]运算符
-                    pError(NOT_A_ARRAY, child->lineno, child->child->value);
-                }
-                else if (!p2 || p2->kind != BASIC ||
-                         p2->u.basic != INT_TYPE_)
-                {
-                    //报错，不用int索引[]
-                    pError(NOT_A_INT, child->lineno, child->brother->brother->child->value);
-                }
-                else
-                {
-                    returnType = copyType(p1->u.array.elem);
-                }
-                if (p1)
-                    freeType(p1);
-                if (p2)
-                    freeType(p2);
-                return returnType;
+                //报错，没有可以匹配的域名
+                pError(compiler, NONEXISTFIELD, currentNode->lineno, getNodeValue(compiler, ref_id));
             }
-            // Exp -> Exp DOT ID
             else
             {
-                pType p1 = Exp(child);
-                pType returnType = NULL;
-                if (!p1 || p1->kind != STRUCTURE ||
-                    !p1->u.structure.name)
-                {
-                    //报错，对非结构体使用.运算符
-                    pError(ILLEGAL_USE_DOT, child->lineno, NULL);
-                    if (p1)
-                    {
-                        freeType(p1);
-                        p1 = NULL;
-                    }
-                }
-                else
-                {
-                    pNode ref_id = child->brother->brother;
-                    pFieldList structfield = p1->u.structure.structureField;
-                    while (structfield != NULL)
-                    {
-                        if (!strcmp(structfield->name, ref_id->value))
-                        {
-                            break;
-                        }
-                        structfield = structfield->tail;
-                    }
-                    if (structfield == NULL)
-                    {
-                        //报错，没有可以匹配的域名
-                        pError(NONEXISTFIELD, currentNode->lineno, ref_id->value);
-                    }
-                    else
-                    {
-                        returnType = copyType(structfield->type);
-                    }
-                }
-                if (p1)
-                {
-                    freeType(p1);
-                }
-
-                return returnType;
+                returnType = structfield->type;
             }
         }
+        return returnType;
     }
     //单目运算符
     // Exp -> MINUS Exp
     //      | NOT Exp
-    else if (!strcmp(child->name, "MINUS") || !strcmp(child->name, "NOT"))
+    case EXP_NEG:
+    case EXP_NOT:
     {
-        pType p1 = Exp(child->brother);
+        pType p1 = Exp(compiler, getBrother(child));
         pType returnType = NULL;
         if (!p1 || p1->kind != BASIC)
         {
             //报错，数组，结构体运算
-            pError(TYPE_MISMATCH_OP, currentNode->lineno, NULL);
+            pError(compiler, TYPE_MISMATCH_OP, currentNode->lineno, NULL);
         }
         else
         {
-            returnType = copyType(p1);
+            returnType = p1;
         }
-        if (p1)
-            freeType(p1);
         return returnType;
     }
-    else if (!strcmp(child->name, "LP"))
-    {
-        return Exp(child->brother);
-    }
+    // Exp -> LP Exp RP
+    case EXP_PAREN:
+        return Exp(compiler, getBrother(child));
     // Exp -> ID LP Args RP
     //		| ID LP RP
-    else if (!strcmp(child->name, "ID") && child->brother)
+    case EXP_CALL_ARGS:
+    case EXP_CALL:
     {
-        pTableItem funcInfo = getSymbolTableItem(symbolTable, child->value);
+        pTableItem funcInfo = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
 
         // function not find
         if (funcInfo == NULL)
         {
-            pError(UNDEF_FUNC, currentNode->lineno, child->value);
+            pError(compiler, UNDEF_FUNC, currentNode->lineno, getNodeValue(compiler, child));
             return NULL;
         }
         else if (funcInfo->field->type->kind != FUNCTION)
         {
-            pError(NOT_A_FUNC, currentNode->lineno, child->value);
+            pError(compiler, NOT_A_FUNC, currentNode->lineno, getNodeValue(compiler, child));
             return NULL;
         }
         // Exp -> ID LP Args RP
-        else if (!strcmp(child->brother->brother->name, "Args"))
+        else if (currentNode->production == EXP_CALL_ARGS)
         {
-            Args(child->brother->brother, funcInfo);
-            return copyType(funcInfo->field->type->u.function.returnType);
+            Args(compiler, getBrother(getBrother(child)), funcInfo);
+            return funcInfo->field->type->u.function.returnType;
         }
         // Exp -> ID LP RP
         else
         {
             if (funcInfo->field->type->u.function.argc != 0)
             {
-                pError(FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
+                pError(compiler, FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
             }
-            return copyType(funcInfo->field->type->u.function.returnType);
+            return funcInfo->field->type->u.function.returnType;
         }
     }
     // Exp -> ID
-    else if (!strcmp(child->name, "ID"))
+    case EXP_ID:
     {
-        pTableItem tp = getSymbolTableItem(symbolTable, child->value);
+        pTableItem tp = getSymbolTableItem(compiler->symbolTable, getNodeValue(compiler, child));
         if (tp == NULL || isStructDef(tp))
         {
-            pError(UNDEF_VAR, child->lineno, child->value);
+            pError(compiler, UNDEF_VAR, child->lineno, getNodeValue(compiler, child));
             return NULL;
         }
         else
         {
             // good
-            return copyType(tp->field->type);
+            return tp->field->type;
         }
     }
-    else
-    {
-        // Exp -> FLOAT
-        if (!strcmp(child->name, "FLOAT"))
-        {
-            return newType(BASIC, FLOAT_TYPE_);
-        }
-        // Exp -> INT
-        else
-        {
-            return newType(BASIC, INT_TYPE_);
-        }
+    // Exp -> FLOAT
+    case EXP_FLOAT:
+        return getBasicType(compiler->types, FLOAT_TYPE_);
+    // Exp -> INT
+    default:
+        return getBasicType(compiler->types, INT_TYPE_);
     }
 }
 
-void Args(pNode currentNode, pTableItem funcInfo)
+void Args(pCompiler compiler, pNode currentNode, pTableItem funcInfo)
 {
     assert(currentNode != NULL);
     // Args -> Exp COMMA Args
@@ -1658,27 +2417,23 @@ void Args(pNode currentNode, pTableItem funcInfo)
     {
         if (arg == NULL)
         {
-            pError(FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
+            pError(compiler, FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
             break;
         }
-        pType realType = Exp(temp->child);
+        pType realType = Exp(compiler, getChild(temp));
         // printf("=======arg type=========\n");
         // printType(realType);
         // printf("===========end==========\n");
         if (!checkType(realType, arg->type))
         {
-            pError(FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
-            if (realType)
-                freeType(realType);
+            pError(compiler, FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
             return;
         }
-        if (realType)
-            freeType(realType);
 
         arg = arg->tail;
-        if (temp->child->brother)
+        if (getBrother(getChild(temp)))
         {
-            temp = temp->child->brother->brother;
+            temp = getBrother(getBrother(getChild(temp)));
         }
         else
         {
@@ -1687,6 +2442,6 @@ void Args(pNode currentNode, pTableItem funcInfo)
     }
     if (arg != NULL)
     {
-        pError(FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
+        pError(compiler, FUNC_AGRC_MISMATCH, currentNode->lineno, funcInfo->field->name);
     }
 }
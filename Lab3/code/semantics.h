@@ -2,8 +2,12 @@
 #define SEMANTICS_H
 
 #include "node.h"
+#include <pthread.h>
 
-#define SYMBOL_TABLE_SIZE 0X3FFF
+#define SYMBOL_TABLE_INIT_SIZE 64 //hash表初始的槽数，必须是2的幂，名字和墓碑占满一半就重建，名字超过四分之一时扩容到两倍
+#define SCOPE_STACK_INIT_SIZE 16  //作用域栈初始的层数，不够时扩容到两倍
+#define TYPE_TABLE_INIT_SIZE 64   //类型表初始的槽数，必须是2的幂，装满一半就扩容到两倍
+#define BUILTIN_COUNT 2           //内置函数的个数，见semantics.c中的builtins
 #define FREE(p)   \
     if (p)        \
     {             \
@@ -13,7 +17,7 @@
 
 #define STACK_INC_DEPTH(s) \
     if (s)                 \
-        s->stackDepth++; //栈增长
+        pushStackLayer(s); //栈增长，层数不够时扩容
 #define STACK_DEC_DEPTH(s) \
     if (s)                 \
         s->stackDepth--;
@@ -23,22 +27,7 @@
     {                                     \
         s->stackArray[s->stackDepth] = i; \
     }
-#define GET_HASH_HEAD(h, c) h ? h->hashArray[c] : NULL
-#define SET_HASH_HEAD(h, c, i) \
-    if (h)                     \
-    {                          \
-        h->hashArray[c] = i;   \
-    }
-#define SET_FEILDLIST_NAME(f, n) \
-    if (f->name)                 \
-    {                            \
-        FREE(f->name);           \
-        f->name = newString(n);  \
-    }                            \
-    else                         \
-    {                            \
-        f->name = newString(n);  \
-    }
+#define SET_FEILDLIST_NAME(f, n) ((f)->name = (n)) //名字必须是驻留过的，不需要释放旧的名字
 
 #ifdef DEBUGON
 #define print(s) fprintf(stdout, "%d %s\n", __LINE__, s);
@@ -48,11 +37,17 @@
 
 typedef struct Type_ *pType;
 typedef struct FieldList_ *pFieldList;
+typedef struct TypeTable_ *pTypeTable;
 typedef struct HashTable_ *pHashTable;
 typedef struct TableItem_ *pTableItem;
 typedef struct Stack_ *pStack;
 typedef struct SymbolTable_ *pSymbolTable;
 typedef struct FuncDeclarationStack_ *pFuncDecStack;
+typedef unsigned int (*SymbolHash)(const char *name); //符号表用的hash函数，名字是驻留过的
+typedef struct Builtin_ *pBuiltin;
+struct Operand_; //运算对象，定义在inter.h中
+//内置函数的翻译，args是调用的Args节点（没有参数时为NULL），返回值放到place中（可以为NULL）
+typedef void (*BuiltinLowering)(pCompiler compiler, pNode args, struct Operand_ *place);
 typedef enum kind_
 {
     BASIC,
@@ -76,12 +71,20 @@ struct Type_
         {
             pType elem;
             int size;
+            //下面三个在建立类型时算好
+            unsigned bytes;    //整个数组的字节数
+            unsigned dims;     //维数，elem也是数组时比elem多一维
+            unsigned *strides; //strides[i]是用了i+1个下标以后的元素的字节数，strides[0]就是elem的大小
         } array;
         //  结构体类型信息是一个链表
         struct
         {
-            char *name;
+            const char *name; //驻留过的名字
             pFieldList structureField;
+            //下面三个只有结构体变量的类型才有，建立类型时算好
+            pFieldList *fieldIndex; //按名字开放定址的域
+            unsigned fieldMask;     //fieldIndex的长度减一
+            unsigned size;          //结构体的字节数
         } structure;
         // 函数
         struct
@@ -93,14 +96,46 @@ struct Type_
     } u;
 };
 
+/**
+ * @brief 内置函数，类型是静态的，所有的编译共用，不能修改。
+ * 调用时直接用lower翻译成对应的中间代码，不产生ARG和CALL
+ *
+ */
+struct Builtin_
+{
+    const char *name;
+    struct Type_ type; //FUNCTION类型
+    BuiltinLowering lower;
+};
+
 struct FieldList_
 {
-    char *name;      //  域的名字
+    const char *name; //  域的名字，驻留过的，可以直接比较指针
     pType type;      //  域的类型
     bool isParam;    //  是否是函数参数
+    unsigned offset; //  结构体的域在结构体中的字节偏移
     pFieldList tail; //  下一个域
 };
 
+/**
+ * @brief 类型表，结构相同的类型只有一个对象，建好以后就不再修改，比较类型时先比较指针。
+ * 数组类型按(元素类型, 长度)、结构体变量的类型按(结构体名, 定义中的域)放在开放定址的hash表中，
+ * 结构体定义本身和函数的类型每个一个，不放进hash表。
+ * 所有的类型和类型里的域都放在arena中，和类型表一起释放，符号表里的域只是引用它们。
+ * 并行检查函数体时各个线程共用一个类型表，建立类型和分配域都在lock里做，建好的类型不会再改，读不需要加锁
+ *
+ */
+struct TypeTable_
+{
+    pArena arena;      //类型和类型里的域
+    pType *buckets;    //数组类型和结构体变量的类型
+    unsigned capacity; //槽数，总是2的幂
+    unsigned count;    //hash表中的类型数
+    unsigned typeCount; //一共建过的类型数，--mem-stats用
+    struct Type_ intType, floatType;
+    pthread_mutex_t lock;
+};
+
 /**
  * @brief 符号表中的一个项
  *
@@ -109,18 +144,37 @@ struct TableItem_
 {
     int symbolDepth; //  在符号表中的深度，可以方便查看后续有多少个同hash值的item
     pFieldList field;
-    //使用十字链表所以需要两个指针，一个指栈中同一层的item，一个指相同hash的item
+    //使用十字链表所以需要两个指针，一个指栈中同一层的item，一个指同名的item
     pTableItem nextSymbol; //  相同嵌套深度的符号，竖指针
-    pTableItem nextHash;   //  同hash值的item，横指针
+    pTableItem nextHash;   //  被它遮住的同名item，横指针
+    pTableItem prevHash;   //  遮住它的同名item，它自己在槽里时为NULL，删除时不用从头找
+    unsigned hashSlot;     //  它在槽里时槽的下标，删除时不用重新算hash
+    unsigned hash;         //  名字的hash值，加入时算一次，扩容时不用重新算
+    const struct Builtin_ *builtin; //  内置函数，普通的符号为NULL。内置函数的item放在符号表里，不单独释放
+    unsigned order;        //  加入时是第几个ExtDef，增量分析时用来挡住后面的ExtDef定义的全局符号
+    //  它和被它遮住的所有同名item中最深的深度、有没有结构体，加入时算好，重复定义检查用它提前停下来。
+    //  下面的item删掉以后不再更新，只会偏大，停得晚一点，不会出错
+    int shadowDepth;
+    bool shadowStructure;
 };
 
 /**
- * @brief 符号表中的hash表
+ * @brief 符号表中的hash表，开放定址，线性探测。
+ * 每个名字只占一个槽，槽里放的是这个名字最新加入的item，被它遮住的同名item用nextHash/prevHash串在后面。
+ * 名字的最后一个item删掉以后槽里留下墓碑，扩容的时候再清掉
  *
  */
 struct HashTable_
 {
     pTableItem *hashArray;
+    unsigned capacity; //槽数，总是2的幂
+    unsigned count;    //放着名字的槽数，也就是不同名字的个数
+    unsigned deleted;  //墓碑的个数
+    unsigned shift;    //32减去log2(capacity)，打散后的hash值右移这么多位就是槽的下标
+    SymbolHash hash;   //hash函数
+    //--symbol-stats用的统计
+    unsigned long lookups; //getSymbolTableItem调用的次数
+    unsigned long probes;  //这些调用一共看过的槽数
 };
 
 /**
@@ -130,6 +184,8 @@ struct HashTable_
 struct Stack_
 {
     int stackDepth;
+    int deepest;  //放过符号的最深的一层，清除局部变量时只需要清到这一层
+    int capacity; //stackArray的长度，嵌套得更深时扩容
     pTableItem *stackArray;
 };
 
@@ -142,6 +198,12 @@ struct SymbolTable_
     pHashTable hashTable;
     pStack stack;
     unsigned unamedStructNum; //未被命名的结构体
+    unsigned order;           //正在分析第几个ExtDef，加入的item记下它
+    unsigned horizon;         //查找时看不到order比它大的item，平时是UINT_MAX，增量分析重新分析函数体时是这个函数的序号
+    pSymbolTable globals;     //不为NULL时这是一个函数体私有的局部作用域，这里找不到的名字再到globals中找，globals只读
+    //内置函数的item和域，跟着符号表一起分配，域的名字要用这次编译驻留过的
+    struct TableItem_ builtinItems[BUILTIN_COUNT];
+    struct FieldList_ builtinFields[BUILTIN_COUNT];
 };
 
 /*
@@ -153,6 +215,34 @@ struct FuncDeclarationStack_
     pTableItem item;
 };
 
+/**
+ * @brief 一个记下来的语义错误，输出的格式见formatDiagnostic
+ *
+ */
+typedef struct Diagnostic_
+{
+    int type;         //ErrorType
+    int line;         //行号
+    const char *name; //驻留过的名字，可以为NULL
+} Diagnostic;
+
+/**
+ * @brief 语义错误的列表，pError把错误加到compiler->diagnostics指向的列表中，用flushDiagnostics一次写出去。
+ * 同一行同一种错误只留第一个，最多留maxErrors个
+ *
+ */
+typedef struct DiagnosticList_
+{
+    Diagnostic *items;
+    unsigned count;        //还没有写出去的错误
+    unsigned capacity;
+    uint64_t *seen;        //留下过的(行号, 错误类型)，开放定址，用来去掉重复的错误
+    unsigned seenCapacity; //seen的长度，总是2的幂
+    unsigned kept;         //一共留下过的错误数，包括已经写出去的
+    unsigned maxErrors;    //--max-errors，最多留这么多个错误，0表示不限
+    bool truncated;        //错误超过了maxErrors，语义分析提前结束
+} DiagnosticList, *pDiagnosticList;
+
 typedef enum _errorType
 {
     UNDEF_VAR = 1,            // Undefined Variable
@@ -176,47 +266,74 @@ typedef enum _errorType
     DCLARE_FUNC_INCONSISTENT, // Inconsistent declaration of function
 } ErrorType;
 
-unsigned int hash_pjw(char *name);
-void pError(ErrorType type, int line, char *msg);
-pHashTable newHashTable();
+unsigned int hash_pjw(const char *name);
+unsigned int hash_fnv1a(const char *name);
+unsigned int hash_intern(const char *name);
+SymbolHash getSymbolHash(const char *hashName);
+const char *getSymbolHashName(SymbolHash hash);
+void pError(pCompiler compiler, ErrorType type, int line, const char *msg);
+void addDiagnostic(pDiagnosticList list, ErrorType type, int line, const char *name);
+void flushDiagnostics(pDiagnosticList list, FILE *out);
+void clearDiagnosticList(pDiagnosticList list);
+void freeDiagnosticList(pDiagnosticList list);
+pHashTable newHashTable(SymbolHash hash);
 void freeHashTable(pHashTable hashTable);
 pStack newStack();
+void pushStackLayer(pStack stack);
 void clearHeadLayerStack(pSymbolTable symbolTable);
+void clearLocalSymbols(pSymbolTable symbolTable);
 void freeStack(pStack stack);
-pSymbolTable initSymbolTable();
+pSymbolTable initSymbolTable(pCompiler compiler);
+pSymbolTable newLocalSymbolTable(pSymbolTable globals);
 void printSymbolTable(pSymbolTable table);
-pTableItem getSymbolTableItem(pSymbolTable table, char *name);
+void printSymbolTableStats(pSymbolTable table, FILE *out);
+pTableItem getSymbolTableItem(pSymbolTable table, const char *name);
 bool checkTableItemConflict(pSymbolTable table, pTableItem item);
 void freeSymbolTable(pSymbolTable symbolTable);
 pTableItem newTableItem(int depth, pFieldList feildList);
 void freeTableItem(pTableItem tableItem);
 bool isStructDef(pTableItem tableItem);
+pFieldList saveScopeSymbols(pCompiler compiler, int depth);
+void restoreScopeSymbols(pCompiler compiler, int depth, pFieldList symbols);
+const struct Builtin_ *getBuiltin(int index);
 
-pType newType(Kind kind, ...);
-pType copyType(pType srcType);
+pTypeTable newTypeTable();
+void freeTypeTable(pTypeTable table);
+void resetTypeTable(pTypeTable table);
+unsigned getTypeCount(pTypeTable table);
+size_t getTypeTableBytes(pTypeTable table);
+pType getBasicType(pTypeTable table, BasicType basic);
+pType getArrayType(pTypeTable table, pType elem, int size);
+pType getStructureType(pTypeTable table, const char *name, pFieldList fields);
+pType newStructureDefType(pTypeTable table);
+pType newFunctionType(pTypeTable table, int argc, pFieldList argv, pType returnType);
+pFieldList newTypeField(pTypeTable table, const char *name, pType type);
+const char *newStructName(pTypeTable table, unsigned number);
+pFieldList copyTypeFieldList(pTypeTable table, pFieldList srcFeildList);
+pFieldList getStructField(pType type, const char *name);
+unsigned int getSize(pType type);
 void printType(pType type);
 
-pFieldList newFieldList(char *name, pType type);
+pFieldList newFieldList(const char *name, pType type);
 void printFieldList(pFieldList fieldList);
 void freeFieldList(pFieldList feildList);
-pFieldList copyFieldList(pFieldList srcFeildList);
-
-void startSemanticAnalysis(pNode currentNode);
-void ExtDef(pNode currentNode);
-pType Specifier(pNode currentNode);
-pType StructSpecifier(pNode currentNode);
-void DefList(pNode currentNode, pTableItem structureItem);
-void Def(pNode currentNode, pTableItem structureItem);
-void DecList(pNode currentNode, pType type, pTableItem structureItem);
-void Dec(pNode currentNode, pType type, pTableItem structureItem);
-pFieldList VarDec(pNode currentNode, pType type);
-void ExtDecList(pNode currentNode, pType type);
-void FunDec(pNode currentNode, pType type);
-void CompSt(pNode currentNode, pType type);
-pFieldList VarList(pNode currentNode, int *argc);
-pFieldList ParamDec(pNode currentNode);
-void StmtList(pNode currentNode, pType returnType);
-void Stmt(pNode currentNode, pType returnType);
-pType Exp(pNode currentNode);
-void Args(pNode currentNode, pTableItem funcInfo);
+
+void startSemanticAnalysis(pCompiler compiler, pNode currentNode);
+void ExtDef(pCompiler compiler, pNode currentNode);
+pType Specifier(pCompiler compiler, pNode currentNode);
+pType StructSpecifier(pCompiler compiler, pNode currentNode);
+void DefList(pCompiler compiler, pNode currentNode, pTableItem structureItem);
+void Def(pCompiler compiler, pNode currentNode, pTableItem structureItem);
+void DecList(pCompiler compiler, pNode currentNode, pType type, pTableItem structureItem);
+void Dec(pCompiler compiler, pNode currentNode, pType type, pTableItem structureItem);
+pFieldList VarDec(pCompiler compiler, pNode currentNode, pType type);
+void ExtDecList(pCompiler compiler, pNode currentNode, pType type);
+void FunDec(pCompiler compiler, pNode currentNode, pType type);
+void CompSt(pCompiler compiler, pNode currentNode, pType type);
+pFieldList VarList(pCompiler compiler, pNode currentNode, int *argc);
+pFieldList ParamDec(pCompiler compiler, pNode currentNode);
+void StmtList(pCompiler compiler, pNode currentNode, pType returnType);
+void Stmt(pCompiler compiler, pNode currentNode, pType returnType);
+pType Exp(pCompiler compiler, pNode currentNode);
+void Args(pCompiler compiler, pNode currentNode, pTableItem funcInfo);
 #endif
\ No newline at end of file
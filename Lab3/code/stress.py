@@ -0,0 +1,37 @@
+import resource
+import sys
+
+import benchutil
+
+# 压力测试：生成有很多定义的文件，在很小的栈上跑./main，语法树的遍历不能随着列表变长而递归变深
+# 一半是全局变量（很长的ExtDefList），另一半是main函数里的局部变量（很长的DefList），
+# main里再给每十个局部变量赋一次值（很长的StmtList）
+# 用法：python3 stress.py [定义个数] [栈大小KB] [传给main的其他参数，比如--stream]
+n = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+stackKB = int(sys.argv[2]) if len(sys.argv) > 2 else 256
+options = sys.argv[3:]
+
+
+def generate(f):
+    for i in range(n // 2):
+        f.write('int g%d;\n' % i)
+    f.write('int main()\n{\n')
+    for i in range(n - n // 2):
+        f.write('    int v%d;\n' % i)
+    for i in range(0, n - n // 2, 10):
+        f.write('    v%d = %d;\n' % (i, i))
+    f.write('    return 0;\n}\n')
+
+
+def limitStack():
+    resource.setrlimit(resource.RLIMIT_STACK, (stackKB * 1024, stackKB * 1024))
+
+
+source = benchutil.generate('/tmp/stress_%d.cmm' % n, generate, cached=True)
+result = benchutil.run(options + [source], text=True, preexec_fn=limitStack)
+lines = result.stdout.splitlines()
+if result.returncode != 0 or not lines or lines[0] != 'FUNCTION main :' or result.stderr:
+    print('%s (%d definitions, %d KB stack) FAILED, exit code %d' % (source, n, stackKB, result.returncode))
+    print(result.stderr[:1000])
+    sys.exit(1)
+print('%s (%d definitions, %d KB stack) OK, %d lines of IR' % (source, n, stackKB, len(lines)))
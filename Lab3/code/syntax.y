@@ -1,15 +1,28 @@
+%code requires {
+    #include"node.h"
+}
+
 %{
     #include<stdio.h>
-    #include"node.h"
+    #include"compiler.h"
     #include"lex.yy.c"
-    extern int syntaxerror;
-    
-    pNode root;
     #define YYERROR_VERBOSE 1
 
 %}
 
+%code {
+    static void resetNodeArrayKeepLookahead(pCompiler compiler, int lookahead, YYSTYPE *lookaheadValue);
+    void yyerror(YYLTYPE *llocp, void *scanner, pCompiler compiler, const char *msg);
+}
+
 %locations
+/*
+    纯语法分析器，状态都在compiler和flex的可重入扫描器scanner中，没有全局变量，
+    所以不同线程可以同时分析不同的文件
+*/
+%define api.pure full
+%parse-param {void *scanner} {pCompiler compiler}
+%lex-param {void *scanner}
 
 /*
     在bison语法分析器中，每个语法符号，包括记号和非终结符，都可以有一个相应的值。
@@ -19,6 +32,7 @@
 //声明联合类型，以上说明摘自flex && bison
 %union{
     pNode node; 
+    NodeList list; //左递归的列表，记住最后一个节点，这样建出来的树和右递归时一样
 }
 
 /*
@@ -46,11 +60,12 @@
 
 // non-terminals
 
-%type <node> Program ExtDefList ExtDef ExtDecList   //  High-level Definitions
+%type <node> Program ExtDef ExtDecList             //  High-level Definitions
+%type <list> ExtDefList StmtList DefList
 %type <node> Specifier StructSpecifier OptTag Tag   //  Specifiers
 %type <node> VarDec FunDec VarList ParamDec         //  Declarators
-%type <node> CompSt StmtList Stmt                   //  Statements
-%type <node> DefList Def Dec DecList                //  Local Definitions
+%type <node> CompSt Stmt                            //  Statements
+%type <node> Def Dec DecList                        //  Local Definitions
 %type <node> Exp Args                               //  Expressions
 
 //优先级定义，从上到下优先级变强
@@ -69,101 +84,133 @@
 
 %%
 // High-level Definitions
-Program:            ExtDefList                              { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Program", 1, $1); root = $$; }
+Program:            ExtDefList                              { $$ = newSyntaxNode(compiler, @$.first_line, PROGRAM, 1, $1.head); compiler->root = $$; }
     ; 
-ExtDefList:         ExtDef ExtDefList                       { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDefList", 2, $1, $2); }
-    |                                                       { $$ = NULL; } 
-    ; 
-ExtDef:             Specifier ExtDecList SEMI               { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDef", 3, $1, $2, $3); }
-    |               Specifier SEMI                          { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDef", 2, $1, $2); }
-    |               Specifier FunDec CompSt                 { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDef", 3, $1, $2, $3); }
-    |               Specifier FunDec SEMI                   { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDef", 3, $1, $2, $3);}
-    |               error SEMI                              { syntaxerror = true; }
-    ; 
-ExtDecList:         VarDec                                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDecList", 1, $1); }
-    |               VarDec COMMA ExtDecList                 { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ExtDecList", 3, $1, $2, $3); }
+/*
+    ExtDefList写成左递归，每归约出一个ExtDef就能马上处理它，bison的栈也不会随着文件变长。
+    流式编译时处理完就丢掉它的子树，否则接到链表的末尾，树的形状和ExtDef ExtDefList一样。
+*/
+ExtDefList:         ExtDefList ExtDef                       {
+                                                                if (compiler->streaming)
+                                                                {
+                                                                    compileExtDef(compiler, $2);
+                                                                    resetNodeArrayKeepLookahead(compiler, yychar, &yylval);
+                                                                    $$.head = $$.tail = NULL;
+                                                                }
+                                                                else
+                                                                {
+                                                                    $$ = appendNodeList(compiler, $1, @2.first_line, EXTDEFLIST, $2);
+                                                                }
+                                                            }
+    |                                                       { $$.head = $$.tail = NULL; } 
+    ; 
+ExtDef:             Specifier ExtDecList SEMI               { $$ = newSyntaxNode(compiler, @$.first_line, EXTDEF_VAR, 3, $1, $2, $3); }
+    |               Specifier SEMI                          { $$ = newSyntaxNode(compiler, @$.first_line, EXTDEF_STRUCT, 2, $1, $2); }
+    |               Specifier FunDec CompSt                 { $$ = newSyntaxNode(compiler, @$.first_line, EXTDEF_FUNC, 3, $1, $2, $3); }
+    |               Specifier FunDec SEMI                   { $$ = newSyntaxNode(compiler, @$.first_line, EXTDEF_FUNC_DEC, 3, $1, $2, $3);}
+    |               error SEMI                              { compiler->syntaxerror = true; }
+    ; 
+ExtDecList:         VarDec                                  { $$ = newSyntaxNode(compiler, @$.first_line, EXTDECLIST_ONE, 1, $1); }
+    |               VarDec COMMA ExtDecList                 { $$ = newSyntaxNode(compiler, @$.first_line, EXTDECLIST_MORE, 3, $1, $2, $3); }
     ; 
 
 // Specifiers
-Specifier:          TYPE                                    { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Specifier", 1, $1); }
-    |               StructSpecifier                         { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Specifier", 1, $1); }
+Specifier:          TYPE                                    { $$ = newSyntaxNode(compiler, @$.first_line, SPECIFIER_TYPE, 1, $1); }
+    |               StructSpecifier                         { $$ = newSyntaxNode(compiler, @$.first_line, SPECIFIER_STRUCT, 1, $1); }
     ; 
-StructSpecifier:    STRUCT OptTag LC DefList RC             { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "StructSpecifier", 5, $1, $2, $3, $4, $5); }
-    |               STRUCT Tag                              { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "StructSpecifier", 2, $1, $2); }
+StructSpecifier:    STRUCT OptTag LC DefList RC             { $$ = newSyntaxNode(compiler, @$.first_line, STRUCTSPECIFIER_DEF, 5, $1, $2, $3, $4.head, $5); }
+    |               STRUCT Tag                              { $$ = newSyntaxNode(compiler, @$.first_line, STRUCTSPECIFIER_TAG, 2, $1, $2); }
     ; 
-OptTag:             ID                                      { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "OptTag", 1, $1); }
+OptTag:             ID                                      { $$ = newSyntaxNode(compiler, @$.first_line, OPTTAG, 1, $1); }
     |                                                       { $$ = NULL; }
     ; 
-Tag:                ID                                      { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Tag", 1, $1); }
+Tag:                ID                                      { $$ = newSyntaxNode(compiler, @$.first_line, TAG, 1, $1); }
     ; 
 
 // Declarators
-VarDec:             ID                                      { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "VarDec", 1, $1); }
-    |               VarDec LB INT RB                        { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "VarDec", 4, $1, $2, $3, $4); }
-    |               error RB                                { syntaxerror = true; }
+VarDec:             ID                                      { $$ = newSyntaxNode(compiler, @$.first_line, VARDEC_ID, 1, $1); }
+    |               VarDec LB INT RB                        { $$ = newSyntaxNode(compiler, @$.first_line, VARDEC_ARRAY, 4, $1, $2, $3, $4); }
+    |               error RB                                { compiler->syntaxerror = true; }
     ; 
-FunDec:             ID LP VarList RP                        { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "FunDec", 4, $1, $2, $3, $4); }
-    |               ID LP RP                                { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "FunDec", 3, $1, $2, $3); }
-    |               error RP                                { syntaxerror = true; }
+FunDec:             ID LP VarList RP                        { $$ = newSyntaxNode(compiler, @$.first_line, FUNDEC_ARGS, 4, $1, $2, $3, $4); }
+    |               ID LP RP                                { $$ = newSyntaxNode(compiler, @$.first_line, FUNDEC_NOARGS, 3, $1, $2, $3); }
+    |               error RP                                { compiler->syntaxerror = true; }
     ; 
-VarList:            ParamDec COMMA VarList                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "VarList", 3, $1, $2, $3); }
-    |               ParamDec                                { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "VarList", 1, $1); }
+VarList:            ParamDec COMMA VarList                  { $$ = newSyntaxNode(compiler, @$.first_line, VARLIST_MORE, 3, $1, $2, $3); }
+    |               ParamDec                                { $$ = newSyntaxNode(compiler, @$.first_line, VARLIST_ONE, 1, $1); }
     ; 
-ParamDec:           Specifier VarDec                        { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "ParamDec", 2, $1, $2); }
+ParamDec:           Specifier VarDec                        { $$ = newSyntaxNode(compiler, @$.first_line, PARAMDEC, 2, $1, $2); }
     ; 
     
 // Statements
-CompSt:             LC DefList StmtList RC                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "CompSt", 4, $1, $2, $3, $4); }
-    |               error RC                                { syntaxerror = true; }
+CompSt:             LC DefList StmtList RC                  { $$ = newSyntaxNode(compiler, @$.first_line, COMPST, 4, $1, $2.head, $3.head, $4); }
+    |               error RC                                { compiler->syntaxerror = true; }
     ; 
-StmtList:           Stmt StmtList                           { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "StmtList", 2, $1, $2); }
-    |                                                       { $$ = NULL; }
+/*StmtList和DefList也写成左递归，很长的函数体不会让bison的栈溢出*/
+StmtList:           StmtList Stmt                           { $$ = appendNodeList(compiler, $1, @2.first_line, STMTLIST, $2); }
+    |                                                       { $$.head = $$.tail = NULL; }
     ; 
-Stmt:               Exp SEMI                                { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 2, $1, $2); }
-    |               CompSt                                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 1, $1); }
-    |               RETURN Exp SEMI                         { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 3, $1, $2, $3); }    
-    |               IF LP Exp RP Stmt %prec LOWER_THAN_ELSE { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 5, $1, $2, $3, $4, $5); }
-    |               IF LP Exp RP Stmt ELSE Stmt             { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 7, $1, $2, $3, $4, $5, $6, $7); }
-    |               WHILE LP Exp RP Stmt                    { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Stmt", 5, $1, $2, $3, $4, $5); }
-    |               error SEMI                              { syntaxerror = true; }
+Stmt:               Exp SEMI                                { $$ = newSyntaxNode(compiler, @$.first_line, STMT_EXP, 2, $1, $2); }
+    |               CompSt                                  { $$ = newSyntaxNode(compiler, @$.first_line, STMT_COMPST, 1, $1); }
+    |               RETURN Exp SEMI                         { $$ = newSyntaxNode(compiler, @$.first_line, STMT_RETURN, 3, $1, $2, $3); }    
+    |               IF LP Exp RP Stmt %prec LOWER_THAN_ELSE { $$ = newSyntaxNode(compiler, @$.first_line, STMT_IF, 5, $1, $2, $3, $4, $5); }
+    |               IF LP Exp RP Stmt ELSE Stmt             { $$ = newSyntaxNode(compiler, @$.first_line, STMT_IF_ELSE, 7, $1, $2, $3, $4, $5, $6, $7); }
+    |               WHILE LP Exp RP Stmt                    { $$ = newSyntaxNode(compiler, @$.first_line, STMT_WHILE, 5, $1, $2, $3, $4, $5); }
+    |               error SEMI                              { compiler->syntaxerror = true; }
     ; 
 // Local Definitions
-DefList:            Def DefList                             { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "DefList", 2, $1, $2); }
-    |                                                       { $$ = NULL; }
+DefList:            DefList Def                             { $$ = appendNodeList(compiler, $1, @2.first_line, DEFLIST, $2); }
+    |                                                       { $$.head = $$.tail = NULL; }
     ;     
-Def:                Specifier DecList SEMI                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Def", 3, $1, $2, $3); }
+Def:                Specifier DecList SEMI                  { $$ = newSyntaxNode(compiler, @$.first_line, DEF, 3, $1, $2, $3); }
     ; 
-DecList:            Dec                                     { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "DecList", 1, $1); }
-    |               Dec COMMA DecList                       { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "DecList", 3, $1, $2, $3); }
+DecList:            Dec                                     { $$ = newSyntaxNode(compiler, @$.first_line, DECLIST_ONE, 1, $1); }
+    |               Dec COMMA DecList                       { $$ = newSyntaxNode(compiler, @$.first_line, DECLIST_MORE, 3, $1, $2, $3); }
     ; 
-Dec:                VarDec                                  { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Dec", 1, $1); }
-    |               VarDec ASSIGNOP Exp                     { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Dec", 3, $1, $2, $3); }
+Dec:                VarDec                                  { $$ = newSyntaxNode(compiler, @$.first_line, DEC_VAR, 1, $1); }
+    |               VarDec ASSIGNOP Exp                     { $$ = newSyntaxNode(compiler, @$.first_line, DEC_ASSIGN, 3, $1, $2, $3); }
     ; 
 //7.1.7 Expressions
-Exp:                Exp ASSIGNOP Exp                        { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp AND Exp                             { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp OR Exp                              { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp RELOP Exp                           { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp PLUS Exp                            { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp MINUS Exp                           { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp STAR Exp                            { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp DIV Exp                             { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               LP Exp RP                               { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               MINUS Exp                               { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 2, $1, $2); }
-    |               NOT Exp                                 { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 2, $1, $2); }
-    |               ID LP Args RP                           { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 4, $1, $2, $3, $4); }
-    |               ID LP RP                                { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               Exp LB Exp RB                           { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 4, $1, $2, $3, $4); }
-    |               Exp DOT ID                              { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 3, $1, $2, $3); }
-    |               ID                                      { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 1, $1); }
-    |               INT                                     { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 1, $1); }
-    |               FLOAT                                   { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Exp", 1, $1); }
-    ; 
-Args :              Exp COMMA Args                          { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Args", 3, $1, $2, $3); }
-    |               Exp                                     { $$ = newSyntaxNode(@$.first_line, NON_TERMINAL, "Args", 1, $1); }
+Exp:                Exp ASSIGNOP Exp                        { $$ = newSyntaxNode(compiler, @$.first_line, EXP_ASSIGNOP, 3, $1, $2, $3); }
+    |               Exp AND Exp                             { $$ = newSyntaxNode(compiler, @$.first_line, EXP_AND, 3, $1, $2, $3); }
+    |               Exp OR Exp                              { $$ = newSyntaxNode(compiler, @$.first_line, EXP_OR, 3, $1, $2, $3); }
+    |               Exp RELOP Exp                           { $$ = newSyntaxNode(compiler, @$.first_line, EXP_RELOP, 3, $1, $2, $3); }
+    |               Exp PLUS Exp                            { $$ = newSyntaxNode(compiler, @$.first_line, EXP_PLUS, 3, $1, $2, $3); }
+    |               Exp MINUS Exp                           { $$ = newSyntaxNode(compiler, @$.first_line, EXP_MINUS, 3, $1, $2, $3); }
+    |               Exp STAR Exp                            { $$ = newSyntaxNode(compiler, @$.first_line, EXP_STAR, 3, $1, $2, $3); }
+    |               Exp DIV Exp                             { $$ = newSyntaxNode(compiler, @$.first_line, EXP_DIV, 3, $1, $2, $3); }
+    |               LP Exp RP                               { $$ = newSyntaxNode(compiler, @$.first_line, EXP_PAREN, 3, $1, $2, $3); }
+    |               MINUS Exp                               { $$ = newSyntaxNode(compiler, @$.first_line, EXP_NEG, 2, $1, $2); }
+    |               NOT Exp                                 { $$ = newSyntaxNode(compiler, @$.first_line, EXP_NOT, 2, $1, $2); }
+    |               ID LP Args RP                           { $$ = newSyntaxNode(compiler, @$.first_line, EXP_CALL_ARGS, 4, $1, $2, $3, $4); }
+    |               ID LP RP                                { $$ = newSyntaxNode(compiler, @$.first_line, EXP_CALL, 3, $1, $2, $3); }
+    |               Exp LB Exp RB                           { $$ = newSyntaxNode(compiler, @$.first_line, EXP_ARRAY, 4, $1, $2, $3, $4); }
+    |               Exp DOT ID                              { $$ = newSyntaxNode(compiler, @$.first_line, EXP_DOT, 3, $1, $2, $3); }
+    |               ID                                      { $$ = newSyntaxNode(compiler, @$.first_line, EXP_ID, 1, $1); }
+    |               INT                                     { $$ = newSyntaxNode(compiler, @$.first_line, EXP_INT, 1, $1); }
+    |               FLOAT                                   { $$ = newSyntaxNode(compiler, @$.first_line, EXP_FLOAT, 1, $1); }
+    ; 
+Args :              Exp COMMA Args                          { $$ = newSyntaxNode(compiler, @$.first_line, ARGS_MORE, 3, $1, $2, $3); }
+    |               Exp                                     { $$ = newSyntaxNode(compiler, @$.first_line, ARGS_ONE, 1, $1); }
     ; 
 %%
 
-int yyerror(char* msg){
-    fprintf(stderr, "Error type B at line %d: %s.\n", yylineno, msg);
-}
\ No newline at end of file
+void yyerror(YYLTYPE *llocp, void *scanner, pCompiler compiler, const char *msg){
+    fprintf(compiler->err, "Error type B at line %d: %s.\n", yyget_lineno(scanner), msg);
+}
+/**
+ * @brief 流式编译时处理完一个ExtDef以后重置节点数组。
+ * 归约的时候bison可能已经读入了下一个Token（lookahead不是YYEMPTY），它的节点在lookaheadValue里，
+ * 也在节点数组中，所以要把它搬到重置后的节点数组里，其他节点都已经用不到了。
+ *
+ * @param compiler
+ * @param lookahead yyparse中的yychar
+ * @param lookaheadValue yyparse中的yylval
+ */
+static void resetNodeArrayKeepLookahead(pCompiler compiler, int lookahead, YYSTYPE *lookaheadValue)
+{
+    bool hasLookahead = lookahead != YYEMPTY && lookahead > 0;
+    pNode kept = resetNodeArray(&compiler->nodes, hasLookahead ? lookaheadValue->node : NULL);
+    if (hasLookahead)
+        lookaheadValue->node = kept;
+}
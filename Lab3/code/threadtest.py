@@ -0,0 +1,45 @@
+import glob
+import resource
+import sys
+
+import benchutil
+
+# 多文件测试：一次把所有测试文件交给./main，每个文件在自己的线程中编译，
+# 输出必须和一个一个单独编译时按顺序拼起来的结果完全一样。
+# 单独编译时就异常退出的文件（比如触发了assert）会让整个进程退出，不放进来。
+# 最后把地址空间限制在2GB再一起编译一次，节点数组按文件大小预留，不能因为地址空间不够而失败
+# 用法：python3 threadtest.py [传给main的其他参数，比如--stream]
+options = sys.argv[1:]
+files = sorted(glob.glob('../test/*/test*')) + sorted(glob.glob('../../Lab2/test/*/test*'))
+files = [f for f in files if not f.endswith('.ir')]
+
+
+def run(args):
+    result = benchutil.run(options + args)
+    return result.returncode, result.stdout, result.stderr
+
+
+expectedOut, expectedErr = b'', b''
+compiled = []
+for f in files:
+    code, out, err = run([f])
+    if code != 0:
+        continue
+    compiled.append(f)
+    expectedOut += out
+    expectedErr += err
+files = compiled
+for round in range(5):
+    code, out, err = run(files)
+    if code != 0 or out != expectedOut or err != expectedErr:
+        print('%d files compiled together FAILED in round %d, output differs from compiling them one by one' %
+              (len(files), round))
+        sys.exit(1)
+limit = 2 << 30
+result = benchutil.run(options + files, preexec_fn=lambda: resource.setrlimit(resource.RLIMIT_AS, (limit, limit)))
+if result.returncode != 0 or result.stdout != expectedOut or result.stderr != expectedErr:
+    print('%d files compiled together FAILED with a 2GB address space limit: %s' %
+          (len(files), result.stderr.decode().strip().splitlines()[-1:]))
+    sys.exit(1)
+print('%d files compiled together OK, same output as compiling them one by one, also with a 2GB address space limit' %
+      len(files))
@@ -0,0 +1,57 @@
+import os
+import subprocess
+import sys
+
+import benchutil
+
+# 类型测试：生成很多个大结构体，每个结构体里有数组、第一个结构体的数组和前一个结构体，
+# 再用它们声明很多全局变量、函数的局部变量和参数，语句里访问结构体的域和数组元素。
+# 打印语义分析的耗时、类型表里的类型个数和进程的最大常驻内存，
+# 同一个声明不应该再复制一遍类型，类型个数只和不同的类型有关，和声明的个数无关
+# 用法：python3 typebench.py [结构体个数] [每个结构体的声明个数] [次数] [传给main的其他参数]
+structs = int(sys.argv[1]) if len(sys.argv) > 1 else 100
+decls = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+rounds = int(sys.argv[3]) if len(sys.argv) > 3 else 3
+options = sys.argv[4:]
+fields = 8
+
+
+def generate(f):
+    for s in range(structs):
+        f.write('struct S%d\n{\n' % s)
+        for i in range(fields):
+            f.write('int i%d; float f%d;\n' % (i, i))
+        f.write('int m[64];\n')
+        if s > 0:
+            f.write('struct S0 first[4];\nstruct S%d prev;\n' % (s - 1))
+        f.write('};\n')
+    for s in range(structs):
+        f.write('struct S%d g%d_%s;\n' % (s, s, (', g%d_' % s).join(str(d) for d in range(decls))))
+        f.write('int use%d(struct S%d p%d)\n{\n' % (s, s, s))
+        for d in range(decls):
+            f.write('struct S%d a%d_%d; int t%d_%d[64];\n' % (s, s, d, s, d))
+        for d in range(decls):
+            f.write('a%d_%d.m[%d] = t%d_%d[%d] + p%d.i%d;\n' % (s, d, d % 64, s, d, (d + 1) % 64, s, d % fields))
+        f.write('return p%d.i0;\n}\n' % s)
+    f.write('int main()\n{\nwrite(read());\nreturn 0;\n}\n')
+
+
+def run(source):
+    # 用wait4拿到这一个子进程的最大常驻内存
+    process = subprocess.Popen(['./main', '--time', '--mem-stats'] + options + [source],
+                               stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, universal_newlines=True)
+    err = process.stderr.read()
+    _, status, usage = os.wait4(process.pid, 0)
+    semantic, types = 0.0, ''
+    for line in err.splitlines():
+        if line.startswith('semantic:'):
+            semantic = float(line.split(':')[1].split()[0])
+        elif line.startswith('types:'):
+            types = line.split(':', 1)[1].strip()
+    return semantic, usage.ru_maxrss, types
+
+
+source = benchutil.generate('/tmp/typebench_%d_%d.cmm' % (structs, decls), generate)
+print('%d structs, %d declarations of each, %d rounds, median, %s' % (structs, decls, rounds, ' '.join(options)))
+semantic, rss, types = benchutil.median(run(source) for i in range(rounds))
+print('semantic: %.3f ms, max rss: %d KB, types: %s' % (semantic, rss, types or 'n/a'))
@@ -2,68 +2,45 @@
 #include <stdio.h>
 
 /**
- * @brief 将一个十六进制字符串转化为十进制整型数值
- * 
- * @param hexStr 十六进制的字符串
- * @return int 如果是十六进制字符串则返回正确的值，否则程序应该出错，这里感觉可以使用setjmp等函数来处理异常，但是我不会。
+ * @brief 将十进制、八进制（0开头）或十六进制（0x开头）的整数字面量转化为数值，只扫描一遍，
+ * 不需要字面量以\0结尾，所以可以直接用在映射的源文件上
+ *
+ * @param text 字面量，必须是词法分析已经确认过的合法整数
+ * @param length 字面量的长度
+ * @return int64_t 数值，超出int64_t的部分会回绕
  */
-int convertHexToDec(const char *hexStr)
+int64_t parseIntLiteral(const char *text, size_t length)
 {
-    size_t length = strlen(hexStr);
-    //先判断是不是十六进制数
-    assert(!strncmp(hexStr, "0x", 2) || !strncmp(hexStr, "0X", 2) &&length >= 3);
-    int decimal = 0,base = 1;
-    int i = 0;
-    for (i = --length; i >= 2; i--)
+    assert(text != NULL && length > 0);
+    uint64_t value = 0;
+    size_t i = 0;
+    if (length >= 3 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
     {
-        if (hexStr[i] >= '0' && hexStr[i] <= '9')
-        {
-            decimal += (hexStr[i] - 48) * base;
-            base *= 16;
-        }
-        else if (hexStr[i] >= 'A' && hexStr[i] <= 'F')
+        for (i = 2; i < length; i++)
         {
-            decimal += (hexStr[i] - 55) * base;
-            base *= 16;
+            char c = text[i];
+            unsigned digit = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+            assert(digit < 16);
+            value = value * 16 + digit;
         }
-        else if (hexStr[i] >= 'a' && hexStr[i] <= 'f')
+    }
+    else if (text[0] == '0')
+    {
+        for (i = 1; i < length; i++)
         {
-            decimal += (hexStr[i] - 87) * base;
-            base *= 16;
-        }else{
-            fprintf(stderr,"error hex input\n");
-            assert(false);
+            assert(text[i] >= '0' && text[i] <= '7');
+            value = value * 8 + (text[i] - '0');
         }
     }
-    return decimal;
-}
-
-/**
- * @brief 将一个八进制字符串转化为十进制整型数值
- * 
- * @param octStr 八进制的字符串
- * @return int 如果是八进制字符串则返回正确的值，否则程序应该出错
- */
-int convertOctToDec(const char *octStr){
-    size_t length = strlen(octStr);
-    int decimal = 0,base = 1;
-    if(length == 1 && !strncmp(octStr,"0",1)){
-        return 0;
-    }else if(!strncmp(octStr,"0",1) && length >= 2){
-        int i = 0;
-        for (i = --length; i >= 1; i--)
+    else
+    {
+        for (i = 0; i < length; i++)
         {
-            if (octStr[i] >= '0' && octStr[i] <= '7')
-            {
-                decimal += (octStr[i] - 48) * base;
-                base *= 8;
-            }else{
-                fprintf(stderr,"error oct input\n");
-                assert(false);
-            }
+            assert(text[i] >= '0' && text[i] <= '9');
+            value = value * 10 + (text[i] - '0');
         }
     }
-    return decimal;
+    return (int64_t)value;
 }
 
 /**
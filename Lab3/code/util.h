@@ -5,8 +5,8 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
 
-int convertHexToDec(const char *hexStr);
-int convertOctToDec(const char *octStr);
+int64_t parseIntLiteral(const char *text, size_t length);
 char* newString(char* src);
 #endif
\ No newline at end of file